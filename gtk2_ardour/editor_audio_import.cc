@@ -271,7 +271,6 @@ Editor::do_import (vector<string>        paths,
 {
 	boost::shared_ptr<Track> track;
 	vector<string> to_import;
-	int nth = 0;
 	bool use_timestamp = (pos == -1);
 
 	current_interthread_info = &import_status;
@@ -341,15 +340,9 @@ Editor::do_import (vector<string>        paths,
 			switch (disposition) {
 			case Editing::ImportDistinctFiles:
 
-				to_import.clear ();
-				to_import.push_back (*a);
-
-				if (mode == Editing::ImportToTrack) {
-					track = get_nth_selected_audio_track (nth++);
-				}
+				/* imported together once all files have been checked */
 
-				ok = (import_sndfiles (to_import, disposition, mode, quality, pos, 1, -1, track, replace, instrument) == 0);
-				import_status.sources.clear();
+				to_import.push_back (*a);
 				break;
 
 			case Editing::ImportDistinctChannels:
@@ -375,6 +368,12 @@ Editor::do_import (vector<string>        paths,
 				break;
 			}
 		}
+
+		if (disposition == Editing::ImportDistinctFiles && !to_import.empty ()) {
+			/* import_sndfiles() adds each file's sources to its own track */
+			ok = (import_sndfiles (to_import, disposition, mode, quality, pos, 1, -1, track, replace, instrument) == 0);
+			import_status.sources.clear();
+		}
 	}
 
 	if (ok) {
@@ -514,7 +513,49 @@ Editor::import_sndfiles (vector<string>            paths,
 
 	int result = -1;
 
-	if (!import_status.cancel && !import_status.sources.empty()) {
+	if (!import_status.cancel && !import_status.sources.empty() && disposition == Editing::ImportDistinctFiles) {
+
+		/* the files were imported in one go, but each is added
+		   as if it had been imported on its own
+		*/
+
+		bool const use_timestamp = (import_status.pos == -1);
+		SourceList::iterator s = import_status.sources.begin ();
+		int nth = 0;
+
+		result = 0;
+
+		for (size_t n = 0; n < import_status.paths.size(); ++n) {
+
+			if (mode == Editing::ImportToTrack) {
+				track = get_nth_selected_audio_track (nth++);
+			}
+
+			SourceList file_sources (s, s + import_status.sources_per_path[n]);
+			s += import_status.sources_per_path[n];
+
+			if (file_sources.empty ()) {
+				continue;
+			}
+
+			/* have to reset this for every file we handle */
+
+			if (use_timestamp) {
+				import_status.pos = -1;
+			}
+
+			if (add_sources (vector<string> (1, import_status.paths[n]), file_sources, import_status.pos, disposition,
+			                 import_status.mode, import_status.target_regions, import_status.target_tracks,
+			                 track, false, instrument) != 0) {
+				result = -1;
+			}
+		}
+
+		/* update position from results */
+
+		pos = import_status.pos;
+
+	} else if (!import_status.cancel && !import_status.sources.empty()) {
 		result = add_sources (
 			import_status.paths,
 			import_status.sources,
@@ -3185,7 +3185,7 @@ Editor::separate_regions_using_location (Location& loc)
 void
 Editor::separate_under_selected_regions ()
 {
-	vector<PlaylistState> playlists;
+	vector<boost::shared_ptr<Playlist> > playlists;
 
 	RegionSelection rs;
 
@@ -3221,23 +3221,12 @@ Editor::separate_under_selected_regions ()
 	        	continue;
 	        }
 
-		vector<PlaylistState>::iterator i;
-
-		//only take state if this is a new playlist.
-		for (i = playlists.begin(); i != playlists.end(); ++i) {
-			if ((*i).playlist == playlist) {
-				break;
-			}
-		}
-
-		if (i == playlists.end()) {
-
-			PlaylistState before;
-			before.playlist = playlist;
-			before.before = &playlist->get_state();
-
+		//only start tracking changes if this is a new playlist.
+		if (find (playlists.begin(), playlists.end(), playlist) == playlists.end()) {
+			playlist->clear_changes ();
+			playlist->clear_owned_changes ();
 			playlist->freeze ();
-			playlists.push_back(before);
+			playlists.push_back (playlist);
 		}
 
 		//Partition on the region bounds
@@ -3247,11 +3236,15 @@ Editor::separate_under_selected_regions ()
 		playlist->add_region( (*rl), (*rl)->first_frame() );
 	}
 
-	vector<PlaylistState>::iterator pl;
+	vector<boost::shared_ptr<Playlist> >::iterator pl;
 
 	for (pl = playlists.begin(); pl != playlists.end(); ++pl) {
-		(*pl).playlist->thaw ();
-		_session->add_command(new MementoCommand<Playlist>(*(*pl).playlist, (*pl).before, &(*pl).playlist->get_state()));
+		(*pl)->thaw ();
+
+		vector<Command*> cmds;
+		(*pl)->rdiff (cmds);
+		_session->add_commands (cmds);
+		_session->add_command (new StatefulDiffCommand (*pl));
 	}
 
 	commit_reversible_command ();
@@ -7427,7 +7420,8 @@ Editor::remove_time (framepos_t pos, framecnt_t frames, InsertTimeOption opt,
 
 		if (pl) {
 
-			XMLNode &before = pl->get_state();
+			pl->clear_changes ();
+			pl->clear_owned_changes ();
 
 			std::list<AudioRange> rl;
 			AudioRange ar(pos, pos+frames, 0);
@@ -7439,9 +7433,11 @@ Editor::remove_time (framepos_t pos, framecnt_t frames, InsertTimeOption opt,
 				begin_reversible_command (_("remove time"));
 				in_command = true;
 			}
-			XMLNode &after = pl->get_state();
+			vector<Command*> cmds;
+			pl->rdiff (cmds);
+			_session->add_commands (cmds);
 
-			_session->add_command (new MementoCommand<Playlist> (*pl, &before, &after));
+			_session->add_command (new StatefulDiffCommand (pl));
 		}
 
 		/* automation */
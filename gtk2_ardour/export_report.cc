@@ -235,6 +235,8 @@ ExportReport::init (const AnalysisResults & ar, bool with_file)
 		TXTSIZE(1, string_compose (_("%1 LUFS"), std::setprecision (1), std::fixed, p->loudness), get_LargeFont);
 		TXTSIZE(2, _("Loudness Range:"), get_SmallFont);
 		TXTSIZE(3, string_compose (_("%1 LU"), std::setprecision (1), std::fixed, p->loudness_range), get_LargeFont);
+		TXTSIZE(4, _("Phase Correlation:"), get_SmallFont);
+		TXTSIZE(5, _("+8.88"), get_SmallMonospaceFont);
 
 		mnw += 8;
 		const int ht = lin[0] * 1.25 + lin[1] * 1.25 + lin[2] * 1.25 + lin[3] *1.25 + lin[4] * 1.25 + lin[5];
@@ -251,7 +253,7 @@ ExportReport::init (const AnalysisResults & ar, bool with_file)
 		const int nw2 = mnw / 2; // nums, horizontal center
 
 		int y0[6];
-		if (p->normalized) {
+		if (p->normalized || p->have_correlation) {
 			y0[0] = (hh - ht) * .5;
 		} else {
 			y0[0] = (hh - htn) * .5;
@@ -467,6 +469,26 @@ ExportReport::init (const AnalysisResults & ar, bool with_file)
 				layout->get_pixel_size (w, h);
 				cr->move_to (rint (nw2 - w * .5), y0[3]);
 				layout->show_in_cairo_context (cr);
+
+				if (p->have_correlation) {
+					layout->set_font_description (UIConfiguration::instance ().get_SmallFont ());
+					layout->set_text (_("Phase Correlation:"));
+					layout->get_pixel_size (w, h);
+					cr->move_to (rint (nw2 - w * .5), y0[4]);
+					cr->set_source_rgba (.7, .7, .7, 1.0);
+					layout->show_in_cairo_context (cr);
+
+					layout->set_font_description (UIConfiguration::instance ().get_SmallMonospaceFont ());
+					layout->set_text (string_compose ("%1", std::setprecision (2), std::showpos, std::fixed, p->correlation));
+					layout->get_pixel_size (w, h);
+					cr->move_to (rint (nw2 - w * .5), y0[5]);
+					if (p->correlation < 0.f) {
+						cr->set_source_rgba (1.0, .1, .1, 1.0);
+					} else if (p->correlation < .2f) {
+						cr->set_source_rgba (1.0, .7, .1, 1.0);
+					}
+					layout->show_in_cairo_context (cr);
+				}
 			}
 			ebur->flush ();
 
@@ -1888,6 +1888,16 @@ RCOptionEditor::RCOptionEditor ()
 
 	add_option (_("Misc"), new UndoOptions (_rc_config));
 
+	SpinOption<uint32_t>* so = new SpinOption<uint32_t> (
+		"history-memory-budget",
+		_("Keep undo history in memory up to"),
+		sigc::mem_fun (*_rc_config, &RCConfiguration::get_history_memory_budget),
+		sigc::mem_fun (*_rc_config, &RCConfiguration::set_history_memory_budget),
+		0, 4096, 16, 128,
+		_("MB"));
+	Gtkmm2ext::UI::instance()->set_tip (so->tip_widget(), _("Older undo history is moved to disk once it needs more memory than this. 0 keeps it all in memory."));
+	add_option (_("Misc"), so);
+
 	add_option (_("Misc"),
 	     new BoolOption (
 		     "verify-remove-last-capture",
@@ -2534,6 +2544,16 @@ if (!Profile->get_mixbus()) {
 		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_new_plugins_active)
 		     ));
 
+	bo = new BoolOption (
+		     "skip-silent-plugins",
+		     _("Do not run plugins while their input is silent"),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::get_skip_silent_plugins),
+		     sigc::mem_fun (*_rc_config, &RCConfiguration::set_skip_silent_plugins)
+		     );
+	Gtkmm2ext::UI::instance()->set_tip (bo->tip_widget(),
+			_("When enabled, effect plugins stop processing once their input has been silent long enough for their output to have decayed, and resume as soon as the input is no longer silent."));
+	add_option (_("Audio"), bo);
+
 	add_option (_("Audio"), new OptionEditorHeading (_("Regions")));
 
 	add_option (_("Audio"),
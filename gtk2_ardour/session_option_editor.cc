@@ -207,6 +207,15 @@ SessionOptionEditor::SessionOptionEditor (Session* s)
 
 	add_option (_("Media"), hf);
 
+	add_option (_("Media"), new OptionEditorHeading (_("Automation")));
+
+	add_option (_("Media"), new BoolOption (
+			    "automation-event-files",
+			    _("Save automation data in binary files (smaller and faster for dense automation)"),
+			    sigc::mem_fun (*_session_config, &SessionConfiguration::get_automation_event_files),
+			    sigc::mem_fun (*_session_config, &SessionConfiguration::set_automation_event_files)
+			    ));
+
 	add_option (_("Locations"), new OptionEditorHeading (_("File locations")));
 
         SearchPathOption* spo = new SearchPathOption ("audio-search-path", _("Search for audio files in:"),
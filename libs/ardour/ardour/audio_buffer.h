@@ -220,6 +220,15 @@ public:
 	 */
 	bool check_silence (pframes_t nframes, pframes_t& n) const;
 
+	/** check buffer for silence
+	 * @param nframes number of frames to check
+	 * @param threshold largest absolute sample value that counts as silence
+	 * @return true if the buffer is known to be silent, or no sample exceeds @a threshold
+	 */
+	bool is_silent (pframes_t nframes, Sample threshold = 0) const {
+		return _silent || compute_peak (_data, nframes, 0) <= threshold;
+	}
+
 	void prepare () { _written = false; _silent = false; }
 	bool written() const { return _written; }
 	void set_written(bool w) { _written = w; }
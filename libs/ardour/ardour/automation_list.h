@@ -115,6 +115,25 @@ class LIBARDOUR_API AutomationList : public PBD::StatefulDestructible, public Ev
 	XMLNode& state (bool full);
 	XMLNode& serialize_events ();
 
+	/** RAII structure which makes the automation lists that the thread
+	 *  creating it saves or loads use binary event files in a given
+	 *  directory (normally the session's automation directory); without
+	 *  one, events are always stored inline in the XML.
+	 */
+	struct LIBARDOUR_API EventFiles {
+		/** @param write true to have serialize_events() store events in
+		 *  a binary file instead of inline in the XML.
+		 */
+		EventFiles (std::string const & directory, bool write);
+		~EventFiles ();
+
+		std::string const directory;
+		bool const        write;
+
+	  private:
+		EventFiles* _previous;
+	};
+
 	Command* memento_command (XMLNode* before, XMLNode* after);
 
 	bool operator!= (const AutomationList &) const;
@@ -124,6 +143,8 @@ class LIBARDOUR_API AutomationList : public PBD::StatefulDestructible, public Ev
   private:
 	void create_curve_if_necessary ();
 	int deserialize_events (const XMLNode&);
+	int write_event_file (std::string const & directory, std::string& name) const;
+	int read_event_file (std::string const & directory, const std::string& name);
 
 	void maybe_signal_changed ();
 
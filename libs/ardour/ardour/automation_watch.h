@@ -17,11 +17,13 @@
 
 */
 
-#include <set>
+#include <map>
 #include <boost/shared_ptr.hpp>
 #include <glibmm/threads.h>
 #include <sigc++/signal.h>
 
+#include "pbd/rcu.h"
+#include "pbd/ringbuffer.h"
 #include "pbd/signals.h"
 
 #include "ardour/session_handle.h"
@@ -30,6 +32,16 @@ namespace ARDOUR {
 
 class AutomationControl;
 
+/** Records the values of controls that are being written (Write, or
+ *  Touch while touched) into their automation lists while the transport
+ *  rolls.
+ *
+ *  Values are sampled every automation interval without taking any
+ *  locks, and kept in a per-control ringbuffer. They are committed to
+ *  the lists every few intervals (or when the write pass ends), each list
+ *  frozen while its batch is added so that the GUI is told only once.
+ *  Runs of identical values are decimated to their first and last point.
+ */
 class LIBARDOUR_API AutomationWatch : public sigc::trackable, public ARDOUR::SessionHandlePtr, public PBD::ScopedConnectionList {
   public:
     static AutomationWatch& instance();
@@ -41,7 +53,28 @@ class LIBARDOUR_API AutomationWatch : public sigc::trackable, public ARDOUR::Ses
     gint timer ();
 
   private:
-    typedef std::set<boost::shared_ptr<ARDOUR::AutomationControl> > AutomationWatches;
+    struct Sample {
+	    framepos_t when;
+	    double     value;
+    };
+
+    struct Watch {
+	    Watch (boost::shared_ptr<ARDOUR::AutomationControl>);
+
+	    boost::shared_ptr<ARDOUR::AutomationControl> control;
+	    /** written by sample(), read by commit() */
+	    RingBuffer<Sample> samples;
+	    /** zero once removed; anything sampled after that is dropped */
+	    gint active;
+
+	    /* decimation state, only used by commit() */
+	    bool   have_last;
+	    double last_value;
+	    bool   have_held;
+	    Sample held;
+    };
+
+    typedef std::map<boost::shared_ptr<ARDOUR::AutomationControl>, boost::shared_ptr<Watch> > AutomationWatches;
 
     AutomationWatch ();
     ~AutomationWatch();
@@ -50,13 +83,20 @@ class LIBARDOUR_API AutomationWatch : public sigc::trackable, public ARDOUR::Ses
     Glib::Threads::Thread*  _thread;
     framepos_t              _last_time;
     bool                    _run_thread;
-    AutomationWatches        automation_watches;
+    uint32_t                _samples_since_commit;
+    SerializedRCUManager<AutomationWatches> automation_watches;
+    /** serializes commits and write pass changes */
     Glib::Threads::Mutex     automation_watch_lock;
     PBD::ScopedConnection    transport_connection;
 
     void transport_state_change ();
     void remove_weak_automation_watch (boost::weak_ptr<ARDOUR::AutomationControl>);
     void thread ();
+
+    void sample (framepos_t);
+    void commit (Watch&);
+    void flush (Watch&);
+    void commit_all (bool flush);
 };
 
 }
@@ -88,6 +88,7 @@ public:
 	ChanCount&       count()       { return _count; }
 
 	void silence (framecnt_t nframes, framecnt_t offset);
+	bool is_silent (pframes_t nframes, Sample threshold = 0) const;
 	bool is_mirror() const { return _is_mirror; }
 
 	void set_count(const ChanCount& count) { assert(count <= _available); _count = count; }
@@ -137,6 +138,7 @@ public:
 	void read_from(const BufferSet& in, framecnt_t nframes);
 	void read_from(const BufferSet& in, framecnt_t nframes, DataType);
 	void merge_from(const BufferSet& in, framecnt_t nframes);
+	void merge_from(const std::vector<const BufferSet*>& in, framecnt_t nframes);
 
 	template <typename BS, typename B>
 	class iterator_base {
@@ -37,6 +37,8 @@ namespace ARDOUR {
 			, loudness_hist_max (0)
 			, have_loudness (false)
 			, have_dbtp (false)
+			, correlation (0)
+			, have_correlation (false)
 			, norm_gain_factor (1.0)
 			, normalized (false)
 			, n_channels (1)
@@ -55,6 +57,8 @@ namespace ARDOUR {
 			, loudness_hist_max (other.loudness_hist_max)
 			, have_loudness (other.have_loudness)
 			, have_dbtp (other.have_dbtp)
+			, correlation (other.correlation)
+			, have_correlation (other.have_correlation)
 			, norm_gain_factor (other.norm_gain_factor)
 			, normalized (other.normalized)
 			, n_channels (other.n_channels)
@@ -75,6 +79,8 @@ namespace ARDOUR {
 		int loudness_hist_max;
 		bool have_loudness;
 		bool have_dbtp;
+		float correlation; // stereo phase correlation [-1, +1]
+		bool have_correlation;
 		float norm_gain_factor;
 		bool normalized;
 
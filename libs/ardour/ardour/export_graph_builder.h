@@ -27,6 +27,7 @@
 #include "audiographer/utils/identity_vertex.h"
 
 #include <boost/ptr_container/ptr_list.hpp>
+#include <glib.h>
 #include <glibmm/threadpool.h>
 
 namespace AudioGrapher {
@@ -42,6 +43,8 @@ namespace AudioGrapher {
 	template <typename T> class SilenceTrimmer;
 	template <typename T> class TmpFile;
 	template <typename T> class Threader;
+	template <typename T> class AsyncSink;
+	class AsyncSinkStats;
 	template <typename T> class AllocatingProcessContext;
 }
 
@@ -59,7 +62,8 @@ class LIBARDOUR_API ExportGraphBuilder
 	typedef boost::shared_ptr<AudioGrapher::Sink<Sample> > FloatSinkPtr;
 	typedef boost::shared_ptr<AudioGrapher::IdentityVertex<Sample> > IdentityVertexPtr;
 	typedef boost::shared_ptr<AudioGrapher::Analyser> AnalysisPtr;
-	typedef std::map<ExportChannelPtr,  IdentityVertexPtr> ChannelMap;
+	typedef std::map<ExportTimespanPtr, IdentityVertexPtr> TimespanVertexMap;
+	typedef std::map<ExportChannelPtr,  TimespanVertexMap> ChannelMap;
 	typedef std::map<std::string, AnalysisPtr> AnalysisMap;
 
   public:
@@ -67,16 +71,28 @@ class LIBARDOUR_API ExportGraphBuilder
 	ExportGraphBuilder (Session const & session);
 	~ExportGraphBuilder ();
 
-	int process (framecnt_t frames, bool last_cycle);
+	/** Process the @a frames frames of the session starting at @a position.
+	 *  Each channel is read once, and handed to every timespan that covers
+	 *  (a part of) the cycle.
+	 */
+	int process (framepos_t position, framecnt_t frames);
 	bool process_normalize (); // returns true when finished
 	bool will_normalize() { return !normalizers.empty(); }
 	unsigned get_normalize_cycle_count() const;
 
 	void reset ();
 	void cleanup (bool remove_out_files = false);
-	void set_current_timespan (boost::shared_ptr<ExportTimespan> span);
+	/** Set the timespan that following calls to add_config() add to.
+	 *  Configurations can be added for several timespans, which are then
+	 *  exported at the same time.
+	 */
+	void set_current_timespan (ExportTimespanPtr span);
 	void add_config (FileSpec const & config);
 	void get_analysis_results (AnalysisResults& results);
+	/** Add up how often, and for how long (in microseconds), processing had to
+	 *  wait for the encoders that run in the background.
+	 */
+	void get_encoder_stats (uint32_t & stalls, int64_t & stall_time) const;
 
   private:
 
@@ -84,6 +100,12 @@ class LIBARDOUR_API ExportGraphBuilder
 		analysis_map.insert (std::make_pair (fn, ap));
 	}
 
+	typedef boost::shared_ptr<AudioGrapher::AsyncSinkStats> EncoderStatsPtr;
+
+	void add_encoder_stats (EncoderStatsPtr sp) {
+		encoder_stats.push_back (sp);
+	}
+
 	void add_split_config (FileSpec const & config);
 
 	class Encoder {
@@ -93,6 +115,7 @@ class LIBARDOUR_API ExportGraphBuilder
 		void remove_children ();
 		void destroy_writer (bool delete_out_file);
 		bool operator== (FileSpec const & other_config) const;
+		EncoderStatsPtr stats () const;
 
 		static int get_real_format (FileSpec const & config);
 
@@ -100,8 +123,13 @@ class LIBARDOUR_API ExportGraphBuilder
 		typedef boost::shared_ptr<AudioGrapher::SndfileWriter<Sample> > FloatWriterPtr;
 		typedef boost::shared_ptr<AudioGrapher::SndfileWriter<int> >    IntWriterPtr;
 		typedef boost::shared_ptr<AudioGrapher::SndfileWriter<short> >  ShortWriterPtr;
+		typedef boost::shared_ptr<AudioGrapher::AsyncSink<Sample> > FloatAsyncPtr;
+		typedef boost::shared_ptr<AudioGrapher::AsyncSink<int> >    IntAsyncPtr;
+		typedef boost::shared_ptr<AudioGrapher::AsyncSink<short> >  ShortAsyncPtr;
 
-		template<typename T> void init_writer (boost::shared_ptr<AudioGrapher::SndfileWriter<T> > & writer);
+		template<typename T> boost::shared_ptr<AudioGrapher::Sink<T> >
+			init_writer (boost::shared_ptr<AudioGrapher::SndfileWriter<T> > & writer,
+			             boost::shared_ptr<AudioGrapher::AsyncSink<T> > & async);
 		void copy_files (std::string orig_path);
 
 		FileSpec               config;
@@ -114,6 +142,11 @@ class LIBARDOUR_API ExportGraphBuilder
 		FloatWriterPtr float_writer;
 		IntWriterPtr   int_writer;
 		ShortWriterPtr short_writer;
+
+		// Compressed formats are encoded in a thread of their own, fed by one of these
+		FloatAsyncPtr float_async;
+		IntAsyncPtr   int_async;
+		ShortAsyncPtr short_async;
 	};
 
 	// sample format converter
@@ -121,6 +154,10 @@ class LIBARDOUR_API ExportGraphBuilder
             public:
 		// This constructor so that this can be constructed like a Normalizer
 		SFC (ExportGraphBuilder &, FileSpec const & new_config, framecnt_t max_frames);
+		/** Construct a SFC that is fed the same data as its @a siblings, and
+		 *  shares their analysis (if any) rather than analysing the data again.
+		 */
+		SFC (ExportGraphBuilder &, FileSpec const & new_config, framecnt_t max_frames, boost::ptr_list<SFC> const & siblings);
 		FloatSinkPtr sink ();
 		void add_child (FileSpec const & new_config);
 		void remove_children (bool remove_out_files);
@@ -133,6 +170,9 @@ class LIBARDOUR_API ExportGraphBuilder
 		typedef boost::shared_ptr<AudioGrapher::SampleFormatConverter<int> >   IntConverterPtr;
 		typedef boost::shared_ptr<AudioGrapher::SampleFormatConverter<short> > ShortConverterPtr;
 
+		void init (FileSpec const & new_config, framecnt_t max_frames, AnalysisPtr shared_analyser);
+
+		ExportGraphBuilder & parent;
 		FileSpec           config;
 		boost::ptr_list<Encoder> children;
 		int                data_width;
@@ -149,6 +189,7 @@ class LIBARDOUR_API ExportGraphBuilder
 	class Normalizer {
 	                                        public:
 		Normalizer (ExportGraphBuilder & parent, FileSpec const & new_config, framecnt_t max_frames);
+		~Normalizer ();
 		FloatSinkPtr sink ();
 		void add_child (FileSpec const & new_config);
 		void remove_children (bool remove_out_files);
@@ -177,11 +218,18 @@ class LIBARDOUR_API ExportGraphBuilder
 		BufferPtr       buffer;
 		PeakReaderPtr   peak_reader;
 		TmpFilePtr      tmp_file;
+		std::string     tmp_file_path;
 		NormalizerPtr   normalizer;
 		ThreaderPtr     threader;
 		LoudnessReaderPtr    loudness_reader;
 		boost::ptr_list<SFC> children;
 
+		// The intermediate file, mapped for post processing
+		GMappedFile *   mapped_file;
+		Sample const *  mapped_data;
+		framecnt_t      mapped_samples;
+		framecnt_t      mapped_position;
+
 		PBD::ScopedConnection post_processing_connection;
 	};
 
@@ -201,6 +249,9 @@ class LIBARDOUR_API ExportGraphBuilder
 		template<typename T>
 		void add_child_to_list (FileSpec const & new_config, boost::ptr_list<T> & list);
 
+		SFC * create_child (FileSpec const & new_config, boost::ptr_list<SFC> const & siblings);
+		Normalizer * create_child (FileSpec const & new_config, boost::ptr_list<Normalizer> const & siblings);
+
 		ExportGraphBuilder &  parent;
 		FileSpec              config;
 		boost::ptr_list<SFC>  children;
@@ -242,6 +293,7 @@ class LIBARDOUR_API ExportGraphBuilder
 
 		ExportGraphBuilder &      parent;
 		FileSpec                  config;
+		ExportTimespanPtr         timespan;
 		boost::ptr_list<SilenceHandler> children;
 		InterleaverPtr            interleaver;
 		ChunkerPtr                chunker;
@@ -249,13 +301,14 @@ class LIBARDOUR_API ExportGraphBuilder
 	};
 
 	Session const & session;
-	boost::shared_ptr<ExportTimespan> timespan;
+	ExportTimespanPtr timespan;
 
 	// Roots for export processor trees
 	typedef boost::ptr_list<ChannelConfig> ChannelConfigList;
 	ChannelConfigList channel_configs;
 
-	// The sources of all data, each channel is read only once
+	// The sources of all data, each channel is read only once,
+	// even if it is used by several timespans
 	ChannelMap channels;
 
 	framecnt_t process_buffer_frames;
@@ -264,6 +317,8 @@ class LIBARDOUR_API ExportGraphBuilder
 
 	AnalysisMap analysis_map;
 
+	std::list<EncoderStatsPtr> encoder_stats;
+
 	Glib::ThreadPool thread_pool;
 };
 
@@ -21,6 +21,7 @@
 #ifndef __ardour_export_handler_h__
 #define __ardour_export_handler_h__
 
+#include <list>
 #include <map>
 
 #include <boost/operators.hpp>
@@ -29,6 +30,7 @@
 #include "pbd/gstdio_compat.h"
 
 #include "ardour/export_pointers.h"
+#include "ardour/export_segments.h"
 #include "ardour/session.h"
 #include "ardour/libardour_visibility.h"
 #include "ardour/types.h"
@@ -90,6 +92,13 @@ class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::tr
 		ExportFormatSpecPtr    format;
 		ExportFilenamePtr      filename;
 		BroadcastInfoPtr       broadcast_info;
+
+		/* Incremental export: the file to copy unchanged ranges from,
+		   and the ranges (position and length, in frames of the file)
+		*/
+		typedef std::list<std::pair<framecnt_t, framecnt_t> > SpliceList;
+		std::string            splice_path;
+		SpliceList             splice_ranges;
 	};
 
   private:
@@ -126,7 +135,6 @@ class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::tr
 
   private:
 
-	void handle_duplicate_format_extensions();
 	int process (framecnt_t frames);
 
 	Session &          session;
@@ -149,12 +157,42 @@ class LIBARDOUR_API ExportHandler : public ExportElementFactory, public sigc::tr
 	void finish_timespan ();
 
 	typedef std::pair<ConfigMap::iterator, ConfigMap::iterator> TimespanBounds;
-	ExportTimespanPtr     current_timespan;
-	TimespanBounds        timespan_bounds;
+	typedef std::list<ExportTimespanPtr> TimespanList;
+
+	void handle_duplicate_format_extensions (TimespanBounds const & timespan_bounds);
+
+	/* The timespans rendered in the current pass over the session:
+	   all timespans that overlap, or directly follow each other.
+	*/
+	TimespanList          current_timespans;
+	framepos_t            pass_end;
 
 	PBD::ScopedConnection process_connection;
 	framepos_t             process_position;
 
+	/* Incremental export */
+
+	void prepare_incremental_export ();
+	bool compare_with_previous_export (FileSpec const & spec, ExportSegments & segments);
+	void next_render_range ();
+	void update_segments_file (FileSpec const & spec);
+
+	static std::string output_path (FileSpec const & spec);
+	static std::string segments_path (std::string const & path) { return path + ".segments"; }
+	static std::string config_digest (FileSpec const & spec);
+
+	/* The hashes of the current pass, if it is exported incrementally,
+	   the ranges of it that have to be rendered (after the current one),
+	   and the end of the range that is being rendered.
+	*/
+	boost::shared_ptr<ExportSegments> segments;
+	ExportSegments::RangeList         render_ranges;
+	framepos_t                        run_end;
+
+	/* Earlier exports that unchanged ranges are copied from, by output file */
+	typedef std::map<std::string, std::string> PreviousFileMap;
+	PreviousFileMap                   previous_files;
+
 	/* CD Marker stuff */
 
 	struct CDMarkerStatus {
@@ -0,0 +1,109 @@
+/*
+    Copyright (C) 2016 Paul Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_export_segments_h__
+#define __ardour_export_segments_h__
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "ardour/export_pointers.h"
+#include "ardour/libardour_visibility.h"
+#include "ardour/types.h"
+
+class XMLNode;
+
+namespace ARDOUR
+{
+
+class Automatable;
+class Session;
+
+/** Hashes of the session state that each segment of an export timespan
+ *  depends on (regions, automation and the processing of all routes).
+ *  Comparing them with the hashes of an earlier export of the same timespan
+ *  tells which segments have to be rendered again, the others can be copied
+ *  from the earlier render.
+ */
+class LIBARDOUR_API ExportSegments
+{
+  public:
+	/// Ranges of session frames, from the first up to (not including) the second
+	typedef std::list<std::pair<framepos_t, framepos_t> > RangeList;
+
+	/** Hash the state of @a session that affects each segment of @a timespan */
+	ExportSegments (Session & session, ExportTimespanPtr timespan);
+	/** Restore the hashes of an earlier export */
+	ExportSegments (XMLNode const & node);
+
+	XMLNode & get_state () const;
+
+	framecnt_t length () const { return _end - _start; }
+
+	/** Mark all segments that are not the same in @a previous as changed.
+	 *  Can be called for several earlier exports, a segment is changed if
+	 *  it is changed in any of them.
+	 */
+	void compare (ExportSegments const & previous);
+	/** Mark the last segment as changed, so that the end of the timespan is always rendered */
+	void change_last ();
+
+	RangeList changed_ranges () const { return ranges (true); }
+	RangeList unchanged_ranges () const { return ranges (false); }
+
+	/** Check whether the processing of @a session depends only on the
+	 *  position, and not on what was processed before. Plugins are taken
+	 *  to do so only if they have no latency and report a tail length
+	 *  of zero.
+	 *  @return true if so, otherwise false, and @a reason tells why not
+	 */
+	static bool deterministic (Session & session, std::string & reason);
+
+	/** Check whether files of @a format can be put together from several renders,
+	 *  sample by sample.
+	 *  @return true if so, otherwise false, and @a reason tells why not
+	 */
+	static bool spliceable (Session const & session, ExportFormatSpecification const & format, std::string & reason);
+
+	/** Hash of the contents of @a node, ignoring GUI state */
+	static std::string digest (XMLNode const & node);
+
+  private:
+	framepos_t segment_start (uint32_t segment) const { return _start + segment * _segment_frames; }
+	framepos_t segment_end (uint32_t segment) const { return std::min (_end, segment_start (segment + 1)); }
+
+	void add_automation (Automatable const & automatable, std::string const & owner, std::vector<std::string> & state) const;
+	RangeList ranges (bool changed) const;
+
+	static const int segment_seconds = 10;
+
+	framepos_t  _start;
+	framepos_t  _end;
+	framecnt_t  _segment_frames;
+	std::string _chain;
+
+	std::vector<std::string> _hashes;
+	std::vector<bool>        _changed;
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_export_segments_h__ */
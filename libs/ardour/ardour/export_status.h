@@ -80,6 +80,13 @@ class LIBARDOUR_API ExportStatus {
 	volatile uint32_t       total_normalize_cycles;
 	volatile uint32_t       current_normalize_cycle;
 
+	/* Back-pressure of the encoders that run in the background:
+	 * how often, and for how long (in microseconds), processing
+	 * had to wait for them to catch up
+	 */
+	volatile uint32_t       encoder_stalls;
+	volatile int64_t        encoder_stall_time;
+
 	AnalysisResults         result_map;
 
   private:
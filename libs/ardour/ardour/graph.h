@@ -52,6 +52,30 @@ typedef boost::shared_ptr<GraphNode> node_ptr_t;
 typedef std::list< node_ptr_t > node_list_t;
 typedef std::set< node_ptr_t > node_set_t;
 
+/** A piece of work that a graph node splits off while it is being
+ *  processed, so that idle graph threads can help (see Graph::run_tasks).
+ */
+class LIBARDOUR_API GraphTask
+{
+public:
+	GraphTask () : _leader (0), _unfinished (0), _done ("graph_task_done", 0) {}
+	virtual ~GraphTask () {}
+
+	virtual void run () = 0;
+
+private:
+	friend class Graph;
+
+	/** the first task of the run_tasks() call this task belongs to */
+	GraphTask* _leader;
+	/** for a leader: the number of queued tasks of its call that have not finished */
+	volatile gint _unfinished;
+	/** for a leader: signalled when the last of them has finished */
+	PBD::Semaphore _done;
+
+	void finished ();
+};
+
 class LIBARDOUR_API Graph : public SessionHandleRef
 {
 public:
@@ -81,6 +105,8 @@ public:
 
 	void process_one_route (Route * route);
 
+	void run_tasks (GraphTask* const * tasks, uint32_t n_tasks);
+
 	void clear_other_chain ();
 
 	bool in_process_thread () const;
@@ -99,6 +125,7 @@ private:
 	node_list_t _init_trigger_list[2];
 
 	std::vector<GraphNode *> _trigger_queue;
+	std::vector<GraphTask *> _task_queue;
 	pthread_mutex_t          _trigger_mutex;
 
 	PBD::Semaphore _execution_sem;
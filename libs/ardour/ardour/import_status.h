@@ -50,6 +50,8 @@ public:
 
 	/* result */
 	SourceList sources;
+	/** the number of sources in sources that came from each of paths, in order */
+	std::vector<size_t> sources_per_path;
 };
 
 } // namespace ARDOUR
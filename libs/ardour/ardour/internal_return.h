@@ -49,6 +49,10 @@ class LIBARDOUR_API InternalReturn : public Return
 	std::list<InternalSend*> _sends;
 	/** mutex to protect _sends */
 	Glib::Threads::Mutex _sends_mutex;
+	/** buffers of the sends that are active in the current cycle;
+	 *  capacity is reserved in add_send() so run() does not allocate.
+	 */
+	std::vector<const BufferSet*> _send_buffers;
 };
 
 } // namespace ARDOUR
@@ -57,6 +57,7 @@ public:
 
 	bool insert_event(const Evoral::MIDIEvent<TimeType>& event);
 	bool merge_in_place(const MidiBuffer &other);
+	bool merge_in_place(const MidiBuffer* const* others, size_t n_others);
 
 	/** EventSink interface for non-RT use (export, bounce). */
 	uint32_t write(TimeType time, Evoral::EventType type, uint32_t size, const uint8_t* buf);
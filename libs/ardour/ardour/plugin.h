@@ -230,6 +230,12 @@ class LIBARDOUR_API Plugin : public PBD::StatefulDestructible, public Latent
 	/** the max possible latency a plugin will have */
 	virtual framecnt_t max_latency () const { return 0; } // TODO = 0, require implementation
 
+	/** @return the number of samples the plugin may keep producing output
+	 * after its input became silent, or -1 if the plugin does not say
+	 * (PluginInsert then watches the output instead).
+	 */
+	virtual framecnt_t signal_tail_length () const { return -1; }
+
 	/** Emitted when a preset is added or removed, respectively */
 	PBD::Signal0<void> PresetAdded;
 	PBD::Signal0<void> PresetRemoved;
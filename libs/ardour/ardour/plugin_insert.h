@@ -44,6 +44,7 @@ namespace ARDOUR {
 class Session;
 class Route;
 class Plugin;
+class GraphTask;
 
 /** Plugin inserts: send data through a plugin
  */
@@ -329,6 +330,7 @@ class LIBARDOUR_API PluginInsert : public Processor
 	bool _strict_io;
 	bool _custom_cfg;
 	bool _maps_from_state;
+	bool _parallel_replicas;
 	bool _mapping_changed;
 
 	Match private_can_support_io_configuration (ChanCount const &, ChanCount &) const;
@@ -348,6 +350,12 @@ class LIBARDOUR_API PluginInsert : public Processor
 	void bypass (BufferSet& bufs, pframes_t nframes);
 	void inplace_silence_unconnected (BufferSet&, const PinMappings&, framecnt_t nframes, framecnt_t offset) const;
 
+	/** one task per replicated plugin instance, used to run them in parallel */
+	std::vector<GraphTask*> _replica_tasks;
+	bool replicas_are_independent () const;
+	void setup_replica_tasks ();
+	void drop_replica_tasks ();
+
 	void create_automatable_parameters ();
 	void control_list_automation_state_changed (Evoral::Parameter, AutoState);
 	void set_parameter_state_2X (const XMLNode& node, int version);
@@ -361,6 +369,16 @@ class LIBARDOUR_API PluginInsert : public Processor
 
 	void latency_changed (framecnt_t, framecnt_t);
 	bool _latency_changed;
+
+	/* skipping the plugin(s) while their input is silent */
+	bool       _may_sleep;  ///< output only depends on the audio input
+	bool       _sleeping;   ///< input is silent, and the tail has decayed
+	gint       _wake_up;    ///< atomic, set by wake_up()
+	framecnt_t _tail_length; ///< as reported by the plugin, -1 if unknown
+	framecnt_t _silent_input_frames;
+	framecnt_t _silent_output_frames;
+
+	void wake_up ();
 };
 
 } // namespace ARDOUR
@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2016 Paul Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_plugin_pool_h__
+#define __ardour_plugin_pool_h__
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <glibmm/threads.h>
+
+#include "ardour/libardour_visibility.h"
+#include "ardour/plugin.h"
+#include "ardour/types.h"
+
+class XMLNode;
+
+namespace ARDOUR {
+
+class Session;
+
+/** A session's store of ready-made plugin instances.
+ *
+ *  Instantiating a plugin can take a long time. While a session is being
+ *  loaded, the plugins used by its routes are instantiated in the background
+ *  (see preinstantiate()), and the instances of plugin inserts that go away
+ *  are kept for a while (see keep()), so that an insert re-created from its
+ *  state (paste, undo, route templates) does not have to wait for them.
+ *  Kept instances are dropped when they are max_age old (see expire()), when
+ *  there are more than max_kept of them, and when the session is saved.
+ *
+ *  Only PluginInsert::set_state() takes instances from the pool: it restores
+ *  the complete plugin state, so it does not matter where an instance came from.
+ */
+class LIBARDOUR_API PluginPool
+{
+  public:
+	PluginPool (Session&);
+	~PluginPool ();
+
+	/** Start instantiating the plugins used by the routes in @param routes
+	 *  (a session's "Routes" node) in the background.
+	 */
+	void preinstantiate (XMLNode const & routes, int version);
+
+	/** Wait until all background instantiation has finished. This must be
+	 *  called before anything else creates plugins of the same kind.
+	 */
+	void wait ();
+
+	/** @return an idle instance of the given plugin, or 0 if there is none */
+	PluginPtr take (PluginType, std::string const & unique_id);
+
+	/** Keep a no longer used (and otherwise unreferenced) plugin instance
+	 *  for later use. Only the most recent max_kept instances are retained.
+	 */
+	void keep (PluginPtr);
+
+	/** Drop instances that were kept more than max_age ago */
+	void expire ();
+
+	/** Drop all instances */
+	void clear ();
+
+	static const size_t max_kept = 16;
+	static const gint64 max_age = 120 * G_USEC_PER_SEC;
+
+	/** @return true if plugins of type @param t can be instantiated outside
+	 *  of the GUI thread while the session is loading.
+	 */
+	static bool can_preinstantiate (PluginType t);
+
+  private:
+	struct Job {
+		Job (PluginType t, std::string const & id) : type (t), unique_id (id) {}
+		PluginType  type;
+		std::string unique_id;
+	};
+
+	struct Entry {
+		Entry (PluginType t, std::string const & id, PluginPtr p)
+			: type (t), unique_id (id), plugin (p), kept (g_get_monotonic_time ()) {}
+		PluginType  type;
+		std::string unique_id;
+		PluginPtr   plugin;
+		gint64      kept;
+	};
+
+	typedef std::list<Entry> Entries;
+
+	Session&                            _session;
+	Entries                             _entries;
+	Glib::Threads::Mutex                _lock;
+
+	std::vector<Job>                    _jobs;
+	size_t                              _next_job;
+	std::vector<Glib::Threads::Thread*> _threads;
+	Glib::Threads::Mutex                _job_lock;
+	Glib::Threads::Mutex                _ladspa_lock;
+	Glib::Threads::Mutex                _lv2_lock;
+
+	void thread_work ();
+	Glib::Threads::Mutex& instantiation_lock (PluginType);
+	void expire_locked (Entries& dropped);
+	void add (PluginType, std::string const & unique_id, PluginPtr);
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_plugin_pool_h__ */
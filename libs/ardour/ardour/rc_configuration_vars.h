@@ -208,6 +208,7 @@ CONFIG_VARIABLE (bool, verify_remove_last_capture, "verify-remove-last-capture",
 CONFIG_VARIABLE (bool, save_history, "save-history", true)
 CONFIG_VARIABLE (int32_t, saved_history_depth, "save-history-depth", 20)
 CONFIG_VARIABLE (int32_t, history_depth, "history-depth", 20)
+CONFIG_VARIABLE (uint32_t, history_memory_budget, "history-memory-budget", 256) /* MB, 0 for no limit */
 CONFIG_VARIABLE (bool, use_overlap_equivalency, "use-overlap-equivalency", false)
 CONFIG_VARIABLE (bool, periodic_safety_backups, "periodic-safety-backups", true)
 CONFIG_VARIABLE (uint32_t, periodic_safety_backup_interval, "periodic-safety-backup-interval", 120)
@@ -232,6 +233,7 @@ CONFIG_VARIABLE (EditMode, edit_mode, "edit-mode", Slide)
 /* plugin related */
 
 CONFIG_VARIABLE (bool, new_plugins_active, "new-plugins-active", true)
+CONFIG_VARIABLE (bool, skip_silent_plugins, "skip-silent-plugins", false)
 CONFIG_VARIABLE (bool, use_plugin_own_gui, "use-plugin-own-gui", true)
 CONFIG_VARIABLE (bool, use_windows_vst, "use-windows-vst", true)
 CONFIG_VARIABLE (bool, use_lxvst, "use-lxvst", true)
@@ -276,4 +278,5 @@ CONFIG_VARIABLE (bool, show_video_export_info, "show-video-export-info", true)
 CONFIG_VARIABLE (bool, show_video_server_dialog, "show-video-server-dialog", false)
 
 CONFIG_VARIABLE (float, export_preroll, "export-preroll", 10.0) // seconds
+CONFIG_VARIABLE (bool, incremental_export, "incremental-export", false)
 CONFIG_VARIABLE (float, export_silence_threshold, "export-silence-threshold", -INFINITY) // dB
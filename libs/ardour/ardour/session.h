@@ -129,6 +129,7 @@ class MidiTrack;
 class Playlist;
 class PluginInsert;
 class PluginInfo;
+class PluginPool;
 class Port;
 class PortInsert;
 class ProcessThread;
@@ -251,6 +252,9 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 
 	void process (pframes_t nframes);
 
+	/** @return the graph that processes routes on several threads, or 0 */
+	Graph* process_graph () const { return _process_graph.get (); }
+
 	BufferSet& get_silent_buffers (ChanCount count = ChanCount::ZERO);
 	BufferSet& get_noinplace_buffers (ChanCount count = ChanCount::ZERO);
 	BufferSet& get_scratch_buffers (ChanCount count = ChanCount::ZERO, bool silence = true);
@@ -264,6 +268,7 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 
 	void refill_all_track_buffers ();
 	Butler* butler() { return _butler; }
+	PluginPool& plugin_pool () { return *_plugin_pool; }
 	void butler_transport_work ();
 
 	void refresh_disk_space ();
@@ -495,6 +500,7 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	 * @return zero on success
 	 */
 	int save_state (std::string snapshot_name, bool pending = false, bool switch_to_snapshot = false, bool template_only = false);
+	int save_state_in_background (std::string snapshot_name, bool pending = false);
 	int restore_state (std::string snapshot_name);
 	int save_template (std::string template_name, bool replace_existing = false);
 	int save_history (std::string snapshot_name = "");
@@ -508,6 +514,12 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	bool save_default_options ();
 
 	PBD::Signal1<void,std::string> StateSaved;
+	/** Emitted when a save started by save_state_in_background() has
+	 *  finished; the bool is true on success. This happens in the thread
+	 *  which next saves the session, calls maybe_write_autosave() or
+	 *  destroys the session.
+	 */
+	PBD::Signal2<void,std::string,bool> StateSaveFinished;
 	PBD::Signal0<void> StateReady;
 
 	/* emitted when session needs to be saved due to some internal
@@ -700,6 +712,7 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	boost::shared_ptr<ExportStatus> get_export_status ();
 
 	int start_audio_export (framepos_t position);
+	int relocate_audio_export (framepos_t position);
 
 	PBD::Signal1<int, framecnt_t> ProcessExport;
 	static PBD::Signal2<void,std::string, std::string> Exported;
@@ -1337,7 +1350,33 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	friend class    StateProtector;
 	gint            _suspend_save; /* atomic */
 	volatile bool   _save_queued;
+	struct SavedState;
+	Glib::Threads::Thread* _save_thread;
+	SavedState*            _background_save;
+	gint                   _background_save_done; /* atomic */
 	Glib::Threads::Mutex save_state_lock;
+
+	/** State to be written by write_state() */
+	struct SavedState {
+		SavedState () : pending (false), state (0), history (0), start_time (0), written (false) {}
+		~SavedState ();
+
+		std::string snapshot_name;
+		bool        pending;
+		XMLTree*    state;
+		XMLTree*    history;
+		int64_t     start_time;
+		bool        written;
+		Transmitter::Capture::Messages messages; ///< from writing it in the background
+	};
+
+	int  capture_state (std::string snapshot_name, bool pending, bool switch_to_snapshot, bool template_only, SavedState&);
+	int  write_state (SavedState&);
+	void state_written (SavedState const &);
+	void background_save (SavedState*);
+	void wait_for_background_save ();
+	bool should_save_history () const;
+	int  write_history (XMLTree&, std::string snapshot_name);
 	Glib::Threads::Mutex peak_cleanup_lock;
 
 	int      load_options (const XMLNode&);
@@ -1370,6 +1409,7 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	void try_run_lua (pframes_t);
 
 	Butler* _butler;
+	PluginPool* _plugin_pool;
 
 	static const PostTransportWork ProcessCannotProceedMask =
 		PostTransportWork (
@@ -1877,6 +1917,7 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 
 	int find_all_sources (std::string path, std::set<std::string>& result);
 	int find_all_sources_across_snapshots (std::set<std::string>& result, bool exclude_this_snapshot);
+	void cleanup_automation_event_files ();
 
 	typedef std::set<boost::shared_ptr<PBD::Controllable> > Controllables;
 	Glib::Threads::Mutex controllables_lock;
@@ -1893,6 +1934,11 @@ class LIBARDOUR_API Session : public PBD::StatefulDestructible, public PBD::Scop
 	XMLNode& get_control_protocol_state ();
 
 	void set_history_depth (uint32_t depth);
+	void set_history_memory_budget (uint32_t megabytes);
+	std::string history_spill_dir ();
+	UndoTransaction* undo_transaction_from_state (XMLNode const &);
+
+	std::string _history_spill_dir;
 
 	static bool _disable_all_loaded_plugins;
 	static bool _bypass_all_loaded_plugins;
@@ -76,6 +76,7 @@ CONFIG_VARIABLE (bool, show_solo_on_meterbridge, "show-solo-on-meterbridge", fal
 CONFIG_VARIABLE (bool, show_monitor_on_meterbridge, "show-monitor-on-meterbridge", false)
 CONFIG_VARIABLE (bool, show_name_on_meterbridge, "show-name-on-meterbridge", true)
 CONFIG_VARIABLE (uint32_t, meterbridge_label_height,  "meterbridge-label-height", 0)
+CONFIG_VARIABLE (bool, automation_event_files, "automation-event-files", false)
 
 #ifdef USE_TRACKS_CODE_FEATURES
 /* This variable was not discussed with Ardour developers and is considered
@@ -94,6 +94,12 @@ public:
 	 */
 	const std::string video_path () const;
 
+	/**
+	 * @return The absolute path to the directory in which
+	 * automation data is stored for a session.
+	 */
+	const std::string automation_path () const;
+
 	/**
 	 * @return The absolute path to the directory that source
 	 * files are moved to when they are no longer part of the
@@ -23,6 +23,7 @@
 
 #include <cstdio>
 #include <time.h>
+#include "evoral/MappedSMF.hpp"
 #include "evoral/SMF.hpp"
 #include "ardour/midi_source.h"
 #include "ardour/file_source.h"
@@ -69,6 +70,16 @@ public:
 	static bool safe_midi_file_extension (const std::string& path);
 	static bool valid_midi_file (const std::string& path);
 
+	/* these hide the Evoral::SMF versions, which only work once the
+	 * file has been loaded through libsmf (see open_for_read()).
+	 */
+	uint16_t num_tracks () const;
+	uint16_t ppqn () const;
+	bool     is_empty () const;
+
+	bool       empty () const;
+	framecnt_t length (framepos_t pos) const;
+
 	void prevent_deletion ();
 
   protected:
@@ -85,7 +96,28 @@ public:
 	/** time (in SMF ticks, 1 tick per _ppqn) of the last event read by read_unlocked */
 	mutable framepos_t _smf_last_read_time;
 
+	/** Existing files are opened for reading through a memory-mapped
+	 * reader; libsmf only loads the file once it is about to be written.
+	 */
+	Evoral::MappedSMF                 _mapped;
+	mutable Evoral::MappedSMF::Cursor _mapped_cursor;
+	/** true if the length of a mapped file has not been found yet */
+	mutable bool                      _length_pending;
+
+	int open_for_read ();
 	int open_for_write ();
+	int ensure_smf_loaded ();
+	void ensure_length () const;
+
+	int seek_track (Evoral::MappedSMF::Cursor&, int track);
+	int read_track_event (Evoral::MappedSMF::Cursor&, uint32_t* delta_t, uint32_t* size, uint8_t** buf, Evoral::event_id_t* note_id) const;
+
+	framecnt_t read_mapped (Evoral::EventSink<framepos_t>& dst,
+	                        framepos_t                     position,
+	                        framepos_t                     start,
+	                        framecnt_t                     cnt,
+	                        MidiStateTracker*              tracker,
+	                        MidiChannelFilter*             filter) const;
 
 	void ensure_disk_file (const Lock& lock);
 
@@ -42,7 +42,7 @@ class LIBARDOUR_API SourceFactory {
 
 	static PBD::Signal1<void,boost::shared_ptr<Source> > SourceCreated;
 
-	static boost::shared_ptr<Source> create (Session&, const XMLNode& node, bool async = false);
+	static boost::shared_ptr<Source> create (Session&, const XMLNode& node, bool async = false, bool announce = true);
 	static boost::shared_ptr<Source> createSilent (Session&, const XMLNode& node,
 	                                               framecnt_t nframes, float sample_rate);
 
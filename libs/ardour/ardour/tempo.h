@@ -234,10 +234,14 @@ class LIBARDOUR_API TempoMap : public PBD::StatefulDestructible
 		const TempoSection* tempo;
 		uint32_t            bar;
 		uint32_t            beat;
+		/** unrounded position, so that the map can be regenerated
+		    from this point with the same result as from the start.
+		*/
+		double              exact_frame;
 
-		BBTPoint (const MeterSection& m, const TempoSection& t, framepos_t f,
+		BBTPoint (const MeterSection& m, const TempoSection& t, double f,
 		          uint32_t b, uint32_t e)
-			: frame (f), meter (&m), tempo (&t), bar (b), beat (e) {}
+			: frame (llrint (f)), meter (&m), tempo (&t), bar (b), beat (e), exact_frame (f) {}
 
 		Timecode::BBT_Time bbt() const { return Timecode::BBT_Time (bar, beat, 0); }
 		operator Timecode::BBT_Time() const { return bbt(); }
@@ -354,13 +358,48 @@ class LIBARDOUR_API TempoMap : public PBD::StatefulDestructible
 	mutable Glib::Threads::RWLock lock;
 	BBTPointList                  _map;
 
+	/* Lookup tables over `metrics', rebuilt whenever sections are
+	   added, removed or (re)positioned, so that conversions can binary
+	   search instead of walking the list. They are only used when
+	   section positions are in order, which is the case except
+	   transiently during edits.
+	*/
+
+	struct MetricIndexEntry {
+		framepos_t              frame;
+		Timecode::BBT_Time      start;
+		const TempoSection*     tempo; ///< tempo in effect from this section on
+		const MeterSection*     meter; ///< meter in effect from this section on
+		Metrics::const_iterator iter;
+	};
+
+	struct TempoIndexEntry {
+		framepos_t          frame;
+		const TempoSection* tempo;
+		/** frames per beat, truncated as the beat walking code always did */
+		uint32_t            frames_per_beat;
+		/** beats from the first tempo section to this one */
+		double              beats;
+	};
+
+	std::vector<MetricIndexEntry> _metric_index;
+	std::vector<TempoIndexEntry>  _tempo_index;
+	bool                          _index_frames_ordered;
+	bool                          _index_bbt_ordered;
+
+	void rebuild_index ();
+	const MetricIndexEntry* metric_index_at (framepos_t) const;
+	size_t tempo_index_at (framepos_t) const;
+
 	void recompute_map (bool reassign_tempo_bbt, framepos_t end = -1);
+	void recompute_map_from (const Timecode::BBT_Time& changed, bool reassign_tempo_bbt);
+	void reassign_tempo_bbt_from_bar_offsets ();
 	void extend_map (framepos_t end);
 	void require_map_to (framepos_t pos);
 	void require_map_to (const Timecode::BBT_Time&);
 	void _extend_map (TempoSection* tempo, MeterSection* meter,
 	                  Metrics::iterator next_metric,
-	                  Timecode::BBT_Time current, framepos_t current_frame, framepos_t end);
+	                  Timecode::BBT_Time current, double current_frame_exact, framepos_t end);
 
 	BBTPointList::const_iterator bbt_before_or_at (framepos_t);
 	BBTPointList::const_iterator bbt_before_or_at (const Timecode::BBT_Time&);
@@ -23,6 +23,9 @@
 
 #include "ardour/libardour_visibility.h"
 #include "ardour/vst_types.h"
+#include <cstdio>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 /* Cache File extensions */
@@ -35,9 +38,11 @@
 # if ( defined(__x86_64__) || defined(_M_X64) )
 #define VST_EXT_INFOFILE  ".fsi64"
 #define VST_BLACKLIST  "vst64_blacklist.txt"
+#define VST_SCAN_DB  "vst64_scan.db"
 #else
 #define VST_EXT_INFOFILE  ".fsi32"
 #define VST_BLACKLIST  "vst32_blacklist.txt"
+#define VST_SCAN_DB  "vst32_scan.db"
 #endif
 
 #ifndef VST_SCANNER_APP
@@ -60,6 +65,17 @@ LIBARDOUR_API extern std::vector<VSTInfo*> * vstfx_get_info_lx (char *, enum VST
 LIBARDOUR_API extern std::vector<VSTInfo*> * vstfx_get_info_fst (char *, enum VSTScanMode mode = VST_SCAN_USE_APP);
 #endif
 
+#ifndef VST_SCANNER_APP
+LIBARDOUR_API extern void vstfx_scan_parallel (std::vector<std::string> const & dllpaths);
+LIBARDOUR_API extern void vstfx_save_scan_db ();
+LIBARDOUR_API extern void vstfx_clear_scan_db ();
+
+/* one scan database record: the path of a plugin binary, its mtime and the
+ * info of every plugin in it (for a shell, the shell's own first) */
+LIBARDOUR_API extern bool vstfx_write_scan_record (FILE*, std::string const & dllpath, int64_t mtime, std::vector<VSTInfo*> const & infos);
+LIBARDOUR_API extern bool vstfx_read_scan_record (FILE*, std::string& dllpath, int64_t& mtime, std::vector<VSTInfo*>& infos);
+#endif
+
 #ifndef VST_SCANNER_APP
 } // namespace
 #endif
@@ -54,6 +54,7 @@ public:
 	int get_parameter_descriptor (uint32_t which, ParameterDescriptor&) const;
 	std::string describe_parameter (Evoral::Parameter);
 	framecnt_t signal_latency() const;
+	framecnt_t signal_tail_length () const;
 	std::set<Evoral::Parameter> automatable() const;
 
 	bool parameter_is_audio (uint32_t) const { return false; }
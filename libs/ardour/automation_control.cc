@@ -159,15 +159,18 @@ AutomationControl::stop_touch(bool mark, double when)
 {
 	if (!_list) return;
 	if (touching()) {
-		set_touching (false);
 
 		if (alist()->automation_state() == Touch) {
-			alist()->stop_touch (mark, when);
 			if (!_desc.toggled) {
+				/* the watch flushes what it sampled during the touch,
+				   which has to be added before the touch ends.
+				*/
 				AutomationWatch::instance().remove_automation_watch (shared_from_this());
-
 			}
+			alist()->stop_touch (mark, when);
 		}
+
+		set_touching (false);
 	}
 }
 
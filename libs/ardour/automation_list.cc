@@ -23,6 +23,12 @@
 #include <cmath>
 #include <sstream>
 #include <algorithm>
+#include <cstring>
+
+#include <glib.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
 #include "ardour/automation_list.h"
 #include "ardour/event_type_map.h"
 #include "ardour/parameter_descriptor.h"
@@ -30,6 +36,8 @@
 #include "pbd/memento_command.h"
 #include "pbd/stacktrace.h"
 #include "pbd/enumwriter.h"
+#include "pbd/compose.h"
+#include "pbd/error.h"
 
 #include "i18n.h"
 
@@ -39,6 +47,103 @@ using namespace PBD;
 
 PBD::Signal1<void,AutomationList *> AutomationList::AutomationListCreated;
 
+static void do_not_delete_the_event_files (void*) { }
+static Glib::Threads::Private<AutomationList::EventFiles> thread_event_files (do_not_delete_the_event_files);
+
+AutomationList::EventFiles::EventFiles (std::string const & d, bool w)
+	: directory (d)
+	, write (w)
+	, _previous (thread_event_files.get ())
+{
+	thread_event_files.set (this);
+}
+
+AutomationList::EventFiles::~EventFiles ()
+{
+	thread_event_files.set (_previous);
+}
+
+/* Binary event files
+ *
+ *   "AEVT" <version:1 byte> <flags:1 byte> <number of points:varint>
+ *
+ * followed by the points. If the IntegralTimes flag is set, the time of
+ * each point is stored as the (zigzag-encoded) varint difference to the
+ * previous time, otherwise as 8 raw bytes. Values are stored as the varint
+ * of their bits XOR the bits of the previous value, so a repeated value
+ * takes one byte. Multi-byte quantities are little-endian.
+ *
+ * Files are named after the list's ID and a hash of their contents: they
+ * are never rewritten, so every snapshot (and pending state) refers to
+ * exactly the data it was saved with.
+ */
+
+static const char     event_file_magic[4] = { 'A', 'E', 'V', 'T' };
+static const uint8_t  event_file_version  = 1;
+static const uint8_t  IntegralTimes       = 0x1;
+
+static inline uint64_t
+double_bits (double d)
+{
+	uint64_t b;
+	memcpy (&b, &d, sizeof (b));
+	return b;
+}
+
+static inline double
+bits_double (uint64_t b)
+{
+	double d;
+	memcpy (&d, &b, sizeof (d));
+	return d;
+}
+
+static inline void
+put_varint (std::vector<uint8_t>& out, uint64_t v)
+{
+	while (v >= 0x80) {
+		out.push_back ((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	out.push_back (v);
+}
+
+static inline bool
+get_varint (const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+	v = 0;
+	for (int shift = 0; shift < 64 && p < end; shift += 7) {
+		const uint8_t c = *p++;
+		v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline void
+put_raw (std::vector<uint8_t>& out, uint64_t v)
+{
+	for (int n = 0; n < 8; ++n, v >>= 8) {
+		out.push_back (v & 0xff);
+	}
+}
+
+static inline bool
+get_raw (const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+	if (end - p < 8) {
+		return false;
+	}
+	v = 0;
+	for (int n = 7; n >= 0; --n) {
+		v = (v << 8) | p[n];
+	}
+	p += 8;
+	return true;
+}
+
 #if 0
 static void dumpit (const AutomationList& al, string prefix = "")
 {
@@ -349,6 +454,17 @@ XMLNode&
 AutomationList::serialize_events ()
 {
 	XMLNode* node = new XMLNode (X_("events"));
+	EventFiles const * files = thread_event_files.get ();
+
+	if (files && files->write) {
+		string name;
+		if (write_event_file (files->directory, name) == 0) {
+			node->add_property (X_("file"), name);
+			return *node;
+		}
+		/* store them inline instead */
+	}
+
 	stringstream str;
 
 	str.precision(15);  //10 digits is enough digits for 24 hours at 96kHz
@@ -370,9 +486,160 @@ AutomationList::serialize_events ()
 	return *node;
 }
 
+/** Write our events to a binary file in @a directory, unless
+ *  an identical file is already there.
+ *  @param name Filled in with the name of the file.
+ */
+int
+AutomationList::write_event_file (string const & directory, string& name) const
+{
+	std::vector<uint8_t> data;
+	uint8_t flags = IntegralTimes;
+
+	for (const_iterator i = _events.begin(); i != _events.end(); ++i) {
+		if ((*i)->when != rint ((*i)->when) || fabs ((*i)->when) > (double) (1LL << 52)) {
+			flags &= ~IntegralTimes;
+			break;
+		}
+	}
+
+	data.reserve (16 + _events.size() * 4);
+	data.insert (data.end(), event_file_magic, event_file_magic + sizeof (event_file_magic));
+	data.push_back (event_file_version);
+	data.push_back (flags);
+	put_varint (data, _events.size());
+
+	int64_t  last_when  = 0;
+	uint64_t last_value = 0;
+
+	for (const_iterator i = _events.begin(); i != _events.end(); ++i) {
+		if (flags & IntegralTimes) {
+			const int64_t when  = (int64_t) (*i)->when;
+			const int64_t delta = when - last_when;
+			put_varint (data, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+			last_when = when;
+		} else {
+			put_raw (data, double_bits ((*i)->when));
+		}
+
+		const uint64_t value = double_bits ((*i)->value);
+		put_varint (data, value ^ last_value);
+		last_value = value;
+	}
+
+	/* 64 bit FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	for (std::vector<uint8_t>::const_iterator b = data.begin(); b != data.end(); ++b) {
+		hash = (hash ^ *b) * 1099511628211ULL;
+	}
+
+	char buf[32];
+	snprintf (buf, sizeof (buf), "%016llx", (unsigned long long) hash);
+	name = string_compose (X_("%1-%2.events"), id().to_s(), buf);
+
+	const string path = Glib::build_filename (directory, name);
+
+	if (Glib::file_test (path, Glib::FILE_TEST_EXISTS)) {
+		return 0;
+	}
+
+	GError* err = 0;
+
+	/* this writes a temporary file first, so there is never a partial file */
+	if (!g_file_set_contents (path.c_str(), (const gchar*) &data[0], data.size(), &err)) {
+		error << string_compose (_("Could not write automation data to %1 (%2)"), path, err->message) << endmsg;
+		g_error_free (err);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+AutomationList::read_event_file (string const & directory, const string& name)
+{
+	const string path = Glib::build_filename (directory, name);
+	GError* err = 0;
+	GMappedFile* file = g_mapped_file_new (path.c_str(), false, &err);
+
+	if (!file) {
+		error << string_compose (_("Could not read automation data from %1 (%2)"), path, err ? err->message : "") << endmsg;
+		if (err) {
+			g_error_free (err);
+		}
+		return -1;
+	}
+
+	const uint8_t* p   = (const uint8_t*) g_mapped_file_get_contents (file);
+	const uint8_t* end = p + g_mapped_file_get_length (file);
+	bool ok = false;
+
+	ControlList::freeze ();
+	clear ();
+
+	if (end - p >= 6 && !memcmp (p, event_file_magic, sizeof (event_file_magic)) && p[4] == event_file_version) {
+
+		const uint8_t flags = p[5];
+		uint64_t n_points;
+
+		p += 6;
+		ok = get_varint (p, end, n_points);
+
+		int64_t  when       = 0;
+		uint64_t last_value = 0;
+
+		for (uint64_t n = 0; ok && n < n_points; ++n) {
+			uint64_t v;
+			double   x;
+
+			if (flags & IntegralTimes) {
+				ok = get_varint (p, end, v);
+				when += (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+				x = when;
+			} else {
+				ok = get_raw (p, end, v);
+				x = bits_double (v);
+			}
+
+			if (ok && (ok = get_varint (p, end, v))) {
+				last_value ^= v;
+				fast_simple_add (x, bits_double (last_value));
+			}
+		}
+	}
+
+	g_mapped_file_unref (file);
+
+	/* trailing bytes mean the file is not what we wrote either */
+	ok = ok && p == end;
+
+	if (!ok) {
+		clear ();
+		error << string_compose (_("automation list: cannot load coordinates from %1, all points ignored"), path) << endmsg;
+	} else {
+		mark_dirty ();
+		maybe_signal_changed ();
+	}
+
+	thaw ();
+
+	return ok ? 0 : -1;
+}
+
 int
 AutomationList::deserialize_events (const XMLNode& node)
 {
+	XMLProperty const * prop;
+
+	if ((prop = node.property (X_("file"))) != 0) {
+		EventFiles const * files = thread_event_files.get ();
+		if (!files) {
+			error << string_compose (_("automation list: no directory for event file %1"), prop->value()) << endmsg;
+			return -1;
+		}
+		return read_event_file (files->directory, prop->value());
+	}
+
 	if (node.children().empty()) {
 		return -1;
 	}
@@ -33,6 +33,9 @@ using namespace PBD;
 
 AutomationWatch* AutomationWatch::_instance = 0;
 
+/** number of automation intervals between commits to the lists */
+static const uint32_t samples_per_commit = 4;
+
 AutomationWatch&
 AutomationWatch::instance ()
 {
@@ -42,10 +45,22 @@ AutomationWatch::instance ()
 	return *_instance;
 }
 
+AutomationWatch::Watch::Watch (boost::shared_ptr<AutomationControl> ac)
+	: control (ac)
+	, samples (4 * samples_per_commit)
+	, active (1)
+	, have_last (false)
+	, last_value (0.0)
+	, have_held (false)
+{
+}
+
 AutomationWatch::AutomationWatch ()
 	: _thread (0)
 	, _last_time (0)
 	, _run_thread (false)
+	, _samples_since_commit (0)
+	, automation_watches (new AutomationWatches)
 {
 
 }
@@ -59,7 +74,8 @@ AutomationWatch::~AutomationWatch ()
 	}
 
 	Glib::Threads::Mutex::Lock lm (automation_watch_lock);
-	automation_watches.clear ();
+	RCUWriter<AutomationWatches> writer (automation_watches);
+	writer.get_copy()->clear ();
 }
 
 void
@@ -67,7 +83,15 @@ AutomationWatch::add_automation_watch (boost::shared_ptr<AutomationControl> ac)
 {
 	Glib::Threads::Mutex::Lock lm (automation_watch_lock);
 	DEBUG_TRACE (DEBUG::Automation, string_compose ("now watching control %1 for automation, astate = %2\n", ac->name(), enum_2_string (ac->automation_state())));
-	automation_watches.insert (ac);
+
+	{
+		RCUWriter<AutomationWatches> writer (automation_watches);
+		boost::shared_ptr<AutomationWatches> aw = writer.get_copy ();
+
+		if (aw->find (ac) == aw->end()) {
+			aw->insert (std::make_pair (ac, boost::shared_ptr<Watch> (new Watch (ac))));
+		}
+	}
 
 	/* if an automation control is added here while the transport is
 	 * rolling, make sure that it knows that there is a write pass going
@@ -107,10 +131,127 @@ AutomationWatch::remove_automation_watch (boost::shared_ptr<AutomationControl> a
 {
 	Glib::Threads::Mutex::Lock lm (automation_watch_lock);
 	DEBUG_TRACE (DEBUG::Automation, string_compose ("remove control %1 from automation watch\n", ac->name()));
-	automation_watches.erase (ac);
+
+	{
+		RCUWriter<AutomationWatches> writer (automation_watches);
+		boost::shared_ptr<AutomationWatches> aw = writer.get_copy ();
+		AutomationWatches::iterator w = aw->find (ac);
+
+		if (w != aw->end()) {
+			/* the pass ends here, so write what has been sampled so far */
+			flush (*w->second);
+			g_atomic_int_set (&w->second->active, 0);
+			aw->erase (w);
+		}
+	}
+
 	ac->list()->set_in_write_pass (false);
 }
 
+/** Record the current value of every control being written, without
+ *  touching the automation lists.
+ */
+void
+AutomationWatch::sample (framepos_t time)
+{
+	boost::shared_ptr<AutomationWatches> aw = automation_watches.reader ();
+
+	for (AutomationWatches::iterator w = aw->begin(); w != aw->end(); ++w) {
+
+		Watch& watch (*w->second);
+
+		if (!watch.control->alist()->automation_write()) {
+			continue;
+		}
+
+		if (watch.samples.write_space() == 0) {
+			/* commits are overdue; this is not expected to happen */
+			continue;
+		}
+
+		Sample s;
+		s.when = time;
+		s.value = watch.control->user_double();
+		watch.samples.write (&s, 1);
+	}
+}
+
+/** Add the samples of @a watch to its list, skipping those in the middle
+ *  of runs of identical values. The last sample of such a run is held
+ *  back until the run ends, since it may yet move.
+ */
+void
+AutomationWatch::commit (Watch& watch)
+{
+	/* CALLER MUST HOLD automation_watch_lock */
+
+	if (watch.samples.read_space() == 0 || !g_atomic_int_get (&watch.active)) {
+		return;
+	}
+
+	boost::shared_ptr<AutomationList> al = watch.control->alist();
+	Sample s;
+
+	al->freeze ();
+
+	while (watch.samples.read (&s, 1) == 1) {
+
+		if (watch.have_last && s.value == watch.last_value) {
+			watch.held = s;
+			watch.have_held = true;
+			continue;
+		}
+
+		if (watch.have_held) {
+			al->add (watch.held.when, watch.held.value, true);
+			watch.have_held = false;
+		}
+
+		al->add (s.when, s.value, true);
+
+		watch.last_value = s.value;
+		watch.have_last = true;
+	}
+
+	al->thaw ();
+}
+
+/** Commit everything sampled for @a watch, including any held back sample,
+ *  because the write pass is about to end.
+ */
+void
+AutomationWatch::flush (Watch& watch)
+{
+	/* CALLER MUST HOLD automation_watch_lock */
+
+	commit (watch);
+
+	if (watch.have_held && g_atomic_int_get (&watch.active)) {
+		watch.control->alist()->add (watch.held.when, watch.held.value, true);
+	}
+
+	watch.have_held = false;
+	watch.have_last = false;
+}
+
+void
+AutomationWatch::commit_all (bool and_flush)
+{
+	/* CALLER MUST HOLD automation_watch_lock */
+
+	boost::shared_ptr<AutomationWatches> aw = automation_watches.reader ();
+
+	for (AutomationWatches::iterator w = aw->begin(); w != aw->end(); ++w) {
+		if (and_flush) {
+			flush (*w->second);
+		} else {
+			commit (*w->second);
+		}
+	}
+
+	_samples_since_commit = 0;
+}
+
 gint
 AutomationWatch::timer ()
 {
@@ -118,31 +259,40 @@ AutomationWatch::timer ()
 		return TRUE;
 	}
 
-	{
+	framepos_t time = _session->audible_frame ();
+
+	if (time > _last_time) {  //we only write automation in the forward direction; this fixes automation-recording in a loop
+
+		sample (time);
+
+		if (++_samples_since_commit >= samples_per_commit) {
+			Glib::Threads::Mutex::Lock lm (automation_watch_lock);
+			commit_all (false);
+		}
+
+	} else if (time != _last_time) {  //transport stopped or reversed.  stop the automation pass and start a new one (for bonus points, someday store the previous pass in an undo record)
+
 		Glib::Threads::Mutex::Lock lm (automation_watch_lock);
 
-		framepos_t time = _session->audible_frame ();
-		if (time > _last_time) {  //we only write automation in the forward direction; this fixes automation-recording in a loop
-			for (AutomationWatches::iterator aw = automation_watches.begin(); aw != automation_watches.end(); ++aw) {
-				if ((*aw)->alist()->automation_write()) {
-					(*aw)->list()->add (time, (*aw)->user_double(), true);
-				}
-			}
-		} else if (time != _last_time) {  //transport stopped or reversed.  stop the automation pass and start a new one (for bonus points, someday store the previous pass in an undo record)
-			for (AutomationWatches::iterator aw = automation_watches.begin(); aw != automation_watches.end(); ++aw) {
-				DEBUG_TRACE (DEBUG::Automation, string_compose ("%1: transport in rewind, speed %2, in write pass ? %3 writing ? %4\n",
-										(*aw)->name(), _session->transport_speed(), _session->transport_rolling(),
-										(*aw)->alist()->automation_write()));
-				(*aw)->list()->set_in_write_pass (false);
-				if ( (*aw)->alist()->automation_write() ) {
-					(*aw)->list()->set_in_write_pass (true, time);
-				}
+		/* finish the pass with what was recorded up to now */
+		commit_all (true);
+
+		boost::shared_ptr<AutomationWatches> aw = automation_watches.reader ();
+
+		for (AutomationWatches::iterator w = aw->begin(); w != aw->end(); ++w) {
+			boost::shared_ptr<AutomationControl> ac (w->first);
+			DEBUG_TRACE (DEBUG::Automation, string_compose ("%1: transport in rewind, speed %2, in write pass ? %3 writing ? %4\n",
+									ac->name(), _session->transport_speed(), _session->transport_rolling(),
+									ac->alist()->automation_write()));
+			ac->list()->set_in_write_pass (false);
+			if ( ac->alist()->automation_write() ) {
+				ac->list()->set_in_write_pass (true, time);
 			}
 		}
-
-		_last_time = time;
 	}
 
+	_last_time = time;
+
 	return TRUE;
 }
 
@@ -190,14 +340,20 @@ AutomationWatch::transport_state_change ()
 	{
 		Glib::Threads::Mutex::Lock lm (automation_watch_lock);
 
-		for (AutomationWatches::iterator aw = automation_watches.begin(); aw != automation_watches.end(); ++aw) {
+		/* the current pass (if any) ends here */
+		commit_all (true);
+
+		boost::shared_ptr<AutomationWatches> aw = automation_watches.reader ();
+
+		for (AutomationWatches::iterator w = aw->begin(); w != aw->end(); ++w) {
+			boost::shared_ptr<AutomationControl> ac (w->first);
 			DEBUG_TRACE (DEBUG::Automation, string_compose ("%1: transport state changed, speed %2, in write pass ? %3 writing ? %4\n",
-									(*aw)->name(), _session->transport_speed(), rolling,
-									(*aw)->alist()->automation_write()));
-			if (rolling && (*aw)->alist()->automation_write()) {
-				(*aw)->list()->set_in_write_pass (true);
+									ac->name(), _session->transport_speed(), rolling,
+									ac->alist()->automation_write()));
+			if (rolling && ac->alist()->automation_write()) {
+				ac->list()->set_in_write_pass (true);
 			} else {
-				(*aw)->list()->set_in_write_pass (false);
+				ac->list()->set_in_write_pass (false);
 			}
 		}
 	}
@@ -28,6 +28,7 @@
 #include "pbd/compose.h"
 #include "pbd/failed_constructor.h"
 
+#include "ardour/audio_buffer.h"
 #include "ardour/buffer.h"
 #include "ardour/buffer_set.h"
 #include "ardour/debug.h"
@@ -466,6 +467,67 @@ BufferSet::merge_from (const BufferSet& in, framecnt_t nframes)
 	}
 }
 
+void
+BufferSet::merge_from (const std::vector<const BufferSet*>& in, framecnt_t nframes)
+{
+	/* merge several sets into our existing buffers. audio is simply
+	   accumulated, MIDI buffers are combined with a single k-way merge
+	   per buffer rather than one insertion pass per input set.
+
+	   as with merge_from (const BufferSet&, ...) extra buffers in
+	   any of the inputs are dropped.
+	*/
+
+	for (std::vector<const BufferSet*>::const_iterator s = in.begin(); s != in.end(); ++s) {
+		BufferSet::audio_iterator o = audio_begin();
+		for (BufferSet::const_iterator i = (*s)->begin (DataType::AUDIO); i != (*s)->end (DataType::AUDIO) && o != audio_end(); ++i, ++o) {
+			o->merge_from (*i, nframes);
+		}
+	}
+
+	const MidiBuffer* srcs[128];
+	const size_t max_srcs = sizeof (srcs) / sizeof (srcs[0]);
+
+	for (uint32_t m = 0; m < count().n_midi(); ++m) {
+		MidiBuffer& dst (get_midi (m));
+		size_t n = 0;
+
+		for (std::vector<const BufferSet*>::const_iterator s = in.begin(); s != in.end(); ++s) {
+			if (m >= (*s)->count().n_midi()) {
+				continue;
+			}
+			srcs[n++] = &(*s)->get_midi (m);
+			if (n == max_srcs) {
+				dst.merge_in_place (srcs, n);
+				n = 0;
+			}
+		}
+
+		if (n) {
+			dst.merge_in_place (srcs, n);
+		}
+	}
+}
+
+/** @return true if none of the buffers in use contain MIDI events, and the first
+ * @a nframes of their audio do not exceed @a threshold (see AudioBuffer::is_silent)
+ */
+bool
+BufferSet::is_silent (pframes_t nframes, Sample threshold) const
+{
+	for (uint32_t i = 0; i < _count.n_audio (); ++i) {
+		if (!get_audio (i).is_silent (nframes, threshold)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < _count.n_midi (); ++i) {
+		if (!get_midi (i).empty ()) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void
 BufferSet::silence (framecnt_t nframes, framecnt_t offset)
 {
@@ -29,6 +29,7 @@
 #include "audiographer/general/interleaver.h"
 #include "audiographer/general/normalizer.h"
 #include "audiographer/general/analyser.h"
+#include "audiographer/general/async_sink.h"
 #include "audiographer/general/peak_reader.h"
 #include "audiographer/general/loudness_reader.h"
 #include "audiographer/general/sample_format_converter.h"
@@ -37,6 +38,7 @@
 #include "audiographer/general/threader.h"
 #include "audiographer/sndfile/tmp_file.h"
 #include "audiographer/sndfile/sndfile_writer.h"
+#include "audiographer/sndfile/sndfile_splicer.h"
 
 #include "ardour/audioengine.h"
 #include "ardour/export_channel_configuration.h"
@@ -66,16 +68,46 @@ ExportGraphBuilder::~ExportGraphBuilder ()
 }
 
 int
-ExportGraphBuilder::process (framecnt_t frames, bool last_cycle)
+ExportGraphBuilder::process (framepos_t position, framecnt_t frames)
 {
 	assert(frames <= process_buffer_frames);
 
+	framepos_t const cycle_end = position + frames;
+
 	for (ChannelMap::iterator it = channels.begin(); it != channels.end(); ++it) {
+		TimespanVertexMap & vertices (it->second);
+
+		if (vertices.empty ()) {
+			continue;
+		}
+
 		Sample const * process_buffer = 0;
 		it->first->read (process_buffer, frames);
-		ConstProcessContext<Sample> context(process_buffer, frames, 1);
-		if (last_cycle) { context().set_flag (ProcessContext<Sample>::EndOfInput); }
-		it->second->process (context);
+
+		for (TimespanVertexMap::iterator v = vertices.begin(); v != vertices.end(); /* ++ in loop */) {
+			ExportTimespanPtr const & span (v->first);
+
+			if (span->get_start () >= cycle_end && span->get_end () > cycle_end) {
+				/* not started yet */
+				++v;
+				continue;
+			}
+
+			framepos_t const start = std::max (position, span->get_start ());
+			framepos_t const end = std::min (cycle_end, span->get_end ());
+
+			ConstProcessContext<Sample> context(process_buffer + (start - position), end - start, 1);
+
+			if (span->get_end () <= cycle_end) {
+				/* this timespan is done, its input is not needed any more */
+				context().set_flag (ProcessContext<Sample>::EndOfInput);
+				v->second->process (context);
+				vertices.erase (v++);
+			} else {
+				v->second->process (context);
+				++v;
+			}
+		}
 	}
 
 	return 0;
@@ -113,6 +145,7 @@ ExportGraphBuilder::reset ()
 	channels.clear ();
 	normalizers.clear ();
 	analysis_map.clear();
+	encoder_stats.clear ();
 }
 
 void
@@ -124,10 +157,11 @@ ExportGraphBuilder::cleanup (bool remove_out_files/*=false*/)
 		iter->remove_children(remove_out_files);
 		iter = channel_configs.erase(iter);
 	}
+	encoder_stats.clear ();
 }
 
 void
-ExportGraphBuilder::set_current_timespan (boost::shared_ptr<ExportTimespan> span)
+ExportGraphBuilder::set_current_timespan (ExportTimespanPtr span)
 {
 	timespan = span;
 }
@@ -186,6 +220,15 @@ ExportGraphBuilder::get_analysis_results (AnalysisResults& results) {
 	}
 }
 
+void
+ExportGraphBuilder::get_encoder_stats (uint32_t & stalls, int64_t & stall_time) const
+{
+	for (std::list<EncoderStatsPtr>::const_iterator i = encoder_stats.begin(); i != encoder_stats.end(); ++i) {
+		stalls += (*i)->stalls ();
+		stall_time += (*i)->stall_time ();
+	}
+}
+
 void
 ExportGraphBuilder::add_split_config (FileSpec const & config)
 {
@@ -207,8 +250,7 @@ boost::shared_ptr<AudioGrapher::Sink<Sample> >
 ExportGraphBuilder::Encoder::init (FileSpec const & new_config)
 {
 	config = new_config;
-	init_writer (float_writer);
-	return float_writer;
+	return init_writer (float_writer, float_async);
 }
 
 template <>
@@ -216,8 +258,7 @@ boost::shared_ptr<AudioGrapher::Sink<int> >
 ExportGraphBuilder::Encoder::init (FileSpec const & new_config)
 {
 	config = new_config;
-	init_writer (int_writer);
-	return int_writer;
+	return init_writer (int_writer, int_async);
 }
 
 template <>
@@ -225,8 +266,7 @@ boost::shared_ptr<AudioGrapher::Sink<short> >
 ExportGraphBuilder::Encoder::init (FileSpec const & new_config)
 {
 	config = new_config;
-	init_writer (short_writer);
-	return short_writer;
+	return init_writer (short_writer, short_async);
 }
 
 void
@@ -238,6 +278,19 @@ ExportGraphBuilder::Encoder::add_child (FileSpec const & new_config)
 void
 ExportGraphBuilder::Encoder::destroy_writer (bool delete_out_file)
 {
+	/* the encoder threads must not touch the files anymore */
+	if (float_async) {
+		float_async->stop ();
+	}
+
+	if (int_async) {
+		int_async->stop ();
+	}
+
+	if (short_async) {
+		short_async->stop ();
+	}
+
 	if (delete_out_file ) {
 
 		if (float_writer) {
@@ -257,6 +310,10 @@ ExportGraphBuilder::Encoder::destroy_writer (bool delete_out_file)
 		}
 	}
 
+	float_async.reset ();
+	int_async.reset ();
+	short_async.reset ();
+
 	float_writer.reset ();
 	int_writer.reset ();
 	short_writer.reset ();
@@ -268,6 +325,17 @@ ExportGraphBuilder::Encoder::operator== (FileSpec const & other_config) const
 	return get_real_format (config) == get_real_format (other_config);
 }
 
+ExportGraphBuilder::EncoderStatsPtr
+ExportGraphBuilder::Encoder::stats () const
+{
+	if (float_async) {
+		return float_async;
+	} else if (int_async) {
+		return int_async;
+	}
+	return short_async;
+}
+
 int
 ExportGraphBuilder::Encoder::get_real_format (FileSpec const & config)
 {
@@ -276,8 +344,9 @@ ExportGraphBuilder::Encoder::get_real_format (FileSpec const & config)
 }
 
 template<typename T>
-void
-ExportGraphBuilder::Encoder::init_writer (boost::shared_ptr<AudioGrapher::SndfileWriter<T> > & writer)
+boost::shared_ptr<AudioGrapher::Sink<T> >
+ExportGraphBuilder::Encoder::init_writer (boost::shared_ptr<AudioGrapher::SndfileWriter<T> > & writer,
+                                          boost::shared_ptr<AudioGrapher::AsyncSink<T> > & async)
 {
 	unsigned channels = config.channel_config->get_n_chans();
 	int format = get_real_format (config);
@@ -286,6 +355,29 @@ ExportGraphBuilder::Encoder::init_writer (boost::shared_ptr<AudioGrapher::Sndfil
 
 	writer.reset (new AudioGrapher::SndfileWriter<T> (writer_filename, format, channels, config.format->sample_rate(), config.broadcast_info));
 	writer->FileWritten.connect_same_thread (copy_files_connection, boost::bind (&ExportGraphBuilder::Encoder::copy_files, this, _1));
+
+	boost::shared_ptr<AudioGrapher::Sink<T> > sink = writer;
+
+	if (!config.splice_path.empty()) {
+		/* incremental export: the graph only renders what changed,
+		 * the rest is copied from the previous export */
+		boost::shared_ptr<AudioGrapher::SndfileSplicer<T> > splicer (new AudioGrapher::SndfileSplicer<T> (config.splice_path, config.splice_ranges));
+		splicer->add_output (writer);
+		sink = splicer;
+	}
+
+	ExportFormatBase::FormatId const format_id = config.format->format_id();
+	if (format_id != ExportFormatBase::F_FLAC && format_id != ExportFormatBase::F_Ogg) {
+		return sink;
+	}
+
+	/* Compressing is expensive, encode in the background so that
+	 * several files can be encoded in parallel while the graph goes on.
+	 * The queue holds a couple of seconds of audio.
+	 */
+	framecnt_t const queue_frames = 2 * config.format->sample_rate() * channels;
+	async.reset (new AudioGrapher::AsyncSink<T> (sink, channels, queue_frames));
+	return async;
 }
 
 void
@@ -301,13 +393,37 @@ ExportGraphBuilder::Encoder::copy_files (std::string orig_path)
 /* SFC */
 
 ExportGraphBuilder::SFC::SFC (ExportGraphBuilder &parent, FileSpec const & new_config, framecnt_t max_frames)
-	: data_width(0)
+	: parent (parent)
+	, data_width(0)
+{
+	init (new_config, max_frames, AnalysisPtr ());
+}
+
+ExportGraphBuilder::SFC::SFC (ExportGraphBuilder &parent, FileSpec const & new_config, framecnt_t max_frames, boost::ptr_list<SFC> const & siblings)
+	: parent (parent)
+	, data_width(0)
+{
+	AnalysisPtr shared_analyser;
+	for (boost::ptr_list<SFC>::const_iterator it = siblings.begin(); it != siblings.end(); ++it) {
+		if (it->analyser) {
+			shared_analyser = it->analyser;
+			break;
+		}
+	}
+	init (new_config, max_frames, shared_analyser);
+}
+
+void
+ExportGraphBuilder::SFC::init (FileSpec const & new_config, framecnt_t max_frames, AnalysisPtr shared_analyser)
 {
 	config = new_config;
 	data_width = sndfile_data_width (Encoder::get_real_format (config));
 	unsigned channels = new_config.channel_config->get_n_chans();
 	_analyse = config.format->analyse();
-	if (_analyse) {
+	if (_analyse && shared_analyser) {
+		/* a sibling already analyses the very same data */
+		analyser = shared_analyser;
+	} else if (_analyse) {
 		framecnt_t sample_rate = parent.session.nominal_frame_rate();
 		framecnt_t sb = config.format->silence_beginning_at (parent.timespan->get_start(), sample_rate);
 		framecnt_t se = config.format->silence_end_at (parent.timespan->get_end(), sample_rate);
@@ -317,26 +433,25 @@ ExportGraphBuilder::SFC::SFC (ExportGraphBuilder &parent, FileSpec const & new_c
 		analyser.reset (new Analyser (config.format->sample_rate(), channels, max_frames,
 					(framecnt_t) ceil (duration * config.format->sample_rate () / (double) sample_rate)));
 		chunker->add_output (analyser);
-		parent.add_analyser (config.filename->get_path (config.format), analyser);
 	}
 
 	if (data_width == 8 || data_width == 16) {
 		short_converter = ShortConverterPtr (new SampleFormatConverter<short> (channels));
 		short_converter->init (max_frames, config.format->dither_type(), data_width);
 		add_child (config);
-		if (_analyse) { analyser->add_output (short_converter); }
+		if (chunker) { analyser->add_output (short_converter); }
 
 	} else if (data_width == 24 || data_width == 32) {
 		int_converter = IntConverterPtr (new SampleFormatConverter<int> (channels));
 		int_converter->init (max_frames, config.format->dither_type(), data_width);
 		add_child (config);
-		if (_analyse) { analyser->add_output (int_converter); }
+		if (chunker) { analyser->add_output (int_converter); }
 	} else {
 		int actual_data_width = 8 * sizeof(Sample);
 		float_converter = FloatConverterPtr (new SampleFormatConverter<Sample> (channels));
 		float_converter->init (max_frames, config.format->dither_type(), actual_data_width);
 		add_child (config);
-		if (_analyse) { analyser->add_output (float_converter); }
+		if (chunker) { analyser->add_output (float_converter); }
 	}
 }
 
@@ -351,7 +466,7 @@ ExportGraphBuilder::SFC::set_peak (float gain)
 ExportGraphBuilder::FloatSinkPtr
 ExportGraphBuilder::SFC::sink ()
 {
-	if (_analyse) {
+	if (chunker) {
 		return chunker;
 	} else if (data_width == 8 || data_width == 16) {
 		return short_converter;
@@ -365,6 +480,10 @@ ExportGraphBuilder::SFC::sink ()
 void
 ExportGraphBuilder::SFC::add_child (FileSpec const & new_config)
 {
+	if (analyser && new_config.format->analyse()) {
+		parent.add_analyser (new_config.filename->get_path (new_config.format), analyser);
+	}
+
 	for (boost::ptr_list<Encoder>::iterator it = children.begin(); it != children.end(); ++it) {
 		if (*it == new_config) {
 			it->add_child (new_config);
@@ -382,6 +501,10 @@ ExportGraphBuilder::SFC::add_child (FileSpec const & new_config)
 	} else {
 		float_converter->add_output (encoder.init<Sample> (new_config));
 	}
+
+	if (encoder.stats ()) {
+		parent.add_encoder_stats (encoder.stats ());
+	}
 }
 
 void
@@ -409,6 +532,10 @@ ExportGraphBuilder::SFC::operator== (FileSpec const & other_config) const
 ExportGraphBuilder::Normalizer::Normalizer (ExportGraphBuilder & parent, FileSpec const & new_config, framecnt_t max_frames)
 	: parent (parent)
 	, use_loudness (false)
+	, mapped_file (0)
+	, mapped_data (0)
+	, mapped_samples (0)
+	, mapped_position (0)
 {
 	std::string tmpfile_path = parent.session.session_directory().export_path();
 	tmpfile_path = Glib::build_filename(tmpfile_path, "XXXXXX");
@@ -430,8 +557,10 @@ ExportGraphBuilder::Normalizer::Normalizer (ExportGraphBuilder & parent, FileSpe
 	normalizer->alloc_buffer (max_frames_out);
 	normalizer->add_output (threader);
 
-	int format = ExportFormatBase::F_RAW | ExportFormatBase::SF_Float;
+	/* raw floats in CPU byte order, so that the file can be mapped and used as-is */
+	int format = ExportFormatBase::F_RAW | ExportFormatBase::SF_Float | ExportFormatBase::E_Cpu;
 	tmp_file.reset (new TmpFile<float> (&tmpfile_path_buf[0], format, channels, config.format->sample_rate()));
+	tmp_file_path = &tmpfile_path_buf[0];
 	tmp_file->FileWritten.connect_same_thread (post_processing_connection,
 	                                           boost::bind (&Normalizer::start_post_processing, this));
 
@@ -444,6 +573,13 @@ ExportGraphBuilder::Normalizer::Normalizer (ExportGraphBuilder & parent, FileSpe
 	}
 }
 
+ExportGraphBuilder::Normalizer::~Normalizer ()
+{
+	if (mapped_file) {
+		g_mapped_file_unref (mapped_file);
+	}
+}
+
 ExportGraphBuilder::FloatSinkPtr
 ExportGraphBuilder::Normalizer::sink ()
 {
@@ -463,7 +599,7 @@ ExportGraphBuilder::Normalizer::add_child (FileSpec const & new_config)
 		}
 	}
 
-	children.push_back (new SFC (parent, new_config, max_frames_out));
+	children.push_back (new SFC (parent, new_config, max_frames_out, children));
 	threader->add_output (children.back().sink());
 }
 
@@ -499,6 +635,21 @@ ExportGraphBuilder::Normalizer::get_normalize_cycle_count() const
 bool
 ExportGraphBuilder::Normalizer::process()
 {
+	if (mapped_data) {
+		/* Hand the data to the normalizer straight from the mapped file,
+		 * it applies the gain while copying to its own buffer.
+		 */
+		framecnt_t const frames = std::min (max_frames_out, mapped_samples - mapped_position);
+		ConstProcessContext<Sample> context (mapped_data + mapped_position, frames, config.channel_config->get_n_chans());
+		mapped_position += frames;
+		bool const done = mapped_position == mapped_samples;
+		if (done) {
+			context().set_flag (ProcessContext<Sample>::EndOfInput);
+		}
+		normalizer->process (context);
+		return done;
+	}
+
 	framecnt_t frames_read = tmp_file->read (*buffer);
 	return frames_read != buffer->frames();
 }
@@ -515,8 +666,29 @@ ExportGraphBuilder::Normalizer::start_post_processing()
 	for (boost::ptr_list<SFC>::iterator i = children.begin(); i != children.end(); ++i) {
 		(*i).set_peak (gain);
 	}
-	tmp_file->seek (0, SEEK_SET);
-	tmp_file->add_output (normalizer);
+
+	/* The levels have been measured while the intermediate file was written,
+	 * all that is left is applying the gain while the data is passed on to the
+	 * encoders. Reading the file through a memory map saves the decode and copy
+	 * done by libsndfile; if it can not be mapped, read it back instead.
+	 */
+	mapped_samples = tmp_file->get_frames_written ();
+	mapped_position = 0;
+
+	if (mapped_samples > 0 && (mapped_file = g_mapped_file_new (tmp_file_path.c_str(), false, NULL)) != 0) {
+		if (g_mapped_file_get_length (mapped_file) >= mapped_samples * sizeof (Sample)) {
+			mapped_data = (Sample const *) g_mapped_file_get_contents (mapped_file);
+		} else {
+			g_mapped_file_unref (mapped_file);
+			mapped_file = 0;
+		}
+	}
+
+	if (!mapped_data) {
+		tmp_file->seek (0, SEEK_SET);
+		tmp_file->add_output (normalizer);
+	}
+
 	parent.normalizers.push_back (this);
 }
 
@@ -528,6 +700,10 @@ ExportGraphBuilder::SRC::SRC (ExportGraphBuilder & parent, FileSpec const & new_
 	config = new_config;
 	converter.reset (new SampleRateConverter (new_config.channel_config->get_n_chans()));
 	ExportFormatSpecification & format = *new_config.format;
+	if (format.src_quality() <= ExportFormatBase::SRC_SincFast) {
+		/* only the sinc converters are expensive enough to be worth spreading over threads */
+		converter->set_thread_pool (parent.thread_pool);
+	}
 	converter->init (parent.session.nominal_frame_rate(), format.sample_rate(), format.src_quality());
 	max_frames_out = converter->allocate_buffers (max_frames);
 
@@ -582,10 +758,22 @@ ExportGraphBuilder::SRC::add_child_to_list (FileSpec const & new_config, boost::
 		}
 	}
 
-	list.push_back (new T (parent, new_config, max_frames_out));
+	list.push_back (create_child (new_config, list));
 	converter->add_output (list.back().sink ());
 }
 
+ExportGraphBuilder::SFC *
+ExportGraphBuilder::SRC::create_child (FileSpec const & new_config, boost::ptr_list<SFC> const & siblings)
+{
+	return new SFC (parent, new_config, max_frames_out, siblings);
+}
+
+ExportGraphBuilder::Normalizer *
+ExportGraphBuilder::SRC::create_child (FileSpec const & new_config, boost::ptr_list<Normalizer> const &)
+{
+	return new Normalizer (parent, new_config, max_frames_out);
+}
+
 bool
 ExportGraphBuilder::SRC::operator== (FileSpec const & other_config) const
 {
@@ -665,6 +853,7 @@ ExportGraphBuilder::SilenceHandler::operator== (FileSpec const & other_config) c
 
 ExportGraphBuilder::ChannelConfig::ChannelConfig (ExportGraphBuilder & parent, FileSpec const & new_config, ChannelMap & channel_map)
 	: parent (parent)
+	, timespan (parent.timespan)
 {
 	typedef ExportChannelConfiguration::ChannelList ChannelList;
 
@@ -686,14 +875,11 @@ ExportGraphBuilder::ChannelConfig::ChannelConfig (ExportGraphBuilder & parent, F
 	ChannelList const & channel_list = config.channel_config->get_channels();
 	unsigned chan = 0;
 	for (ChannelList::const_iterator it = channel_list.begin(); it != channel_list.end(); ++it, ++chan) {
-		ChannelMap::iterator map_it = channel_map.find (*it);
-		if (map_it == channel_map.end()) {
-			std::pair<ChannelMap::iterator, bool> result_pair =
-				channel_map.insert (std::make_pair (*it, IdentityVertexPtr (new IdentityVertex<Sample> ())));
-			assert (result_pair.second);
-			map_it = result_pair.first;
+		IdentityVertexPtr & vertex = channel_map[*it][timespan];
+		if (!vertex) {
+			vertex.reset (new IdentityVertex<Sample> ());
 		}
-		map_it->second->add_output (interleaver->input (chan));
+		vertex->add_output (interleaver->input (chan));
 	}
 
 	add_child (new_config);
@@ -731,7 +917,8 @@ ExportGraphBuilder::ChannelConfig::remove_children (bool remove_out_files)
 bool
 ExportGraphBuilder::ChannelConfig::operator== (FileSpec const & other_config) const
 {
-	return config.channel_config == other_config.channel_config;
+	/* configurations are added for the builder's current timespan */
+	return timespan == parent.timespan && config.channel_config == other_config.channel_config;
 }
 
 } // namespace ARDOUR
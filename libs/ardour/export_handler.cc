@@ -24,16 +24,22 @@
 #include <glibmm.h>
 #include <glibmm/convert.h>
 
+#include <cstring>
+#include <sndfile.h>
+
 #include "pbd/convert.h"
+#include "pbd/xml++.h"
 
 #include "ardour/audiofile_tagger.h"
 #include "ardour/debug.h"
+#include "ardour/export_failed.h"
 #include "ardour/export_graph_builder.h"
 #include "ardour/export_timespan.h"
 #include "ardour/export_channel_configuration.h"
 #include "ardour/export_status.h"
 #include "ardour/export_format_specification.h"
 #include "ardour/export_filename.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/soundcloud_upload.h"
 #include "ardour/system_exec.h"
 #include "pbd/openuri.h"
@@ -111,6 +117,7 @@ ExportHandler::ExportHandler (Session & session)
   , graph_builder (new ExportGraphBuilder (session))
   , export_status (session.get_export_status ())
   , normalizing (false)
+  , run_end (0)
   , cue_tracknum (0)
   , cue_indexnum (0)
 {
@@ -119,6 +126,15 @@ ExportHandler::ExportHandler (Session & session)
 ExportHandler::~ExportHandler ()
 {
 	graph_builder->cleanup (export_status->aborted () );
+
+	/* Put back the earlier exports that an aborted incremental export was to replace */
+	for (PreviousFileMap::iterator it = previous_files.begin(); it != previous_files.end(); ++it) {
+		if (export_status->aborted ()) {
+			::g_rename (it->second.c_str(), it->first.c_str());
+		} else {
+			::g_unlink (it->second.c_str());
+		}
+	}
 }
 
 /** Add an export to the `to-do' list */
@@ -173,39 +189,268 @@ ExportHandler::start_timespan ()
 		return;
 	}
 
-	/* finish_timespan pops the config_map entry that has been done, so
-	   this is the timespan to do this time
+	/* finish_timespan pops the config_map entries that have been done.
+	   config_map is sorted by start (and end) of the timespans, so the first
+	   one is the next timespan to do. Timespans that overlap it or follow it
+	   without a gap (range stems, cue exports) are rendered along with it,
+	   in a single pass over the session.
 	*/
-	current_timespan = config_map.begin()->first;
+	current_timespans.clear ();
+	framepos_t const pass_start = config_map.begin()->first->get_start();
+	pass_end = pass_start;
 
-	export_status->total_frames_current_timespan = current_timespan->get_length();
-	export_status->timespan_name = current_timespan->name();
+	for (ConfigMap::iterator it = config_map.begin(); it != config_map.end(); it = config_map.upper_bound (it->first)) {
+		if (it->first->get_start() > pass_end) {
+			break;
+		}
+		current_timespans.push_back (it->first);
+		pass_end = std::max (pass_end, it->first->get_end());
+	}
+
+	export_status->total_frames_current_timespan = pass_end - pass_start;
+	export_status->timespan_name = current_timespans.front()->name();
 	export_status->processed_frames_current_timespan = 0;
 
 	/* Register file configurations to graph builder */
 
-	/* Here's the config_map entries that use this timespan */
-	timespan_bounds = config_map.equal_range (current_timespan);
 	graph_builder->reset ();
-	graph_builder->set_current_timespan (current_timespan);
-	handle_duplicate_format_extensions();
-	for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
-		// Filenames can be shared across timespans
-		FileSpec & spec = it->second;
-		spec.filename->set_timespan (it->first);
-		graph_builder->add_config (spec);
+
+	for (TimespanList::iterator t = current_timespans.begin(); t != current_timespans.end(); ++t) {
+		/* Here's the config_map entries that use this timespan */
+		TimespanBounds timespan_bounds = config_map.equal_range (*t);
+		handle_duplicate_format_extensions (timespan_bounds);
+
+		for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+			// Filenames can be shared across timespans, and several timespans
+			// are exported at once: give each file its own copy.
+			FileSpec & spec = it->second;
+			spec.filename.reset (new ExportFilename (*spec.filename));
+			spec.filename->set_timespan (it->first);
+		}
+	}
+
+	prepare_incremental_export ();
+
+	for (TimespanList::iterator t = current_timespans.begin(); t != current_timespans.end(); ++t) {
+		TimespanBounds timespan_bounds = config_map.equal_range (*t);
+		graph_builder->set_current_timespan (*t);
+
+		for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+			graph_builder->add_config (it->second);
+		}
 	}
 
 	/* start export */
 
 	normalizing = false;
 	session.ProcessExport.connect_same_thread (process_connection, boost::bind (&ExportHandler::process, this, _1));
-	process_position = current_timespan->get_start();
+	process_position = pass_start;
+	run_end = pass_end;
+
+	if (!render_ranges.empty()) {
+		/* incremental export, start at the first range that changed */
+		next_render_range ();
+	}
+
 	session.start_audio_export (process_position);
 }
 
 void
-ExportHandler::handle_duplicate_format_extensions()
+ExportHandler::prepare_incremental_export ()
+{
+	segments.reset ();
+	render_ranges.clear ();
+
+	if (!Config->get_incremental_export ()) {
+		return;
+	}
+
+	ExportTimespanPtr timespan = current_timespans.front();
+	TimespanBounds const timespan_bounds = config_map.equal_range (timespan);
+	std::string reason;
+
+	if (current_timespans.size() > 1) {
+		reason = _("several timespans are exported at once");
+	} else if (ExportSegments::deterministic (session, reason)) {
+		for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+			if (it->second.channel_config->get_split ()) {
+				reason = _("channels are exported to separate files");
+				break;
+			}
+			if (!ExportSegments::spliceable (session, *it->second.format, reason)) {
+				break;
+			}
+		}
+	}
+
+	if (!reason.empty()) {
+		warning << string_compose (_("Export of \"%1\" can not be incremental: %2"), timespan->name(), reason) << endmsg;
+		return;
+	}
+
+	segments.reset (new ExportSegments (session, timespan));
+
+	/* Every file has to be rendered completely, unless there is an earlier
+	   export of it to copy from. finish_timespan() saves the hashes either way.
+	*/
+	for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+		if (!compare_with_previous_export (it->second, *segments)) {
+			info << string_compose (_("Export of \"%1\": no earlier export of %2 to reuse"),
+			                        timespan->name(), output_path (it->second)) << endmsg;
+			return;
+		}
+	}
+
+	segments->change_last ();
+
+	ExportSegments::RangeList const unchanged = segments->unchanged_ranges ();
+	if (unchanged.empty()) {
+		return;
+	}
+
+	FileSpec::SpliceList splice_ranges;
+	framecnt_t reused = 0;
+	for (ExportSegments::RangeList::const_iterator r = unchanged.begin(); r != unchanged.end(); ++r) {
+		splice_ranges.push_back (std::make_pair (r->first - timespan->get_start(), r->second - r->first));
+		reused += r->second - r->first;
+	}
+
+	/* The output files are written anew, keep the earlier exports to copy from */
+	for (ConfigMap::iterator it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+		std::string const path = output_path (it->second);
+		std::string const previous = path + ".previous";
+
+		if (::g_rename (path.c_str(), previous.c_str()) != 0) {
+			error << string_compose (_("Cannot rename %1 to %2, exporting it completely"), path, previous) << endmsg;
+			for (PreviousFileMap::iterator p = previous_files.begin(); p != previous_files.end(); ++p) {
+				::g_rename (p->second.c_str(), p->first.c_str());
+			}
+			previous_files.clear ();
+			for (it = timespan_bounds.first; it != timespan_bounds.second; ++it) {
+				it->second.splice_path.clear ();
+				it->second.splice_ranges.clear ();
+			}
+			return;
+		}
+
+		previous_files.insert (std::make_pair (path, previous));
+		it->second.splice_path = previous;
+		it->second.splice_ranges = splice_ranges;
+	}
+
+	render_ranges = segments->changed_ranges ();
+
+	info << string_compose (_("Export of \"%1\": reusing %2 of %3 seconds from the earlier export"),
+	                        timespan->name(),
+	                        reused / session.nominal_frame_rate(),
+	                        timespan->get_length() / session.nominal_frame_rate()) << endmsg;
+}
+
+/** Compare @a segments with the hashes saved for the earlier export of @a spec,
+ *  @return false if there is no usable earlier export
+ */
+bool
+ExportHandler::compare_with_previous_export (FileSpec const & spec, ExportSegments & segments)
+{
+	std::string const path = output_path (spec);
+	std::string const sidecar = segments_path (path);
+
+	if (!Glib::file_test (path, Glib::FILE_TEST_EXISTS) || !Glib::file_test (sidecar, Glib::FILE_TEST_EXISTS)) {
+		return false;
+	}
+
+	XMLTree tree;
+	if (!tree.read (sidecar) || !tree.root()) {
+		return false;
+	}
+
+	XMLProperty const * prop = tree.root()->property ("config");
+	if (!prop || prop->value() != config_digest (spec)) {
+		return false;
+	}
+
+	ExportSegments previous (*tree.root());
+
+	/* make sure the file is still the one that was exported */
+	SF_INFO sf_info;
+	memset (&sf_info, 0, sizeof (sf_info));
+	SNDFILE * sndfile = sf_open (path.c_str(), SFM_READ, &sf_info);
+	if (!sndfile) {
+		return false;
+	}
+	sf_close (sndfile);
+
+	if (sf_info.frames != previous.length() || (uint32_t) sf_info.channels != spec.channel_config->get_n_chans()) {
+		return false;
+	}
+
+	segments.compare (previous);
+	return true;
+}
+
+void
+ExportHandler::next_render_range ()
+{
+	framepos_t const start = render_ranges.front().first;
+
+	/* the frames up to it are copied from the earlier export */
+	export_status->processed_frames += start - process_position;
+	export_status->processed_frames_current_timespan += start - process_position;
+
+	process_position = start;
+	run_end = render_ranges.front().second;
+	render_ranges.pop_front ();
+}
+
+/** Save the hashes of an incremental export next to its file, or remove stale ones.
+ *  Also removes the earlier export that was copied from.
+ */
+void
+ExportHandler::update_segments_file (FileSpec const & spec)
+{
+	std::string const path = output_path (spec);
+	std::string const sidecar = segments_path (path);
+
+	if (segments) {
+		XMLTree tree (sidecar);
+		XMLNode & node (segments->get_state ());
+		node.add_property ("config", config_digest (spec));
+		tree.set_root (&node);
+		if (!tree.write ()) {
+			warning << string_compose (_("Could not write %1, the next export of %2 can not be incremental"), sidecar, path) << endmsg;
+		}
+	} else if (Glib::file_test (sidecar, Glib::FILE_TEST_EXISTS)) {
+		::g_unlink (sidecar.c_str());
+	}
+
+	PreviousFileMap::iterator it = previous_files.find (path);
+	if (it != previous_files.end()) {
+		::g_unlink (it->second.c_str());
+		previous_files.erase (it);
+	}
+}
+
+std::string
+ExportHandler::output_path (FileSpec const & spec)
+{
+	spec.filename->set_channel_config (spec.channel_config);
+	return spec.filename->get_path (spec.format);
+}
+
+/** Hash of the settings a file was exported with */
+std::string
+ExportHandler::config_digest (FileSpec const & spec)
+{
+	XMLNode & format (spec.format->get_state ());
+	XMLNode & channels (spec.channel_config->get_state ());
+	std::string const digest = ExportSegments::digest (format) + ExportSegments::digest (channels);
+	delete &format;
+	delete &channels;
+	return digest;
+}
+
+void
+ExportHandler::handle_duplicate_format_extensions (TimespanBounds const & timespan_bounds)
 {
 	typedef std::map<std::string, int> ExtCountMap;
 
@@ -246,23 +491,42 @@ ExportHandler::process_timespan (framecnt_t frames)
 	/* update position */
 
 	framecnt_t frames_to_read = 0;
-	framepos_t const end = current_timespan->get_end();
+	framepos_t const end = run_end;
 
 	bool const last_cycle = (process_position + frames >= end);
 
 	if (last_cycle) {
 		frames_to_read = end - process_position;
-		export_status->stop = true;
+		if (end == pass_end) {
+			export_status->stop = true;
+		}
 	} else {
 		frames_to_read = frames;
 	}
 
+	/* overall progress counts the frames of every timespan in this pass */
+	for (TimespanList::iterator t = current_timespans.begin(); t != current_timespans.end(); ++t) {
+		framepos_t const s = std::max (process_position, (*t)->get_start());
+		framepos_t const e = std::min (process_position + frames_to_read, (*t)->get_end());
+		if (e > s) {
+			export_status->processed_frames += e - s;
+		}
+	}
+
+	/* Do actual processing */
+	int ret = graph_builder->process (process_position, frames_to_read);
+
 	process_position += frames_to_read;
-	export_status->processed_frames += frames_to_read;
 	export_status->processed_frames_current_timespan += frames_to_read;
 
-	/* Do actual processing */
-	int ret = graph_builder->process (frames_to_read, last_cycle);
+	if (last_cycle && end != pass_end) {
+		/* incremental export, skip to the next range that changed */
+		next_render_range ();
+		if (session.relocate_audio_export (process_position)) {
+			throw ExportFailed (X_("Cannot relocate for incremental export"));
+		}
+		return ret;
+	}
 
 	/* Start normalizing if necessary */
 	if (last_cycle) {
@@ -306,8 +570,18 @@ ExportHandler::finish_timespan ()
 {
 	graph_builder->get_analysis_results (export_status->result_map);
 
-	while (config_map.begin() != timespan_bounds.second) {
+	uint32_t stalls = 0;
+	int64_t stall_time = 0;
+	graph_builder->get_encoder_stats (stalls, stall_time);
+	export_status->encoder_stalls += stalls;
+	export_status->encoder_stall_time += stall_time;
+
+	/* the entries of all timespans of this pass */
+	ConfigMap::iterator const pass_bound = config_map.upper_bound (current_timespans.back());
 
+	while (config_map.begin() != pass_bound) {
+
+		ExportTimespanPtr current_timespan = config_map.begin()->first;
 		ExportFormatSpecPtr fmt = config_map.begin()->second.format;
 		std::string filename = config_map.begin()->second.filename->get_path(fmt);
 		if (fmt->with_cue()) {
@@ -330,6 +604,8 @@ ExportHandler::finish_timespan ()
 		 */
 		graph_builder->reset ();
 
+		update_segments_file (config_map.begin()->second);
+
 		if (fmt->tag()) {
 			/* TODO: check Umlauts and encoding in filename.
 			 * TagLib eventually calls CreateFileA(),
@@ -401,6 +677,9 @@ ExportHandler::finish_timespan ()
 		config_map.erase (config_map.begin());
 	}
 
+	/* start_timespan() counts one of them */
+	export_status->timespan += current_timespans.size() - 1;
+
 	start_timespan ();
 }
 
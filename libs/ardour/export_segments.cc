@@ -0,0 +1,369 @@
+/*
+    Copyright (C) 2016 Paul Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <cfloat>
+#include <map>
+#include <sstream>
+
+#include "pbd/compose.h"
+#include "pbd/convert.h"
+#include "pbd/md5.h"
+#include "pbd/xml++.h"
+
+#include "ardour/automatable.h"
+#include "ardour/automation_control.h"
+#include "ardour/automation_list.h"
+#include "ardour/export_format_specification.h"
+#include "ardour/export_segments.h"
+#include "ardour/export_timespan.h"
+#include "ardour/pannable.h"
+#include "ardour/playlist.h"
+#include "ardour/plugin_insert.h"
+#include "ardour/port_insert.h"
+#include "ardour/region.h"
+#include "ardour/route.h"
+#include "ardour/session.h"
+#include "ardour/track.h"
+
+#include "i18n.h"
+
+using namespace std;
+using namespace PBD;
+
+namespace ARDOUR
+{
+
+static string
+md5_digest (string const & data)
+{
+	MD5 md5;
+	return md5.digestMemory ((uint8_t const *) data.data (), data.size ());
+}
+
+/** Write the contents of @a node to @a out, leaving out GUI state and automation
+ *  (automation is hashed per segment).
+ */
+static void
+serialize (XMLNode const & node, ostream & out)
+{
+	if (node.name () == X_("Extra") || node.name () == Automatable::xml_node_name) {
+		return;
+	}
+
+	out << '<' << node.name ();
+	for (XMLPropertyConstIterator p = node.properties ().begin (); p != node.properties ().end (); ++p) {
+		out << ' ' << (*p)->name () << "=\"" << (*p)->value () << '"';
+	}
+	out << '>' << node.content ();
+
+	for (XMLNodeConstIterator c = node.children ().begin (); c != node.children ().end (); ++c) {
+		serialize (**c, out);
+	}
+	out << "</>";
+}
+
+string
+ExportSegments::digest (XMLNode const & node)
+{
+	stringstream ss;
+	serialize (node, ss);
+	return md5_digest (ss.str ());
+}
+
+ExportSegments::ExportSegments (Session & session, ExportTimespanPtr timespan)
+	: _start (timespan->get_start ())
+	, _end (timespan->get_end ())
+	, _segment_frames (segment_seconds * session.nominal_frame_rate ())
+{
+	uint32_t const n_segments = (length () + _segment_frames - 1) / _segment_frames;
+	vector<string> state (n_segments);
+
+	boost::shared_ptr<RouteList> routes = session.get_routes ();
+
+	/* The processing of all routes, including the state of their plugins
+	 * (parameters, and whatever else a plugin saves); changes here affect
+	 * every segment.
+	 */
+
+	stringstream chain;
+	for (RouteList::iterator r = routes->begin (); r != routes->end (); ++r) {
+		XMLNode & node ((*r)->get_state ());
+		serialize (node, chain);
+		delete &node;
+	}
+	_chain = md5_digest (chain.str ());
+
+	/* The regions that are (partly) within each segment */
+
+	map<boost::shared_ptr<Region>, string> region_digests;
+
+	for (RouteList::iterator r = routes->begin (); r != routes->end (); ++r) {
+		boost::shared_ptr<Track> track = boost::dynamic_pointer_cast<Track> (*r);
+		if (!track || !track->playlist ()) {
+			continue;
+		}
+
+		string const owner = track->id ().to_s ();
+
+		for (uint32_t s = 0; s < n_segments; ++s) {
+			boost::shared_ptr<RegionList> regions = track->playlist ()->regions_touched (segment_start (s), segment_end (s) - 1);
+
+			for (RegionList::iterator i = regions->begin (); i != regions->end (); ++i) {
+				string & d (region_digests[*i]);
+				if (d.empty ()) {
+					XMLNode & node ((*i)->get_state ());
+					d = digest (node);
+					delete &node;
+				}
+				state[s] += owner + ':' + d + ' ';
+			}
+		}
+	}
+
+	/* The automation that is played back in each segment */
+
+	for (RouteList::iterator r = routes->begin (); r != routes->end (); ++r) {
+		string const owner = (*r)->id ().to_s ();
+
+		add_automation (**r, owner, state);
+
+		if ((*r)->pannable ()) {
+			add_automation (*(*r)->pannable (), owner, state);
+		}
+
+		boost::shared_ptr<Processor> p;
+		for (uint32_t n = 0; (p = (*r)->nth_processor (n)); ++n) {
+			boost::shared_ptr<Automatable> a = boost::dynamic_pointer_cast<Automatable> (p);
+			if (a) {
+				add_automation (*a, owner + ':' + p->id ().to_s (), state);
+			}
+		}
+	}
+
+	_hashes.reserve (n_segments);
+	for (uint32_t s = 0; s < n_segments; ++s) {
+		_hashes.push_back (md5_digest (string_compose ("%1 %2 %3", segment_start (s), segment_end (s), state[s])));
+	}
+	_changed.assign (n_segments, false);
+}
+
+ExportSegments::ExportSegments (XMLNode const & node)
+	: _start (0)
+	, _end (0)
+	, _segment_frames (0)
+{
+	XMLProperty const * prop;
+
+	if ((prop = node.property ("start"))) {
+		_start = atoll (prop->value ());
+	}
+	if ((prop = node.property ("end"))) {
+		_end = atoll (prop->value ());
+	}
+	if ((prop = node.property ("segment-frames"))) {
+		_segment_frames = atoll (prop->value ());
+	}
+	if ((prop = node.property ("chain"))) {
+		_chain = prop->value ();
+	}
+
+	XMLNodeList const & children = node.children ("Segment");
+	for (XMLNodeConstIterator c = children.begin (); c != children.end (); ++c) {
+		if ((prop = (*c)->property ("hash"))) {
+			_hashes.push_back (prop->value ());
+		}
+	}
+	_changed.assign (_hashes.size (), false);
+}
+
+XMLNode &
+ExportSegments::get_state () const
+{
+	XMLNode * node = new XMLNode ("ExportSegments");
+	node->add_property ("start", to_string (_start, std::dec));
+	node->add_property ("end", to_string (_end, std::dec));
+	node->add_property ("segment-frames", to_string (_segment_frames, std::dec));
+	node->add_property ("chain", _chain);
+
+	for (vector<string>::const_iterator h = _hashes.begin (); h != _hashes.end (); ++h) {
+		XMLNode * segment = node->add_child ("Segment");
+		segment->add_property ("hash", *h);
+	}
+
+	return *node;
+}
+
+void
+ExportSegments::add_automation (Automatable const & automatable, string const & owner, vector<string> & state) const
+{
+	typedef vector<pair<double, double> > EventVector;
+
+	Evoral::ControlSet::Controls const & controls (automatable.controls ());
+
+	for (Evoral::ControlSet::Controls::const_iterator c = controls.begin (); c != controls.end (); ++c) {
+		boost::shared_ptr<AutomationControl> ac = boost::dynamic_pointer_cast<AutomationControl> (c->second);
+		if (!ac || !ac->automation_playback ()) {
+			continue;
+		}
+
+		boost::shared_ptr<AutomationList> list = ac->alist ();
+
+		EventVector events;
+		events.reserve (list->size ());
+		for (AutomationList::const_iterator e = list->begin (); e != list->end (); ++e) {
+			events.push_back (make_pair ((*e)->when, (*e)->value));
+		}
+
+		string const id = string_compose ("%1:%2:%3:%4:%5 ", owner, c->first.type (), c->first.id (), (int) c->first.channel (), (int) list->interpolation ());
+
+		for (uint32_t s = 0; s < state.size (); ++s) {
+			/* The events within the segment, and the ones either side of it
+			 * that the values in the segment are interpolated from
+			 */
+			EventVector::const_iterator first = lower_bound (events.begin (), events.end (), make_pair ((double) segment_start (s), -DBL_MAX));
+			EventVector::const_iterator last = lower_bound (events.begin (), events.end (), make_pair ((double) segment_end (s), -DBL_MAX));
+			if (first != events.begin ()) {
+				--first;
+			}
+			if (last != events.end ()) {
+				++last;
+			}
+
+			stringstream ss;
+			ss.precision (17);
+			ss << id;
+			for (EventVector::const_iterator e = first; e != last; ++e) {
+				ss << e->first << '=' << e->second << ' ';
+			}
+			state[s] += ss.str ();
+		}
+	}
+}
+
+void
+ExportSegments::compare (ExportSegments const & previous)
+{
+	bool const comparable = previous._start == _start
+		&& previous._segment_frames == _segment_frames
+		&& previous._chain == _chain;
+
+	for (uint32_t s = 0; s < _hashes.size (); ++s) {
+		if (!comparable || s >= previous._hashes.size () || previous._hashes[s] != _hashes[s]) {
+			_changed[s] = true;
+		}
+	}
+}
+
+void
+ExportSegments::change_last ()
+{
+	if (!_changed.empty ()) {
+		_changed.back () = true;
+	}
+}
+
+ExportSegments::RangeList
+ExportSegments::ranges (bool changed) const
+{
+	RangeList ranges;
+
+	for (uint32_t s = 0; s < _changed.size (); ++s) {
+		if (_changed[s] != changed) {
+			continue;
+		}
+		if (!ranges.empty () && ranges.back ().second == segment_start (s)) {
+			ranges.back ().second = segment_end (s);
+		} else {
+			ranges.push_back (make_pair (segment_start (s), segment_end (s)));
+		}
+	}
+
+	return ranges;
+}
+
+bool
+ExportSegments::deterministic (Session & session, string & reason)
+{
+	if (session.config.get_use_transport_fades ()) {
+		reason = _("transport fades are enabled, every rendered range would be faded in");
+		return false;
+	}
+
+	boost::shared_ptr<RouteList> routes = session.get_routes ();
+
+	for (RouteList::iterator r = routes->begin (); r != routes->end (); ++r) {
+		boost::shared_ptr<Processor> p;
+		for (uint32_t n = 0; (p = (*r)->nth_processor (n)); ++n) {
+			boost::shared_ptr<PluginInsert> pi = boost::dynamic_pointer_cast<PluginInsert> (p);
+			if (pi && pi->plugin_latency () > 0) {
+				reason = string_compose (_("\"%1\" uses the plugin \"%2\", which has latency"), (*r)->name (), pi->name ());
+				return false;
+			}
+			if (pi && pi->plugin ()->signal_tail_length () > 0) {
+				reason = string_compose (_("\"%1\" uses the plugin \"%2\", whose output goes on after its input"), (*r)->name (), pi->name ());
+				return false;
+			}
+			if (pi && pi->plugin ()->signal_tail_length () < 0) {
+				/* most plugins do not tell; a reverb or delay among them
+				   would have its tail cut at the start of a rendered range
+				*/
+				reason = string_compose (_("\"%1\" uses the plugin \"%2\", which does not report whether its output goes on after its input"), (*r)->name (), pi->name ());
+				return false;
+			}
+			if (boost::dynamic_pointer_cast<PortInsert> (p)) {
+				reason = string_compose (_("\"%1\" uses an external insert"), (*r)->name ());
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool
+ExportSegments::spliceable (Session const & session, ExportFormatSpecification const & format, string & reason)
+{
+	framecnt_t const session_rate = session.nominal_frame_rate ();
+	ExportFormatBase::SampleRate rate = format.sample_rate ();
+	if (rate == ExportFormatBase::SR_Session) {
+		rate = ExportFormatBase::nearest_sample_rate (session_rate);
+	}
+
+	if (format.format_id () == ExportFormatBase::F_Ogg) {
+		reason = _("the format is lossy");
+	} else if (rate != session_rate) {
+		reason = _("the sample rate is converted");
+	} else if (format.normalize ()) {
+		reason = _("it is normalized");
+	} else if (format.analyse ()) {
+		reason = _("it is analysed");
+	} else if (format.trim_beginning () || format.trim_end ()) {
+		reason = _("silence is trimmed");
+	} else if (format.silence_beginning_time ().not_zero () || format.silence_end_time ().not_zero ()) {
+		reason = _("silence is added");
+	} else if (format.dither_type () != ExportFormatBase::D_None && format.sample_format () != ExportFormatBase::SF_Float) {
+		reason = _("it is dithered");
+	} else {
+		return true;
+	}
+
+	return false;
+}
+
+} // namespace ARDOUR
@@ -52,6 +52,10 @@ ExportStatus::init ()
 
 	total_normalize_cycles = 0;
 	current_normalize_cycle = 0;
+
+	encoder_stalls = 0;
+	encoder_stall_time = 0;
+
 	result_map.clear();
 }
 
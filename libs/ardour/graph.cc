@@ -65,6 +65,7 @@ Graph::Graph (Session & session)
 	   memory in the RT thread.
 	*/
 	_trigger_queue.reserve (8192);
+	_task_queue.reserve (256);
 
         _execution_tokens = 0;
 
@@ -141,6 +142,7 @@ Graph::session_going_away()
         _init_trigger_list[0].clear();
         _init_trigger_list[1].clear();
         _trigger_queue.clear();
+        _task_queue.clear();
 }
 
 void
@@ -354,20 +356,23 @@ Graph::rechain (boost::shared_ptr<RouteList> routelist, GraphEdges const & edges
 bool
 Graph::run_one()
 {
-        GraphNode* to_run;
+        GraphNode* to_run = 0;
+        GraphTask* task = 0;
 
         pthread_mutex_lock (&_trigger_mutex);
-        if (_trigger_queue.size()) {
+        /* tasks first: a node is waiting for them */
+        if (_task_queue.size()) {
+                task = _task_queue.back();
+                _task_queue.pop_back();
+        } else if (_trigger_queue.size()) {
                 to_run = _trigger_queue.back();
                 _trigger_queue.pop_back();
-        } else {
-                to_run = 0;
         }
 
 	/* the number of threads that are asleep */
 	int et = _execution_tokens;
-	/* the number of nodes that need to be run */
-	int ts = _trigger_queue.size();
+	/* the number of nodes and tasks that need to be run */
+	int ts = _trigger_queue.size() + _task_queue.size();
 
 	/* hence how many threads to wake up */
         int wakeup = min (et, ts);
@@ -380,7 +385,7 @@ Graph::run_one()
                 _execution_sem.signal ();
         }
 
-        while (to_run == 0) {
+        while (to_run == 0 && task == 0) {
                 _execution_tokens += 1;
                 pthread_mutex_unlock (&_trigger_mutex);
                 DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 goes to sleep\n", pthread_name()));
@@ -390,13 +395,22 @@ Graph::run_one()
                 }
                 DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 is awake\n", pthread_name()));
                 pthread_mutex_lock (&_trigger_mutex);
-                if (_trigger_queue.size()) {
+                if (_task_queue.size()) {
+                        task = _task_queue.back();
+                        _task_queue.pop_back();
+                } else if (_trigger_queue.size()) {
                         to_run = _trigger_queue.back();
                         _trigger_queue.pop_back();
                 }
         }
         pthread_mutex_unlock (&_trigger_mutex);
 
+        if (task) {
+                task->run ();
+                task->finished ();
+                return !_threads_active;
+        }
+
         to_run->process();
         to_run->finish (_current_chain);
 
@@ -597,6 +611,92 @@ Graph::process_one_route (Route* route)
         }
 }
 
+/** Count a queued task as done, and wake up the caller of run_tasks()
+ *  if it was the last one. The task's call may return as soon as that
+ *  has happened.
+ */
+void
+GraphTask::finished ()
+{
+	GraphTask* leader = _leader;
+
+	if (g_atomic_int_dec_and_test (&leader->_unfinished)) {
+		leader->_done.signal ();
+	}
+}
+
+/** Run @param n_tasks tasks and return when all of them have finished.
+ *
+ *  This is meant to be called by a graph thread while it processes a node:
+ *  the first task is run by the calling thread, the others are offered to
+ *  sleeping graph threads. Tasks that no other thread has picked up by the
+ *  time the caller is done are run by the caller, so this never waits for
+ *  a thread to become available; it only sleeps until the tasks that
+ *  other threads are running have finished.
+ */
+void
+Graph::run_tasks (GraphTask* const * tasks, uint32_t n_tasks)
+{
+	if (n_tasks == 0) {
+		return;
+	}
+
+	GraphTask* leader = tasks[0];
+
+	if (n_tasks == 1) {
+		leader->run ();
+		return;
+	}
+
+	g_atomic_int_set (&leader->_unfinished, n_tasks - 1);
+
+	pthread_mutex_lock (&_trigger_mutex);
+
+	for (uint32_t n = 1; n < n_tasks; ++n) {
+		tasks[n]->_leader = leader;
+		_task_queue.push_back (tasks[n]);
+	}
+
+	int wakeup = min ((int) _execution_tokens, (int) n_tasks - 1);
+	_execution_tokens -= wakeup;
+
+	for (int i = 0; i < wakeup; i++) {
+		_execution_sem.signal ();
+	}
+
+	pthread_mutex_unlock (&_trigger_mutex);
+
+	leader->run ();
+
+	while (true) {
+
+		GraphTask* task = 0;
+
+		pthread_mutex_lock (&_trigger_mutex);
+		for (std::vector<GraphTask*>::iterator i = _task_queue.begin(); i != _task_queue.end(); ++i) {
+			if ((*i)->_leader == leader) {
+				task = *i;
+				_task_queue.erase (i);
+				break;
+			}
+		}
+		pthread_mutex_unlock (&_trigger_mutex);
+
+		if (!task) {
+			break;
+		}
+
+		task->run ();
+		task->finished ();
+	}
+
+	/* the remaining tasks are being run by other threads; whichever
+	 * finishes last (possibly this one, above) signals the leader.
+	 */
+
+	leader->_done.wait ();
+}
+
 bool
 Graph::in_process_thread () const
 {
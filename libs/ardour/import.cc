@@ -42,6 +42,10 @@
 
 #include "pbd/basename.h"
 #include "pbd/convert.h"
+#include "pbd/cpus.h"
+
+#include "audiographer/sink.h"
+#include "audiographer/general/async_sink.h"
 
 #include "evoral/SMF.hpp"
 
@@ -227,30 +231,111 @@ compose_status_message (const string& path,
 	return string_compose (_("Copying %1"), Glib::path_get_basename (path));
 }
 
+namespace {
+
+/** The progress of importing one file, set by the thread that imports it
+ *  and read by the one that reports it.
+ */
+class ImportProgress
+{
+  public:
+	ImportProgress () : _permille (0) {}
+
+	void set (float progress) { g_atomic_int_set (&_permille, (gint) (progress * 1000)); }
+	float get () const { return g_atomic_int_get (&_permille) / 1000.f; }
+
+  private:
+	mutable gint _permille;
+};
+
+/** Writes interleaved data to one mono source per channel */
+class MonoSourcesWriter : public AudioGrapher::Sink<Sample>
+{
+  public:
+	MonoSourcesWriter (vector<boost::shared_ptr<Source> > const & newfiles)
+	{
+		for (vector<boost::shared_ptr<Source> >::const_iterator i = newfiles.begin(); i != newfiles.end(); ++i) {
+			sources.push_back (boost::dynamic_pointer_cast<AudioFileSource> (*i));
+			channel_data.push_back (boost::shared_array<Sample> (new Sample[max_frames]));
+		}
+	}
+
+	void process (AudioGrapher::ProcessContext<Sample> const & c)
+	{
+		uint32_t const channels = sources.size();
+		Sample const * data = c.data();
+		framecnt_t frames_left = c.frames_per_channel();
+
+		while (frames_left > 0) {
+			framecnt_t const nfread = std::min (frames_left, max_frames);
+
+			/* de-interleave */
+
+			for (uint32_t chn = 0; chn < channels; ++chn) {
+				framecnt_t x, n;
+				for (x = chn, n = 0; n < nfread; x += channels, ++n) {
+					channel_data[chn][n] = data[x];
+				}
+			}
+
+			/* flush to disk */
+
+			for (uint32_t chn = 0; chn < channels; ++chn) {
+				if (sources[chn]) {
+					sources[chn]->write (channel_data[chn].get(), nfread);
+				}
+			}
+
+			data += nfread * channels;
+			frames_left -= nfread;
+		}
+
+#ifdef PLATFORM_WINDOWS
+		if (c.has_flag (AudioGrapher::ProcessContext<Sample>::EndOfInput)) {
+			/* Flush the data once we've finished importing the file. Windows can  */
+			/* cache the data for very long periods of time (perhaps not writing   */
+			/* it to disk until Ardour closes). So let's force it to flush now.    */
+			for (uint32_t chn = 0; chn < channels; ++chn) {
+				if (sources[chn]) {
+					sources[chn]->flush ();
+				}
+			}
+		}
+#endif
+	}
+
+	using AudioGrapher::Sink<Sample>::process;
+
+  private:
+	static const framecnt_t max_frames = 8192;
+
+	vector<boost::shared_ptr<AudioFileSource> > sources;
+	vector<boost::shared_array<Sample> >        channel_data;
+};
+
+} // anonymous namespace
+
+/** Reads (and resamples) @a source in this thread, while another thread
+ *  de-interleaves the data and writes it to @a newfiles.
+ */
 static void
-write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
+write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status, ImportProgress& progress,
                                vector<boost::shared_ptr<Source> >& newfiles)
 {
 	const framecnt_t nframes = ResampledImportableSource::blocksize;
-	boost::shared_ptr<AudioFileSource> afs;
 	uint32_t channels = source->channels();
 	if (channels == 0) {
 		return;
 	}
 
 	boost::scoped_array<float> data(new float[nframes * channels]);
-	vector<boost::shared_array<Sample> > channel_data;
-
-	for (uint32_t n = 0; n < channels; ++n) {
-		channel_data.push_back(boost::shared_array<Sample>(new Sample[nframes]));
-	}
 
 	float gain = 1;
 
 	boost::shared_ptr<AudioSource> s = boost::dynamic_pointer_cast<AudioSource> (newfiles[0]);
 	assert (s);
 
-	status.progress = 0.0f;
+	progress.set (0);
 	float progress_multiplier = 1;
 	float progress_base = 0;
 
@@ -273,7 +358,7 @@ write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
 			peak = compute_peak (data.get(), nread, peak);
 
 			read_count += nread;
-			status.progress = 0.5 * read_count / (source->ratio() * source->length() * channels);
+			progress.set (0.5 * read_count / (source->ratio() * source->length() * channels));
 		}
 
 		if (peak >= 1) {
@@ -286,64 +371,53 @@ write_audio_data_to_new_files (ImportableSource* source, ImportStatus& status,
 		progress_base = 0.5;
 	}
 
-	framecnt_t read_count = 0;
-
-	while (!status.cancel) {
-
-		framecnt_t nread, nfread;
-		uint32_t x;
-		uint32_t chn;
-
-		if ((nread = source->read (data.get(), nframes)) == 0) {
-#ifdef PLATFORM_WINDOWS
-			/* Flush the data once we've finished importing the file. Windows can  */
-			/* cache the data for very long periods of time (perhaps not writing   */
-			/* it to disk until Ardour closes). So let's force it to flush now.    */
-			for (chn = 0; chn < channels; ++chn)
-				if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(newfiles[chn])) != 0)
-					afs->flush ();
-#endif
-			break;
-		}
+	/* the writer can queue a few blocks, so that decoding and
+	   resampling go on while it waits for the disk
+	*/
+	boost::shared_ptr<MonoSourcesWriter> writer (new MonoSourcesWriter (newfiles));
+	AudioGrapher::AsyncSink<Sample> async_writer (writer, channels, 4 * nframes);
 
-		if (gain != 1) {
-			/* here is the gain fix for out-of-range sample values that we computed earlier */
-			apply_gain_to_buffer (data.get(), nread, gain);
-		}
+	framecnt_t read_count = 0;
 
-		nfread = nread / channels;
+	try {
+		while (!status.cancel) {
 
-		/* de-interleave */
+			framecnt_t nread;
 
-		for (chn = 0; chn < channels; ++chn) {
+			if ((nread = source->read (data.get(), nframes)) == 0) {
+				/* wait for the writer to finish */
+				AudioGrapher::ProcessContext<Sample> c (data.get(), 0, channels);
+				c.set_flag (AudioGrapher::ProcessContext<Sample>::EndOfInput);
+				async_writer.process (c);
+				break;
+			}
 
-			framecnt_t n;
-			for (x = chn, n = 0; n < nfread; x += channels, ++n) {
-				channel_data[chn][n] = (Sample) data[x];
+			if (gain != 1) {
+				/* here is the gain fix for out-of-range sample values that we computed earlier */
+				apply_gain_to_buffer (data.get(), nread, gain);
 			}
-		}
 
-		/* flush to disk */
+			AudioGrapher::ProcessContext<Sample> c (data.get(), nread, channels);
+			async_writer.process (c);
 
-		for (chn = 0; chn < channels; ++chn) {
-			if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(newfiles[chn])) != 0) {
-				afs->write (channel_data[chn].get(), nfread);
-			}
+			read_count += nread;
+			progress.set (progress_base + progress_multiplier * read_count / (source->ratio () * source->length() * channels));
 		}
-
-		read_count += nread;
-		status.progress = progress_base + progress_multiplier * read_count / (source->ratio () * source->length() * channels);
+	} catch (std::exception& e) {
+		error << string_compose (_("Import: error writing imported data (%1)"), e.what()) << endmsg;
+		status.cancel = true;
 	}
 }
 
 static void
-write_midi_data_to_new_files (Evoral::SMF* source, ImportStatus& status,
+write_midi_data_to_new_files (Evoral::SMF* source, ImportStatus& status, ImportProgress& progress,
                               vector<boost::shared_ptr<Source> >& newfiles)
 {
 	uint32_t buf_size = 4;
 	uint8_t* buf      = (uint8_t*) malloc (buf_size);
+	float    done     = 0;
 
-	status.progress = 0.0f;
+	progress.set (0);
 
 	assert (newfiles.size() == source->num_tracks());
 
@@ -398,8 +472,9 @@ write_midi_data_to_new_files (Evoral::SMF* source, ImportStatus& status,
 						size,
 						buf));
 
-				if (status.progress < 0.99) {
-					status.progress += 0.01;
+				if (done < 0.99) {
+					done += 0.01;
+					progress.set (done);
 				}
 			}
 
@@ -444,93 +519,271 @@ remove_file_source (boost::shared_ptr<Source> source)
 	}
 }
 
-// This function is still unable to cleanly update an existing source, even though
-// it is possible to set the ImportStatus flag accordingly. The functinality
-// is disabled at the GUI until the Source implementations are able to provide
-// the necessary API.
+namespace {
+
+typedef vector<boost::shared_ptr<Source> > Sources;
+
+/** Imports the files of an ImportStatus, several at once.
+ *  Opening the files and creating the new sources for them is done in order,
+ *  one file at a time, as it picks the names of the new files and adds the
+ *  sources to the session. Reading, resampling and writing the data of the
+ *  files happens in parallel. The ImportStatus reports on the first file
+ *  that is not finished yet, as if the files were imported one by one.
+ */
+class ParallelImporter
+{
+  public:
+	ParallelImporter (Session& s, ImportStatus& status)
+		: _session (s)
+		, _status (status)
+		, _files (status.paths.size())
+		, _next (0)
+		, _running (0)
+		, _first_current (status.current)
+	{}
+
+	void run ();
+
+	/** The sources created for each file, in the order of the files,
+	 *  including those of files that failed to import
+	 */
+	vector<Sources> new_sources () const;
+
+  private:
+	struct File {
+		File () : finished (false) {}
+
+		boost::shared_ptr<ImportableSource> source;
+		boost::shared_ptr<Evoral::SMF>      smf_reader;
+		Sources                             newfiles;
+		string                              doing_what;
+		ImportProgress                      progress;
+		bool                                finished;
+	};
+
+	Session&             _session;
+	ImportStatus&        _status;
+	vector<File>         _files;
+	size_t               _next;
+	uint32_t             _running;
+	uint32_t             _first_current;
+	Glib::Threads::Mutex _lock;
+
+	void thread_work ();
+	bool open (size_t n);
+	void import (File& file);
+	void update_status ();
+};
+
 void
-Session::import_files (ImportStatus& status)
+ParallelImporter::run ()
 {
-	typedef vector<boost::shared_ptr<Source> > Sources;
-	Sources all_new_sources;
-	boost::shared_ptr<AudioFileSource> afs;
-	boost::shared_ptr<SMFSource> smfs;
-	uint32_t channels = 0;
+	vector<Glib::Threads::Thread*> threads;
+	const uint32_t n_threads = std::min ((size_t) hardware_concurrency(), _files.size());
 
-	status.sources.clear ();
+	for (uint32_t n = 0; n < n_threads; ++n) {
+		try {
+			Glib::Threads::Mutex::Lock lm (_lock);
+			threads.push_back (Glib::Threads::Thread::create (boost::bind (&ParallelImporter::thread_work, this)));
+			++_running;
+		} catch (Glib::Threads::ThreadError&) {
+			break;
+		}
+	}
 
-	for (vector<string>::const_iterator p = status.paths.begin();
-	     p != status.paths.end() && !status.cancel;
-	     ++p)
-	{
-		boost::shared_ptr<ImportableSource> source;
-		std::auto_ptr<Evoral::SMF>          smf_reader;
-		const DataType type = SMFSource::safe_midi_file_extension (*p) ? DataType::MIDI : DataType::AUDIO;
-
-		if (type == DataType::AUDIO) {
-			try {
-				source = open_importable_source (*p, frame_rate(), status.quality);
-				channels = source->channels();
-			} catch (const failed_constructor& err) {
-				error << string_compose(_("Import: cannot open input sound file \"%1\""), (*p)) << endmsg;
-				status.done = status.cancel = true;
-				return;
+	if (threads.empty()) {
+		/* import in this thread */
+		++_running;
+		thread_work ();
+	}
+
+	/* report progress until all threads are done */
+
+	while (true) {
+		{
+			Glib::Threads::Mutex::Lock lm (_lock);
+			update_status ();
+			if (_running == 0) {
+				break;
 			}
+		}
+		Glib::usleep (20000);
+	}
+
+	for (vector<Glib::Threads::Thread*>::iterator t = threads.begin(); t != threads.end(); ++t) {
+		(*t)->join ();
+	}
+}
 
-		} else {
-			try {
-				smf_reader = std::auto_ptr<Evoral::SMF>(new Evoral::SMF());
-				smf_reader->open(*p);
-				channels = smf_reader->num_tracks();
-			} catch (...) {
-				error << _("Import: error opening MIDI file") << endmsg;
-				status.done = status.cancel = true;
+void
+ParallelImporter::thread_work ()
+{
+	while (true) {
+		File* file;
+
+		{
+			Glib::Threads::Mutex::Lock lm (_lock);
+
+			if (_next == _files.size() || _status.cancel) {
+				--_running;
 				return;
 			}
-		}
 
-		if (channels == 0) {
-			error << _("Import: file contains no channels.") << endmsg;
-			continue;
+			size_t const n = _next++;
+			file = &_files[n];
+
+			if (!open (n)) {
+				file->finished = true;
+				continue;
+			}
 		}
 
-		vector<string> new_paths = get_paths_for_new_sources (status.replace_existing_source, *p, channels);
-		Sources newfiles;
-		framepos_t natural_position = source ? source->natural_position() : 0;
+		import (*file);
 
+		Glib::Threads::Mutex::Lock lm (_lock);
+		file->finished = true;
+	}
+}
 
-		if (status.replace_existing_source) {
-			fatal << "THIS IS NOT IMPLEMENTED YET, IT SHOULD NEVER GET CALLED!!! DYING!" << endmsg;
-			status.cancel = !map_existing_mono_sources (new_paths, *this, frame_rate(), newfiles, this);
-		} else {
-			status.cancel = !create_mono_sources_for_writing (new_paths, *this, frame_rate(), newfiles, natural_position);
-		}
+/** Open the @a n th file and create the new sources for it.
+ *  Must be called with _lock held.
+ *  @return true if the file can be imported
+ */
+bool
+ParallelImporter::open (size_t n)
+{
+	File& file (_files[n]);
+	string const & path (_status.paths[n]);
 
-		// copy on cancel/failure so that any files that were created will be removed below
-		std::copy (newfiles.begin(), newfiles.end(), std::back_inserter(all_new_sources));
+	uint32_t channels = 0;
+	const DataType type = SMFSource::safe_midi_file_extension (path) ? DataType::MIDI : DataType::AUDIO;
 
-		if (status.cancel) {
-			break;
+	if (type == DataType::AUDIO) {
+		try {
+			file.source = open_importable_source (path, _session.frame_rate(), _status.quality);
+			channels = file.source->channels();
+		} catch (const failed_constructor& err) {
+			error << string_compose(_("Import: cannot open input sound file \"%1\""), path) << endmsg;
+			_status.cancel = true;
+			return false;
 		}
 
-		for (Sources::iterator i = newfiles.begin(); i != newfiles.end(); ++i) {
-			if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(*i)) != 0) {
-				afs->prepare_for_peakfile_writes ();
-			}
+	} else {
+		try {
+			file.smf_reader.reset (new Evoral::SMF());
+			file.smf_reader->open(path);
+			channels = file.smf_reader->num_tracks();
+		} catch (...) {
+			error << _("Import: error opening MIDI file") << endmsg;
+			_status.cancel = true;
+			return false;
+		}
+	}
+
+	if (channels == 0) {
+		error << _("Import: file contains no channels.") << endmsg;
+		return false;
+	}
+
+	vector<string> new_paths = _session.get_paths_for_new_sources (_status.replace_existing_source, path, channels);
+	framepos_t natural_position = file.source ? file.source->natural_position() : 0;
+
+	bool ok;
+
+	if (_status.replace_existing_source) {
+		fatal << "THIS IS NOT IMPLEMENTED YET, IT SHOULD NEVER GET CALLED!!! DYING!" << endmsg;
+		ok = map_existing_mono_sources (new_paths, _session, _session.frame_rate(), file.newfiles, &_session);
+	} else {
+		ok = create_mono_sources_for_writing (new_paths, _session, _session.frame_rate(), file.newfiles, natural_position);
+	}
+
+	if (!ok) {
+		/* any files that were created will be removed by the caller */
+		_status.cancel = true;
+		return false;
+	}
+
+	boost::shared_ptr<AudioFileSource> afs;
+	for (Sources::iterator i = file.newfiles.begin(); i != file.newfiles.end(); ++i) {
+		if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(*i)) != 0) {
+			afs->prepare_for_peakfile_writes ();
 		}
+	}
+
+	if (file.source) {
+		file.doing_what = compose_status_message (path, file.source->samplerate(),
+		                                          _session.frame_rate(), _first_current + n, _status.total);
+	} else {
+		file.doing_what = string_compose(_("Loading MIDI file %1"), path);
+	}
 
-		if (source) { // audio
-			status.doing_what = compose_status_message (*p, source->samplerate(),
-			                                            frame_rate(), status.current, status.total);
-			write_audio_data_to_new_files (source.get(), status, newfiles);
-		} else if (smf_reader.get()) { // midi
-			status.doing_what = string_compose(_("Loading MIDI file %1"), *p);
-			write_midi_data_to_new_files (smf_reader.get(), status, newfiles);
+	return true;
+}
+
+void
+ParallelImporter::import (File& file)
+{
+	if (file.source) { // audio
+		write_audio_data_to_new_files (file.source.get(), _status, file.progress, file.newfiles);
+	} else if (file.smf_reader) { // midi
+		write_midi_data_to_new_files (file.smf_reader.get(), _status, file.progress, file.newfiles);
+	}
+
+	/* close the input */
+	file.source.reset ();
+	file.smf_reader.reset ();
+}
+
+/** Must be called with _lock held */
+void
+ParallelImporter::update_status ()
+{
+	size_t n = 0;
+	while (n < _files.size() && _files[n].finished) {
+		++n;
+	}
+
+	_status.current = _first_current + n;
+
+	if (n < _files.size()) {
+		if (!_files[n].doing_what.empty()) {
+			_status.doing_what = _files[n].doing_what;
 		}
+		_status.progress = _files[n].progress.get ();
+	} else {
+		_status.progress = 0;
+	}
+}
 
-		++status.current;
-		status.progress = 0;
+vector<Sources>
+ParallelImporter::new_sources () const
+{
+	vector<Sources> sources;
+	for (vector<File>::const_iterator f = _files.begin(); f != _files.end(); ++f) {
+		sources.push_back (f->newfiles);
 	}
+	return sources;
+}
+
+} // anonymous namespace
+
+// This function is still unable to cleanly update an existing source, even though
+// it is possible to set the ImportStatus flag accordingly. The functinality
+// is disabled at the GUI until the Source implementations are able to provide
+// the necessary API.
+void
+Session::import_files (ImportStatus& status)
+{
+	boost::shared_ptr<AudioFileSource> afs;
+	boost::shared_ptr<SMFSource> smfs;
+
+	status.sources.clear ();
+	status.sources_per_path.clear ();
+
+	ParallelImporter importer (*this, status);
+	importer.run ();
+
+	vector<Sources> all_new_sources = importer.new_sources ();
 
 	if (!status.cancel) {
 		struct tm* now;
@@ -539,55 +792,61 @@ Session::import_files (ImportStatus& status)
 		now = localtime (&xnow);
 		status.freeze = true;
 
-		/* flush the final length(s) to the header(s) */
+		for (vector<Sources>::iterator f = all_new_sources.begin(); f != all_new_sources.end(); ++f) {
+
+			/* flush the final length(s) to the header(s) */
 
-		for (Sources::iterator x = all_new_sources.begin(); x != all_new_sources.end(); ) {
+			for (Sources::iterator x = f->begin(); x != f->end(); ) {
 
-			if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(*x)) != 0) {
-				afs->update_header((*x)->natural_position(), *now, xnow);
-				afs->done_with_peakfile_writes ();
+				if ((afs = boost::dynamic_pointer_cast<AudioFileSource>(*x)) != 0) {
+					afs->update_header((*x)->natural_position(), *now, xnow);
+					afs->done_with_peakfile_writes ();
 
-				/* now that there is data there, requeue the file for analysis */
+					/* now that there is data there, requeue the file for analysis */
 
-				if (Config->get_auto_analyse_audio()) {
-					Analyser::queue_source_for_analysis (boost::static_pointer_cast<Source>(*x), false);
+					if (Config->get_auto_analyse_audio()) {
+						Analyser::queue_source_for_analysis (boost::static_pointer_cast<Source>(*x), false);
+					}
 				}
-			}
 
-			/* imported, copied files cannot be written or removed
-			 */
-
-			boost::shared_ptr<FileSource> fs = boost::dynamic_pointer_cast<FileSource>(*x);
-			if (fs) {
-				/* Only audio files should be marked as
-				   immutable - we may need to rewrite MIDI
-				   files at any time.
-				*/
-				if (boost::dynamic_pointer_cast<AudioFileSource> (fs)) {
-					fs->mark_immutable ();
-				} else {
-					fs->mark_immutable_except_write ();
+				/* imported, copied files cannot be written or removed
+				 */
+
+				boost::shared_ptr<FileSource> fs = boost::dynamic_pointer_cast<FileSource>(*x);
+				if (fs) {
+					/* Only audio files should be marked as
+					   immutable - we may need to rewrite MIDI
+					   files at any time.
+					*/
+					if (boost::dynamic_pointer_cast<AudioFileSource> (fs)) {
+						fs->mark_immutable ();
+					} else {
+						fs->mark_immutable_except_write ();
+					}
+					fs->mark_nonremovable ();
 				}
-				fs->mark_nonremovable ();
-			}
 
-			/* don't create tracks for empty MIDI sources (channels) */
+				/* don't create tracks for empty MIDI sources (channels) */
 
-			if ((smfs = boost::dynamic_pointer_cast<SMFSource>(*x)) != 0 && smfs->is_empty()) {
-				x = all_new_sources.erase(x);
-			} else {
-				++x;
+				if ((smfs = boost::dynamic_pointer_cast<SMFSource>(*x)) != 0 && smfs->is_empty()) {
+					x = f->erase(x);
+				} else {
+					++x;
+				}
 			}
+
+			std::copy (f->begin(), f->end(), std::back_inserter(status.sources));
+			status.sources_per_path.push_back (f->size ());
 		}
 
 		/* save state so that we don't lose these new Sources */
 
 		save_state (_name);
-
-		std::copy (all_new_sources.begin(), all_new_sources.end(), std::back_inserter(status.sources));
 	} else {
 		try {
-			std::for_each (all_new_sources.begin(), all_new_sources.end(), remove_file_source);
+			for (vector<Sources>::iterator f = all_new_sources.begin(); f != all_new_sources.end(); ++f) {
+				std::for_each (f->begin(), f->end(), remove_file_source);
+			}
 		} catch (...) {
 			error << _("Failed to remove some files after failed/cancelled import operation") << endmsg;
 		}
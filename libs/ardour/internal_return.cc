@@ -41,11 +41,16 @@ InternalReturn::run (BufferSet& bufs, framepos_t /*start_frame*/, framepos_t /*e
 	Glib::Threads::Mutex::Lock lm (_sends_mutex, Glib::Threads::TRY_LOCK);
 
 	if (lm.locked ()) {
+		_send_buffers.clear ();
 		for (list<InternalSend*>::iterator i = _sends.begin(); i != _sends.end(); ++i) {
 			if ((*i)->active () && (!(*i)->source_route() || (*i)->source_route()->active())) {
-				bufs.merge_from ((*i)->get_buffers(), nframes);
+				_send_buffers.push_back (&(*i)->get_buffers());
 			}
 		}
+		/* merge all sends at once, so that MIDI from many sources
+		 * is combined in a single pass.
+		 */
+		bufs.merge_from (_send_buffers, nframes);
 	}
 
 	_active = _pending_active;
@@ -56,6 +61,7 @@ InternalReturn::add_send (InternalSend* send)
 {
 	Glib::Threads::Mutex::Lock lm (_sends_mutex);
 	_sends.push_back (send);
+	_send_buffers.reserve (_sends.size ());
 }
 
 void
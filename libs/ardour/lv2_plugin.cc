@@ -17,6 +17,8 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <limits>
@@ -42,6 +44,7 @@
 #include "ardour/audio_buffer.h"
 #include "ardour/audioengine.h"
 #include "ardour/debug.h"
+#include "ardour/filesystem_paths.h"
 #include "ardour/lv2_plugin.h"
 #include "ardour/session.h"
 #include "ardour/tempo.h"
@@ -176,7 +179,8 @@ public:
 #endif
 
 private:
-	bool _bundle_checked;
+	bool                 _bundle_checked;
+	Glib::Threads::Mutex _bundle_lock;
 };
 
 static LV2World _world;
@@ -2850,6 +2854,9 @@ LV2World::~LV2World()
 void
 LV2World::load_bundled_plugins(bool verbose)
 {
+	/* plugins may be instantiated from several threads at once */
+	Glib::Threads::Mutex::Lock lm (_bundle_lock);
+
 	if (!_bundle_checked) {
 		if (verbose) {
 			cout << "Scanning folders for bundled LV2s: " << ARDOUR::lv2_bundled_search_path().to_string() << endl;
@@ -2888,6 +2895,9 @@ LV2PluginInfo::~LV2PluginInfo()
 PluginPtr
 LV2PluginInfo::load(Session& session)
 {
+	/* plugins are only loaded into the world once one is needed */
+	_world.load_bundled_plugins(true);
+
 	try {
 		PluginPtr plugin;
 		const LilvPlugins* plugins = lilv_world_get_all_plugins(_world.world);
@@ -2912,6 +2922,7 @@ LV2PluginInfo::get_presets (bool /*user_only*/) const
 	std::vector<Plugin::PresetRecord> p;
 #ifndef NO_PLUGIN_STATE
 	const LilvPlugin* lp = NULL;
+	_world.load_bundled_plugins(true);
 	try {
 		PluginPtr plugin;
 		const LilvPlugins* plugins = lilv_world_get_all_plugins(_world.world);
@@ -2976,119 +2987,383 @@ LV2PluginInfo::is_instrument () const
 	return false;
 }
 
-PluginInfoList*
-LV2PluginInfo::discover()
+/** @return information about @a p for the plugin list, or 0 if it can not be used */
+static LV2PluginInfoPtr
+lv2_plugin_info (LV2World& world, const LilvPlugin* p)
 {
-	LV2World world;
-	world.load_bundled_plugins();
-	_world.load_bundled_plugins(true);
+	const LilvNode* pun = lilv_plugin_get_uri(p);
+	if (!pun) {
+		return LV2PluginInfoPtr ();
+	}
 
-	PluginInfoList*    plugs   = new PluginInfoList;
-	const LilvPlugins* plugins = lilv_world_get_all_plugins(world.world);
+	LV2PluginInfoPtr info(new LV2PluginInfo(lilv_node_as_string(pun)));
 
-	LILV_FOREACH(plugins, i, plugins) {
-		const LilvPlugin* p = lilv_plugins_get(plugins, i);
-		const LilvNode* pun = lilv_plugin_get_uri(p);
-		if (!pun) continue;
-		LV2PluginInfoPtr info(new LV2PluginInfo(lilv_node_as_string(pun)));
-
-		LilvNode* name = lilv_plugin_get_name(p);
-		if (!name || !lilv_plugin_get_port_by_index(p, 0)) {
-			warning << "Ignoring invalid LV2 plugin "
-			        << lilv_node_as_string(lilv_plugin_get_uri(p))
-			        << endmsg;
-			continue;
+	LilvNode* name = lilv_plugin_get_name(p);
+	if (!name || !lilv_plugin_get_port_by_index(p, 0)) {
+		warning << "Ignoring invalid LV2 plugin "
+		        << lilv_node_as_string(lilv_plugin_get_uri(p))
+		        << endmsg;
+		return LV2PluginInfoPtr ();
+	}
+
+	if (lilv_plugin_has_feature(p, world.lv2_inPlaceBroken)) {
+		warning << string_compose(
+		    _("Ignoring LV2 plugin \"%1\" since it cannot do inplace processing."),
+		    lilv_node_as_string(name)) << endmsg;
+		lilv_node_free(name);
+		return LV2PluginInfoPtr ();
+	}
+
+#ifdef HAVE_LV2_1_2_0
+	LilvNodes *required_features = lilv_plugin_get_required_features (p);
+	if (lilv_nodes_contains (required_features, world.bufz_powerOf2BlockLength) ||
+			lilv_nodes_contains (required_features, world.bufz_fixedBlockLength)
+	   ) {
+		warning << string_compose(
+		    _("Ignoring LV2 plugin \"%1\" because its buffer-size requirements cannot be satisfied."),
+		    lilv_node_as_string(name)) << endmsg;
+		lilv_nodes_free(required_features);
+		lilv_node_free(name);
+		return LV2PluginInfoPtr ();
+	}
+	lilv_nodes_free(required_features);
+#endif
+
+	info->type = LV2;
+
+	info->name = string(lilv_node_as_string(name));
+	lilv_node_free(name);
+	ARDOUR::PluginScanMessage(_("LV2"), info->name, false);
+
+	const LilvPluginClass* pclass = lilv_plugin_get_class(p);
+	const LilvNode*        label  = lilv_plugin_class_get_label(pclass);
+	info->category = lilv_node_as_string(label);
+
+	LilvNode* author_name = lilv_plugin_get_author_name(p);
+	info->creator = author_name ? string(lilv_node_as_string(author_name)) : "Unknown";
+	lilv_node_free(author_name);
+
+	info->path = "/NOPATH"; // Meaningless for LV2
+
+	/* count atom-event-ports that feature
+	 * atom:supports <http://lv2plug.in/ns/ext/midi#MidiEvent>
+	 *
+	 * TODO: nicely ask drobilla to make a lilv_ call for that
+	 */
+	int count_midi_out = 0;
+	int count_midi_in = 0;
+	for (uint32_t i = 0; i < lilv_plugin_get_num_ports(p); ++i) {
+		const LilvPort* port  = lilv_plugin_get_port_by_index(p, i);
+		if (lilv_port_is_a(p, port, world.atom_AtomPort)) {
+			LilvNodes* buffer_types = lilv_port_get_value(
+				p, port, world.atom_bufferType);
+			LilvNodes* atom_supports = lilv_port_get_value(
+				p, port, world.atom_supports);
+
+			if (lilv_nodes_contains(buffer_types, world.atom_Sequence)
+					&& lilv_nodes_contains(atom_supports, world.midi_MidiEvent)) {
+				if (lilv_port_is_a(p, port, world.lv2_InputPort)) {
+					count_midi_in++;
+				}
+				if (lilv_port_is_a(p, port, world.lv2_OutputPort)) {
+					count_midi_out++;
+				}
+			}
+			lilv_nodes_free(buffer_types);
+			lilv_nodes_free(atom_supports);
 		}
+	}
 
-		if (lilv_plugin_has_feature(p, world.lv2_inPlaceBroken)) {
-			warning << string_compose(
-			    _("Ignoring LV2 plugin \"%1\" since it cannot do inplace processing."),
-			    lilv_node_as_string(name)) << endmsg;
-			lilv_node_free(name);
+	info->n_inputs.set_audio(
+		lilv_plugin_get_num_ports_of_class(
+			p, world.lv2_InputPort, world.lv2_AudioPort, NULL));
+	info->n_inputs.set_midi(
+		lilv_plugin_get_num_ports_of_class(
+			p, world.lv2_InputPort, world.ev_EventPort, NULL)
+		+ count_midi_in);
+
+	info->n_outputs.set_audio(
+		lilv_plugin_get_num_ports_of_class(
+			p, world.lv2_OutputPort, world.lv2_AudioPort, NULL));
+	info->n_outputs.set_midi(
+		lilv_plugin_get_num_ports_of_class(
+			p, world.lv2_OutputPort, world.ev_EventPort, NULL)
+		+ count_midi_out);
+
+	info->unique_id = lilv_node_as_uri(lilv_plugin_get_uri(p));
+	info->index     = 0; // Meaningless for LV2
+
+	return info;
+}
+
+/* The LV2 plugin cache.
+ *
+ * Parsing the description of every installed plugin through lilv takes
+ * seconds with a few hundred plugins.  The information that discover()
+ * extracts is kept in a file, grouped by the bundle each plugin lives in,
+ * along with a stamp of each bundle that describes a plugin.  lilv still
+ * finds the bundles (reading only their manifests), but only plugins
+ * described by a bundle that has changed since are parsed again.
+ */
+
+namespace {
+
+/** What a bundle looked like: enough to notice any change to it */
+struct LV2BundleStamp {
+	LV2BundleStamp () : mtime (0), size (0), inode (0) {}
+
+	bool operator== (LV2BundleStamp const & other) const {
+		return mtime == other.mtime && size == other.size && inode == other.inode;
+	}
+
+	int64_t  mtime; ///< latest modification time of the bundle and its data files
+	int64_t  size;  ///< total size of its data files
+	uint64_t inode; ///< of the bundle folder, which changes when it is replaced
+};
+
+struct LV2CachedBundle {
+	LV2CachedBundle () : valid (false) {}
+	LV2BundleStamp stamp;
+	bool           valid; ///< describes the bundle as it is on disk now
+	PluginInfoList plugins;
+};
+
+typedef std::map<std::string, LV2CachedBundle> LV2BundleCache;
+
+}
+
+static std::string
+lv2_cache_path ()
+{
+	return Glib::build_filename (ARDOUR::user_cache_directory(), "lv2_cache");
+}
+
+/** @return the current stamp of @a bundle */
+static LV2BundleStamp
+lv2_bundle_stamp (std::string const & bundle)
+{
+	LV2BundleStamp stamp;
+	GStatBuf       statbuf;
+
+	if (g_stat (bundle.c_str(), &statbuf) != 0) {
+		return stamp;
+	}
+
+	stamp.mtime = statbuf.st_mtime;
+	stamp.inode = statbuf.st_ino;
+
+	vector<string> files;
+	find_files_matching_pattern (files, bundle, "*.ttl");
+
+	for (vector<string>::iterator f = files.begin(); f != files.end(); ++f) {
+		if (g_stat (f->c_str(), &statbuf) == 0) {
+			stamp.mtime = std::max (stamp.mtime, (int64_t) statbuf.st_mtime);
+			stamp.size += statbuf.st_size;
+		}
+	}
+
+	return stamp;
+}
+
+/** @return the folder of @a uri, a bundle or a file in one, without a trailing separator */
+static std::string
+lv2_bundle_path (const LilvNode* uri, bool is_file)
+{
+	std::string path;
+
+	try {
+		path = Glib::filename_from_uri (lilv_node_as_uri (uri));
+	} catch (Glib::ConvertError& err) {
+		return std::string ();
+	}
+
+	if (is_file) {
+		path = Glib::path_get_dirname (path);
+	}
+
+	while (path.length() > 1 && path[path.length() - 1] == G_DIR_SEPARATOR) {
+		path.erase (path.length() - 1);
+	}
+
+	return path;
+}
+
+static std::string
+cached_value (XMLNode const & node, const char* name)
+{
+	XMLProperty const * prop = node.property (name);
+	return prop ? prop->value() : std::string ();
+}
+
+static void
+lv2_read_cache (LV2BundleCache& cache)
+{
+	XMLTree tree;
+
+	if (!Glib::file_test (lv2_cache_path (), Glib::FILE_TEST_EXISTS) || !tree.read (lv2_cache_path ())) {
+		return;
+	}
+
+	XMLNodeConstIterator b;
+
+	for (b = tree.root()->children().begin(); b != tree.root()->children().end(); ++b) {
+
+		XMLProperty const * path  = (*b)->property (X_("path"));
+		XMLProperty const * mtime = (*b)->property (X_("mtime"));
+
+		if (!path || !mtime) {
 			continue;
 		}
 
-#ifdef HAVE_LV2_1_2_0
-		LilvNodes *required_features = lilv_plugin_get_required_features (p);
-		if (lilv_nodes_contains (required_features, world.bufz_powerOf2BlockLength) ||
-				lilv_nodes_contains (required_features, world.bufz_fixedBlockLength)
-		   ) {
-			warning << string_compose(
-			    _("Ignoring LV2 plugin \"%1\" because its buffer-size requirements cannot be satisfied."),
-			    lilv_node_as_string(name)) << endmsg;
-			lilv_nodes_free(required_features);
-			lilv_node_free(name);
+		LV2CachedBundle& bundle (cache[path->value()]);
+		bundle.stamp.mtime = PBD::atoll (mtime->value());
+		bundle.stamp.size  = PBD::atoll (cached_value (**b, X_("size")));
+		bundle.stamp.inode = strtoull (cached_value (**b, X_("inode")).c_str(), 0, 10);
+
+		for (XMLNodeConstIterator n = (*b)->children().begin(); n != (*b)->children().end(); ++n) {
+
+			XMLProperty const * uri = (*n)->property (X_("uri"));
+
+			if (!uri) {
+				continue;
+			}
+
+			LV2PluginInfoPtr info (new LV2PluginInfo (uri->value().c_str()));
+
+			info->name      = cached_value (**n, X_("name"));
+			info->category  = cached_value (**n, X_("category"));
+			info->creator   = cached_value (**n, X_("creator"));
+			info->path      = "/NOPATH"; // Meaningless for LV2
+			info->unique_id = uri->value();
+			info->index     = 0; // Meaningless for LV2
+
+			info->n_inputs.set_audio (PBD::atoi (cached_value (**n, X_("audio-inputs"))));
+			info->n_inputs.set_midi (PBD::atoi (cached_value (**n, X_("midi-inputs"))));
+			info->n_outputs.set_audio (PBD::atoi (cached_value (**n, X_("audio-outputs"))));
+			info->n_outputs.set_midi (PBD::atoi (cached_value (**n, X_("midi-outputs"))));
+
+			bundle.plugins.push_back (info);
+		}
+	}
+}
+
+static void
+lv2_write_cache (LV2BundleCache const & cache)
+{
+	XMLNode* root = new XMLNode (X_("LV2Cache"));
+
+	for (LV2BundleCache::const_iterator b = cache.begin(); b != cache.end(); ++b) {
+
+		if (!b->second.valid) {
 			continue;
 		}
-		lilv_nodes_free(required_features);
-#endif
 
-		info->type = LV2;
+		XMLNode* bundle = root->add_child (X_("Bundle"));
+		bundle->add_property (X_("path"), b->first);
+		bundle->add_property (X_("mtime"), PBD::to_string (b->second.stamp.mtime, std::dec));
+		bundle->add_property (X_("size"), PBD::to_string (b->second.stamp.size, std::dec));
+		bundle->add_property (X_("inode"), PBD::to_string (b->second.stamp.inode, std::dec));
+
+		for (PluginInfoList::const_iterator i = b->second.plugins.begin(); i != b->second.plugins.end(); ++i) {
+			XMLNode* node = bundle->add_child (X_("Plugin"));
+			node->add_property (X_("uri"), (*i)->unique_id);
+			node->add_property (X_("name"), (*i)->name);
+			node->add_property (X_("category"), (*i)->category);
+			node->add_property (X_("creator"), (*i)->creator);
+			node->add_property (X_("audio-inputs"), PBD::to_string ((*i)->n_inputs.n_audio(), std::dec));
+			node->add_property (X_("midi-inputs"), PBD::to_string ((*i)->n_inputs.n_midi(), std::dec));
+			node->add_property (X_("audio-outputs"), PBD::to_string ((*i)->n_outputs.n_audio(), std::dec));
+			node->add_property (X_("midi-outputs"), PBD::to_string ((*i)->n_outputs.n_midi(), std::dec));
+		}
+	}
+
+	XMLTree tree;
+	tree.set_root (root);
 
-		info->name = string(lilv_node_as_string(name));
-		lilv_node_free(name);
-		ARDOUR::PluginScanMessage(_("LV2"), info->name, false);
+	if (!tree.write (lv2_cache_path ())) {
+		warning << string_compose (_("Could not write LV2 plugin cache to %1"), lv2_cache_path ()) << endmsg;
+	}
+}
+
+PluginInfoList*
+LV2PluginInfo::discover()
+{
+	LV2BundleCache cache;
+	lv2_read_cache (cache);
+
+	/* lilv finds the bundles, in LV2_PATH or its default folders and
+	 * ours, but only loads their manifests here; the data of a plugin is
+	 * not parsed unless one of the lilv_plugin_get_* calls in
+	 * lv2_plugin_info() needs it.
+	 */
 
-		const LilvPluginClass* pclass = lilv_plugin_get_class(p);
-		const LilvNode*        label  = lilv_plugin_class_get_label(pclass);
-		info->category = lilv_node_as_string(label);
+	LV2World world;
+	world.load_bundled_plugins();
 
-		LilvNode* author_name = lilv_plugin_get_author_name(p);
-		info->creator = author_name ? string(lilv_node_as_string(author_name)) : "Unknown";
-		lilv_node_free(author_name);
+	PluginInfoList* plugs = new PluginInfoList;
+	LV2BundleCache updated;
+	size_t reused = 0;
 
-		info->path = "/NOPATH"; // Meaningless for LV2
+	const LilvPlugins* plugins = lilv_world_get_all_plugins(world.world);
 
-		/* count atom-event-ports that feature
-		 * atom:supports <http://lv2plug.in/ns/ext/midi#MidiEvent>
-		 *
-		 * TODO: nicely ask drobilla to make a lilv_ call for that
+	LILV_FOREACH(plugins, i, plugins) {
+		const LilvPlugin* p = lilv_plugins_get(plugins, i);
+		const std::string bundle = lv2_bundle_path (lilv_plugin_get_bundle_uri (p), false);
+
+		/* a plugin needs to be looked at again if any bundle that
+		 * contributes to its description has changed.
 		 */
-		int count_midi_out = 0;
-		int count_midi_in = 0;
-		for (uint32_t i = 0; i < lilv_plugin_get_num_ports(p); ++i) {
-			const LilvPort* port  = lilv_plugin_get_port_by_index(p, i);
-			if (lilv_port_is_a(p, port, world.atom_AtomPort)) {
-				LilvNodes* buffer_types = lilv_port_get_value(
-					p, port, world.atom_bufferType);
-				LilvNodes* atom_supports = lilv_port_get_value(
-					p, port, world.atom_supports);
-
-				if (lilv_nodes_contains(buffer_types, world.atom_Sequence)
-						&& lilv_nodes_contains(atom_supports, world.midi_MidiEvent)) {
-					if (lilv_port_is_a(p, port, world.lv2_InputPort)) {
-						count_midi_in++;
-					}
-					if (lilv_port_is_a(p, port, world.lv2_OutputPort)) {
-						count_midi_out++;
-					}
-				}
-				lilv_nodes_free(buffer_types);
-				lilv_nodes_free(atom_supports);
+
+		std::vector<std::string> folders;
+		folders.push_back (bundle);
+
+		const LilvNodes* data_uris = lilv_plugin_get_data_uris (p);
+		LILV_FOREACH(nodes, d, data_uris) {
+			folders.push_back (lv2_bundle_path (lilv_nodes_get (data_uris, d), true));
+		}
+
+		bool rescan = false;
+
+		for (std::vector<std::string>::const_iterator f = folders.begin(); f != folders.end(); ++f) {
+			LV2CachedBundle& entry (updated[*f]);
+			if (!entry.valid) {
+				entry.valid = true;
+				entry.stamp = lv2_bundle_stamp (*f);
+			}
+			LV2BundleCache::const_iterator c = cache.find (*f);
+			if (f->empty() || c == cache.end() || !(c->second.stamp == entry.stamp)) {
+				rescan = true;
 			}
 		}
 
-		info->n_inputs.set_audio(
-			lilv_plugin_get_num_ports_of_class(
-				p, world.lv2_InputPort, world.lv2_AudioPort, NULL));
-		info->n_inputs.set_midi(
-			lilv_plugin_get_num_ports_of_class(
-				p, world.lv2_InputPort, world.ev_EventPort, NULL)
-			+ count_midi_in);
+		LV2CachedBundle& entry (updated[bundle]);
 
-		info->n_outputs.set_audio(
-			lilv_plugin_get_num_ports_of_class(
-				p, world.lv2_OutputPort, world.lv2_AudioPort, NULL));
-		info->n_outputs.set_midi(
-			lilv_plugin_get_num_ports_of_class(
-				p, world.lv2_OutputPort, world.ev_EventPort, NULL)
-			+ count_midi_out);
+		if (!rescan) {
+			/* a plugin that is not in the cache was ignored last time */
+			const std::string uri = lilv_node_as_uri (lilv_plugin_get_uri (p));
+			LV2CachedBundle const & cached (cache[bundle]);
+			for (PluginInfoList::const_iterator ci = cached.plugins.begin(); ci != cached.plugins.end(); ++ci) {
+				if ((*ci)->unique_id == uri) {
+					entry.plugins.push_back (*ci);
+					plugs->push_back (*ci);
+					break;
+				}
+			}
+			++reused;
+			continue;
+		}
 
-		info->unique_id = lilv_node_as_uri(lilv_plugin_get_uri(p));
-		info->index     = 0; // Meaningless for LV2
+		LV2PluginInfoPtr info = lv2_plugin_info (world, p);
 
-		plugs->push_back(info);
+		if (info) {
+			entry.plugins.push_back (info);
+			plugs->push_back (info);
+		}
 	}
 
+	DEBUG_TRACE (DEBUG::PluginManager, string_compose ("LV2: used cached information for %1 of %2 plugins\n", reused, lilv_plugins_size (plugins)));
+
+	lv2_write_cache (updated);
+
 	return plugs;
 }
@@ -52,6 +52,14 @@ AutomationList*
 MidiAutomationListBinder::get () const
 {
 	boost::shared_ptr<MidiModel> model = _source->model ();
+
+	if (!model) {
+		/* models are built on demand */
+		Source::Lock lm (_source->mutex ());
+		_source->load_model (lm);
+		model = _source->model ();
+	}
+
 	assert (model);
 
 	boost::shared_ptr<AutomationControl> control = model->automation_control (_parameter);
@@ -32,6 +32,9 @@ using namespace std;
 using namespace ARDOUR;
 using namespace PBD;
 
+/** number of buffers combined by a single pass of the k-way merge */
+static const size_t max_merge_sources = 128;
+
 // FIXME: mirroring for MIDI buffers?
 MidiBuffer::MidiBuffer(size_t capacity)
 	: Buffer (DataType::MIDI)
@@ -573,3 +576,197 @@ MidiBuffer::merge_in_place (const MidiBuffer &other)
 	return true;
 }
 
+
+namespace {
+
+/** read position inside one of the buffers taking part in a k-way merge */
+struct MergeCursor {
+	const uint8_t* data;
+	size_t         pos;
+	size_t         end;
+	size_t         index; ///< position in the list of sources, used to order otherwise equal events
+};
+
+inline MidiBuffer::TimeType
+cursor_time (const MergeCursor& c)
+{
+	return *(reinterpret_cast<const MidiBuffer::TimeType*>((uintptr_t)(c.data + c.pos)));
+}
+
+inline uint8_t
+cursor_status (const MergeCursor& c)
+{
+	return c.data[c.pos + sizeof (MidiBuffer::TimeType)];
+}
+
+/** @return true if the event under @a a must be delivered before the event under @a b */
+inline bool
+cursor_precedes (const MergeCursor& a, const MergeCursor& b)
+{
+	const MidiBuffer::TimeType ta = cursor_time (a);
+	const MidiBuffer::TimeType tb = cursor_time (b);
+
+	if (ta != tb) {
+		return ta < tb;
+	}
+
+	const bool a_first = MidiBuffer::second_simultaneous_midi_byte_is_first (cursor_status (b), cursor_status (a));
+	const bool b_first = MidiBuffer::second_simultaneous_midi_byte_is_first (cursor_status (a), cursor_status (b));
+
+	if (a_first != b_first) {
+		return a_first;
+	}
+
+	return a.index < b.index;
+}
+
+void
+merge_heap_sift_down (MergeCursor** heap, size_t n, size_t i)
+{
+	while (true) {
+		const size_t l = 2 * i + 1;
+		const size_t r = l + 1;
+		size_t first = i;
+
+		if (l < n && cursor_precedes (*heap[l], *heap[first])) {
+			first = l;
+		}
+		if (r < n && cursor_precedes (*heap[r], *heap[first])) {
+			first = r;
+		}
+		if (first == i) {
+			break;
+		}
+
+		MergeCursor* tmp = heap[i];
+		heap[i] = heap[first];
+		heap[first] = tmp;
+		i = first;
+	}
+}
+
+} // anonymous namespace
+
+/** Merge the events of all of @a others into this buffer in a single pass.
+ *
+ * This is a k-way merge: each event is copied exactly once, so the cost is
+ * linear in the total amount of data (times log(k) to pick the next event),
+ * rather than shifting the contents of this buffer once per source as
+ * repeated calls to merge_in_place (const MidiBuffer&) would.
+ *
+ * The existing contents of this buffer are moved to the end of the
+ * allocated space and take part in the merge as one more source. They are
+ * consumed at least as fast as merged data is written, so no scratch
+ * buffer is required. Realtime safe.
+ *
+ * @return false if the events of one or more sources did not fit into this
+ * buffer and were dropped.
+ */
+bool
+MidiBuffer::merge_in_place (const MidiBuffer* const* others, size_t n_others)
+{
+	if (n_others > max_merge_sources) {
+		bool ret = true;
+		for (size_t done = 0; done < n_others; done += max_merge_sources) {
+			const size_t todo = (n_others - done > max_merge_sources) ? max_merge_sources : n_others - done;
+			if (!merge_in_place (others + done, todo)) {
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
+	MergeCursor  cursors[max_merge_sources + 1];
+	MergeCursor* heap[max_merge_sources + 1];
+	size_t       n = 0;
+	size_t       incoming = 0;
+	bool         ret = true;
+
+	for (size_t i = 0; i < n_others; ++i) {
+		const MidiBuffer* other = others[i];
+
+		assert (other != this);
+
+		if (!other || other->size() == 0) {
+			continue;
+		}
+
+		if (_size + incoming + other->size() > _capacity) {
+			DEBUG_TRACE (DEBUG::MidiIO, string_compose ("k-way merge: dropping %1 bytes from source %2, buffer full\n", other->size(), i));
+			ret = false;
+			continue;
+		}
+
+		cursors[n].data  = other->_data;
+		cursors[n].pos   = 0;
+		cursors[n].end   = other->_size;
+		cursors[n].index = i + 1;
+
+		incoming += other->size();
+		++n;
+	}
+
+	if (n == 0) {
+		return ret;
+	}
+
+	if (_size == 0 && n == 1) {
+		memcpy (_data, cursors[0].data, cursors[0].end);
+		_size = cursors[0].end;
+		_silent = false;
+		return ret;
+	}
+
+	DEBUG_TRACE (DEBUG::MidiIO, string_compose ("k-way merge of %1 buffers, sizes %2/%3\n", n, size(), incoming));
+
+	if (_size) {
+		/* park our own events at the end of the buffer, they are
+		 * source 0 of the merge.
+		 */
+		const size_t own_start = _capacity - _size;
+		memmove (_data + own_start, _data, _size);
+
+		cursors[n].data  = _data;
+		cursors[n].pos   = own_start;
+		cursors[n].end   = _capacity;
+		cursors[n].index = 0;
+		++n;
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		heap[i] = &cursors[i];
+	}
+
+	for (size_t i = n / 2; i > 0; --i) {
+		merge_heap_sift_down (heap, n, i - 1);
+	}
+
+	size_t written = 0;
+
+	while (n) {
+		MergeCursor& c (*heap[0]);
+		const uint8_t* ev = c.data + c.pos;
+		const int event_size = Evoral::midi_event_size (ev + sizeof (TimeType));
+		assert (event_size >= 0);
+		const size_t bytes = sizeof (TimeType) + event_size;
+
+		/* may overlap when copying our own (parked) events */
+		memmove (_data + written, ev, bytes);
+
+		written += bytes;
+		c.pos += bytes;
+
+		if (c.pos >= c.end) {
+			heap[0] = heap[--n];
+		}
+
+		merge_heap_sift_down (heap, n, 0);
+	}
+
+	assert (written <= _capacity);
+
+	_size = written;
+	_silent = false;
+
+	return ret;
+}
@@ -376,6 +376,13 @@ MidiPlaylist::contained_automation()
 	for (RegionList::const_iterator r = regions.begin(); r != regions.end(); ++r) {
 		boost::shared_ptr<MidiRegion> mr = boost::dynamic_pointer_cast<MidiRegion>(*r);
 
+		if (!mr->model()) {
+			/* not loaded, so it can not have been edited; any
+			   automation in the file is played back as MIDI data.
+			*/
+			continue;
+		}
+
 		for (Automatable::Controls::iterator c = mr->model()->controls().begin();
 				c != mr->model()->controls().end(); ++c) {
 			if (c->second->list()->size() > 0) {
@@ -388,6 +388,11 @@ MidiSource::write_to (const Lock& lock, boost::shared_ptr<MidiSource> newsrc, Ev
 	newsrc->copy_interpolation_from (this);
 	newsrc->copy_automation_state_from (this);
 
+	if (!_model) {
+		/* models are built on demand */
+		load_model (lock);
+	}
+
 	if (_model) {
 		if (begin == Evoral::MinBeats && end == Evoral::MaxBeats) {
 			_model->write_to (newsrc, newsrc_lock);
@@ -31,11 +31,13 @@
 #include "ardour/automation_list.h"
 #include "ardour/buffer_set.h"
 #include "ardour/debug.h"
+#include "ardour/graph.h"
 #include "ardour/event_type_map.h"
 #include "ardour/ladspa_plugin.h"
 #include "ardour/luaproc.h"
 #include "ardour/plugin.h"
 #include "ardour/plugin_insert.h"
+#include "ardour/plugin_pool.h"
 #include "ardour/port.h"
 
 #ifdef LV2_SUPPORT
@@ -65,6 +67,49 @@ using namespace PBD;
 
 const string PluginInsert::port_automation_node_name = "PortAutomation";
 
+namespace {
+
+/** Runs one instance of a replicated plugin, possibly in another process thread */
+class ReplicaTask : public GraphTask
+{
+  public:
+	ReplicaTask (boost::shared_ptr<Plugin> p)
+		: _plugin (p)
+		, _bufs (0)
+		, _in_map (0)
+		, _out_map (0)
+		, _nframes (0)
+		, _offset (0)
+		, _failed (false)
+	{}
+
+	void prepare (BufferSet& bufs, ChanMapping const & in_map, ChanMapping const & out_map, pframes_t nframes, framecnt_t offset) {
+		_bufs = &bufs;
+		_in_map = &in_map;
+		_out_map = &out_map;
+		_nframes = nframes;
+		_offset = offset;
+		_failed = false;
+	}
+
+	void run () {
+		_failed = _plugin->connect_and_run (*_bufs, *_in_map, *_out_map, _nframes, _offset) != 0;
+	}
+
+	bool failed () const { return _failed; }
+
+  private:
+	boost::shared_ptr<Plugin> _plugin;
+	BufferSet*                _bufs;
+	ChanMapping const *       _in_map;
+	ChanMapping const *       _out_map;
+	pframes_t                 _nframes;
+	framecnt_t                _offset;
+	bool                      _failed;
+};
+
+} // anonymous namespace
+
 PluginInsert::PluginInsert (Session& s, boost::shared_ptr<Plugin> plug)
 	: Processor (s, (plug ? plug->name() : string ("toBeRenamed")))
 	, _signal_analysis_collected_nframes(0)
@@ -74,6 +119,13 @@ PluginInsert::PluginInsert (Session& s, boost::shared_ptr<Plugin> plug)
 	, _strict_io (false)
 	, _custom_cfg (false)
 	, _maps_from_state (false)
+	, _parallel_replicas (false)
+	, _may_sleep (false)
+	, _sleeping (false)
+	, _wake_up (0)
+	, _tail_length (-1)
+	, _silent_input_frames (0)
+	, _silent_output_frames (0)
 {
 	/* the first is the master */
 
@@ -89,6 +141,27 @@ PluginInsert::PluginInsert (Session& s, boost::shared_ptr<Plugin> plug)
 
 PluginInsert::~PluginInsert ()
 {
+	drop_replica_tasks ();
+
+	if (_session.deletion_in_progress ()) {
+		return;
+	}
+
+	/* keep instances that nobody else uses around, in case this
+	 * insert is brought back (e.g. by undo)
+	 */
+
+	for (Plugins::iterator i = _plugins.begin(); i != _plugins.end(); ++i) {
+#if (defined WINDOWS_VST_SUPPORT || defined LXVST_SUPPORT)
+		boost::shared_ptr<VSTPlugin> vst = boost::dynamic_pointer_cast<VSTPlugin> (*i);
+		if (vst) {
+			vst->set_insert (0, 0);
+		}
+#endif
+		if (i->unique ()) {
+			_session.plugin_pool().keep (*i);
+		}
+	}
 }
 
 void
@@ -505,6 +578,8 @@ PluginInsert::activate ()
 		(*i)->activate ();
 	}
 
+	wake_up ();
+
 	Processor::activate ();
 }
 
@@ -524,6 +599,17 @@ PluginInsert::flush ()
 	for (vector<boost::shared_ptr<Plugin> >::iterator i = _plugins.begin(); i != _plugins.end(); ++i) {
 		(*i)->flush ();
 	}
+
+	wake_up ();
+}
+
+/** Run the plugin(s) again, even if the input stays silent.
+ *  This may be called from any thread, it takes effect in the next ::run().
+ */
+void
+PluginInsert::wake_up ()
+{
+	g_atomic_int_set (&_wake_up, 1);
 }
 
 void
@@ -568,6 +654,7 @@ PluginInsert::connect_and_run (BufferSet& bufs, pframes_t nframes, framecnt_t of
 	ChanMapping thru_map (_thru_map);
 	if (_mapping_changed) { // ToDo use a counters, increment until match.
 		_no_inplace = check_inplace ();
+		_parallel_replicas = replicas_are_independent ();
 		_mapping_changed = false;
 	}
 
@@ -780,11 +867,30 @@ PluginInsert::connect_and_run (BufferSet& bufs, pframes_t nframes, framecnt_t of
 		}
 	} else {
 		/* in-place processing */
-		uint32_t pc = 0;
-		for (Plugins::iterator i = _plugins.begin(); i != _plugins.end(); ++i, ++pc) {
-			if ((*i)->connect_and_run(bufs, in_map[pc], out_map[pc], nframes, offset)) {
+		Graph* graph = _session.process_graph ();
+
+		if (_parallel_replicas && graph && _replica_tasks.size () == _plugins.size () && graph->in_process_thread ()) {
+			/* replicas do not share any buffers they write to,
+			 * let idle process threads run some of them.
+			 */
+			bool failed = false;
+			for (uint32_t pc = 0; pc < _replica_tasks.size (); ++pc) {
+				static_cast<ReplicaTask*> (_replica_tasks[pc])->prepare (bufs, in_map[pc], out_map[pc], nframes, offset);
+			}
+			graph->run_tasks (&_replica_tasks[0], _replica_tasks.size ());
+			for (uint32_t pc = 0; pc < _replica_tasks.size (); ++pc) {
+				failed |= static_cast<ReplicaTask*> (_replica_tasks[pc])->failed ();
+			}
+			if (failed) {
 				deactivate ();
 			}
+		} else {
+			uint32_t pc = 0;
+			for (Plugins::iterator i = _plugins.begin(); i != _plugins.end(); ++i, ++pc) {
+				if ((*i)->connect_and_run(bufs, in_map[pc], out_map[pc], nframes, offset)) {
+					deactivate ();
+				}
+			}
 		}
 		// now silence unconnected outputs
 		inplace_silence_unconnected (bufs, _out_map, nframes, offset);
@@ -829,6 +935,7 @@ PluginInsert::bypass (BufferSet& bufs, pframes_t nframes)
 	ChanMapping out_map (output_map ());
 	if (_mapping_changed) {
 		_no_inplace = check_inplace ();
+		_parallel_replicas = replicas_are_independent ();
 		_mapping_changed = false;
 	}
 
@@ -964,12 +1071,57 @@ PluginInsert::run (BufferSet& bufs, framepos_t start_frame, framepos_t end_frame
 			_sidechain->run (bufs, start_frame, end_frame, nframes, true);
 		}
 
+		const bool silent_input = _may_sleep && Config->get_skip_silent_plugins () && bufs.is_silent (nframes);
+
+		if (!silent_input) {
+			g_atomic_int_set (&_wake_up, 0);
+			_sleeping = false;
+			_silent_input_frames = 0;
+			_silent_output_frames = 0;
+		} else if (g_atomic_int_compare_and_exchange (&_wake_up, 1, 0)) {
+			_sleeping = false;
+			_silent_output_frames = 0;
+		} else if (_sleeping) {
+			/* nothing goes in, and nothing is left to come out */
+			bufs.set_count (ChanCount::max (bufs.count(), _configured_out));
+			bufs.silence (nframes, 0);
+			_active = _pending_active;
+			return;
+		}
+
 		if (_session.transport_rolling() || _session.bounce_processing()) {
 			automation_run (bufs, start_frame, nframes);
 		} else {
 			connect_and_run (bufs, nframes, 0, false);
 		}
 
+		if (silent_input) {
+			/* once the output stays below -120dBFS for longer than the plugin's
+			 * latency, and the tail that the plugin reports has passed,
+			 * stop running the plugin until the input is no longer silent.
+			 *
+			 * Without a reported tail, both input and output must have been
+			 * silent for a while: a delay may well be quiet between echoes.
+			 */
+			static const Sample threshold = 1e-6;
+			const framecnt_t unknown_tail = 10 * _session.frame_rate ();
+			const framecnt_t input_hold = _tail_length >= 0 ? _tail_length : unknown_tail;
+			const framecnt_t output_hold = _tail_length >= 0 ? plugin_latency () : std::max (plugin_latency (), unknown_tail);
+
+			_silent_input_frames += nframes;
+
+			if (bufs.is_silent (nframes, threshold)) {
+				_silent_output_frames += nframes;
+			} else {
+				_silent_output_frames = 0;
+			}
+
+			if (_silent_input_frames > input_hold && _silent_output_frames > output_hold) {
+				DEBUG_TRACE (DEBUG::Processors, string_compose ("%1 sleeps after %2 samples of silence\n", name(), _silent_input_frames));
+				_sleeping = true;
+			}
+		}
+
 	} else {
 		bypass (bufs, nframes);
 		_delaybuffers.flush ();
@@ -1271,6 +1423,79 @@ PluginInsert::is_channelstrip () const {
 }
 #endif
 
+/** @return true if no instance of a replicated plugin writes to a buffer
+ * that another instance reads or writes, so that they can run at the same time.
+ */
+bool
+PluginInsert::replicas_are_independent () const
+{
+	if (_match.method != Replicate || _plugins.size () < 2) {
+		return false;
+	}
+
+	const ChanCount outs (natural_output_streams ());
+
+	for (uint32_t a = 0; a < _plugins.size (); ++a) {
+		PinMappings::const_iterator oa = _out_map.find (a);
+		if (oa == _out_map.end ()) {
+			continue;
+		}
+		for (DataType::iterator t = DataType::begin(); t != DataType::end(); ++t) {
+			for (uint32_t out = 0; out < outs.get (*t); ++out) {
+				bool valid;
+				const uint32_t idx = oa->second.get (*t, out, &valid);
+				if (!valid) {
+					continue;
+				}
+				for (uint32_t b = 0; b < _plugins.size (); ++b) {
+					if (b == a) {
+						continue;
+					}
+					PinMappings::const_iterator ib = _in_map.find (b);
+					PinMappings::const_iterator ob = _out_map.find (b);
+					if (ib != _in_map.end ()) {
+						ib->second.get_src (*t, idx, &valid);
+						if (valid) {
+							return false;
+						}
+					}
+					if (ob != _out_map.end ()) {
+						ob->second.get_src (*t, idx, &valid);
+						if (valid) {
+							return false;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void
+PluginInsert::setup_replica_tasks ()
+{
+	drop_replica_tasks ();
+
+	if (_match.method != Replicate || _plugins.size () < 2) {
+		return;
+	}
+
+	for (Plugins::iterator i = _plugins.begin(); i != _plugins.end(); ++i) {
+		_replica_tasks.push_back (new ReplicaTask (*i));
+	}
+}
+
+void
+PluginInsert::drop_replica_tasks ()
+{
+	for (std::vector<GraphTask*>::iterator i = _replica_tasks.begin(); i != _replica_tasks.end(); ++i) {
+		delete *i;
+	}
+	_replica_tasks.clear ();
+}
+
 bool
 PluginInsert::check_inplace ()
 {
@@ -1700,8 +1925,21 @@ PluginInsert::configure_io (ChanCount in, ChanCount out)
 	}
 
 	_no_inplace = check_inplace ();
+	_parallel_replicas = replicas_are_independent ();
 	_mapping_changed = false;
 
+	setup_replica_tasks ();
+
+	/* a plugin whose output only depends on its audio input can be
+	 * skipped while that is silent, see ::run()
+	 */
+	_may_sleep = !_sidechain
+		&& natural_input_streams ().n_audio () > 0
+		&& natural_input_streams ().n_midi () == 0
+		&& !_plugins.front ()->get_info ()->needs_midi_input ();
+	_tail_length = _plugins.front ()->signal_tail_length ();
+	wake_up ();
+
 	/* only the "noinplace_buffers" thread buffers need to be this large,
 	 * this can be optimized. other buffers are fine with
 	 * ChanCount::max (natural_input_streams (), natural_output_streams())
@@ -2243,7 +2481,14 @@ PluginInsert::set_state(const XMLNode& node, int version)
 		}
 	}
 
-	boost::shared_ptr<Plugin> plugin = find_plugin (_session, prop->value(), type);
+	const std::string unique_id (prop->value ());
+
+	/* the session may have an idle instance ready */
+	boost::shared_ptr<Plugin> plugin = _session.plugin_pool().take (type, unique_id);
+
+	if (!plugin) {
+		plugin = find_plugin (_session, prop->value(), type);
+	}
 
 	/* treat linux and windows VST plugins equivalent if they have the same uniqueID
 	 * allow to move sessions windows <> linux */
@@ -2310,7 +2555,8 @@ PluginInsert::set_state(const XMLNode& node, int version)
 
 	if (_plugins.size() != count) {
 		for (uint32_t n = 1; n < count; ++n) {
-			add_plugin (plugin_factory (plugin));
+			boost::shared_ptr<Plugin> p = _session.plugin_pool().take (type, unique_id);
+			add_plugin (p ? p : plugin_factory (plugin));
 		}
 	}
 
@@ -2609,6 +2855,11 @@ PluginInsert::PluginControl::_set_value (double user_val, PBD::Controllable::Gro
 {
 	/* FIXME: probably should be taking out some lock here.. */
 
+	if (user_val != get_value ()) {
+		/* the plugin may produce output again */
+		_plugin->wake_up ();
+	}
+
 	for (Plugins::iterator i = _plugin->_plugins.begin(); i != _plugin->_plugins.end(); ++i) {
 		(*i)->set_parameter (_list->parameter().id(), user_val);
 	}
@@ -392,6 +392,7 @@ PluginManager::clear_vst_cache ()
 			::g_unlink(i->c_str());
 		}
 	}
+	vstfx_clear_scan_db ();
 #endif
 }
 
@@ -815,11 +816,18 @@ PluginManager::windows_vst_discover_from_path (string path, bool cache_only)
 
 	find_files_matching_filter (plugin_objects, Config->get_plugin_path_vst(), windows_vst_filter, 0, false, true, true);
 
+	if (!cache_only && !cancelled()) {
+		/* scan everything that is not cached yet, several plugins at a time */
+		vstfx_scan_parallel (plugin_objects);
+	}
+
 	for (x = plugin_objects.begin(); x != plugin_objects.end (); ++x) {
 		ARDOUR::PluginScanMessage(_("VST"), *x, !cache_only && !cancelled());
 		windows_vst_discover (*x, cache_only || cancelled());
 	}
 
+	vstfx_save_scan_db ();
+
 	if (Config->get_verbose_plugin_scan()) {
 		info << _("--- Windows VST plugins Scan Done") << endmsg;
 	}
@@ -1015,11 +1023,18 @@ PluginManager::lxvst_discover_from_path (string path, bool cache_only)
 
 	find_files_matching_filter (plugin_objects, Config->get_plugin_path_lxvst(), lxvst_filter, 0, false, true, true);
 
+	if (!cache_only && !cancelled()) {
+		/* scan everything that is not cached yet, several plugins at a time */
+		vstfx_scan_parallel (plugin_objects);
+	}
+
 	for (x = plugin_objects.begin(); x != plugin_objects.end (); ++x) {
 		ARDOUR::PluginScanMessage(_("LXVST"), *x, !cache_only && !cancelled());
 		lxvst_discover (*x, cache_only || cancelled());
 	}
 
+	vstfx_save_scan_db ();
+
 	return ret;
 }
 
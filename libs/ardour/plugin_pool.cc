@@ -0,0 +1,291 @@
+/*
+    Copyright (C) 2016 Paul Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <algorithm>
+#include <cstdio>
+
+#include <boost/bind.hpp>
+
+#include "pbd/compose.h"
+#include "pbd/cpus.h"
+#include "pbd/failed_constructor.h"
+#include "pbd/xml++.h"
+
+#include "ardour/debug.h"
+#include "ardour/plugin_pool.h"
+#include "ardour/session.h"
+
+#include "i18n.h"
+
+using namespace std;
+using namespace ARDOUR;
+using namespace PBD;
+
+PluginPool::PluginPool (Session& s)
+	: _session (s)
+	, _next_job (0)
+{
+}
+
+PluginPool::~PluginPool ()
+{
+	clear ();
+}
+
+bool
+PluginPool::can_preinstantiate (PluginType t)
+{
+	switch (t) {
+	case LADSPA:
+	case LV2:
+		return true;
+	default:
+		/* VST and AudioUnit plugins may only be created in the GUI thread,
+		 * Lua plugins are cheap enough to not bother.
+		 */
+		return false;
+	}
+}
+
+/** Plugins of one type are instantiated one at a time: LV2 plugins are all
+ *  described by the one (not thread-safe) lilv world, and neither standard
+ *  promises that a plugin's instantiate() is reentrant.
+ */
+Glib::Threads::Mutex&
+PluginPool::instantiation_lock (PluginType t)
+{
+	switch (t) {
+	case LADSPA:
+		return _ladspa_lock;
+	default:
+		return _lv2_lock;
+	}
+}
+
+void
+PluginPool::preinstantiate (XMLNode const & routes, int version)
+{
+	if (version < 3000 || Session::get_disable_all_loaded_plugins ()) {
+		return;
+	}
+
+	wait ();
+
+	XMLNodeList const & rl (routes.children ());
+
+	for (XMLNodeConstIterator r = rl.begin(); r != rl.end(); ++r) {
+
+		XMLNodeList const & pl ((*r)->children ());
+
+		for (XMLNodeConstIterator p = pl.begin(); p != pl.end(); ++p) {
+
+			if ((*p)->name() != X_("Processor")) {
+				continue;
+			}
+
+			XMLProperty const * type = (*p)->property (X_("type"));
+			XMLProperty const * id = (*p)->property (X_("unique-id"));
+
+			if (!type || !id) {
+				continue;
+			}
+
+			PluginType t;
+
+			if (type->value() == X_("ladspa") || type->value() == X_("Ladspa")) {
+				t = LADSPA;
+			} else if (type->value() == X_("lv2")) {
+				t = LV2;
+			} else {
+				continue;
+			}
+
+			if (!can_preinstantiate (t)) {
+				continue;
+			}
+
+			uint32_t count = 1;
+			XMLProperty const * prop;
+
+			if ((prop = (*p)->property (X_("count"))) != 0) {
+				sscanf (prop->value().c_str(), "%u", &count);
+			}
+
+			for (uint32_t n = 0; n < count; ++n) {
+				_jobs.push_back (Job (t, id->value ()));
+			}
+		}
+	}
+
+	if (_jobs.empty ()) {
+		return;
+	}
+
+	DEBUG_TRACE (DEBUG::Processors, string_compose ("preinstantiating %1 plugins\n", _jobs.size()));
+
+	/* one thread per plugin type, see instantiation_lock() */
+
+	bool ladspa = false;
+	bool lv2 = false;
+
+	for (vector<Job>::const_iterator j = _jobs.begin(); j != _jobs.end(); ++j) {
+		ladspa = ladspa || j->type == LADSPA;
+		lv2 = lv2 || j->type == LV2;
+	}
+
+	const uint32_t n_types = (ladspa ? 1 : 0) + (lv2 ? 1 : 0);
+	const uint32_t n_threads = std::min (hardware_concurrency(), n_types);
+
+	for (uint32_t n = 0; n < n_threads; ++n) {
+		try {
+			_threads.push_back (Glib::Threads::Thread::create (boost::bind (&PluginPool::thread_work, this)));
+		} catch (Glib::Threads::ThreadError&) {
+			break;
+		}
+	}
+}
+
+void
+PluginPool::wait ()
+{
+	for (vector<Glib::Threads::Thread*>::iterator t = _threads.begin(); t != _threads.end(); ++t) {
+		(*t)->join ();
+	}
+
+	_threads.clear ();
+	_jobs.clear ();
+	_next_job = 0;
+}
+
+void
+PluginPool::thread_work ()
+{
+	while (true) {
+		size_t n;
+
+		{
+			Glib::Threads::Mutex::Lock lm (_job_lock);
+			if (_next_job == _jobs.size()) {
+				return;
+			}
+			n = _next_job++;
+		}
+
+		Job const & job (_jobs[n]);
+		PluginPtr p;
+
+		try {
+			Glib::Threads::Mutex::Lock lm (instantiation_lock (job.type));
+			p = find_plugin (_session, job.unique_id, job.type);
+		} catch (failed_constructor&) {
+			/* PluginInsert::set_state() will try again, and report it */
+		}
+
+		if (p) {
+			add (job.type, job.unique_id, p);
+		}
+	}
+}
+
+void
+PluginPool::add (PluginType type, std::string const & unique_id, PluginPtr p)
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	_entries.push_back (Entry (type, unique_id, p));
+}
+
+PluginPtr
+PluginPool::take (PluginType type, std::string const & unique_id)
+{
+	PluginPtr p;
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	/* most recent first: those are the ones most likely to be undone */
+
+	for (Entries::reverse_iterator i = _entries.rbegin(); i != _entries.rend(); ++i) {
+		if (i->type == type && i->unique_id == unique_id) {
+			p = i->plugin;
+			_entries.erase (--(i.base ()));
+			break;
+		}
+	}
+
+	return p;
+}
+
+void
+PluginPool::keep (PluginPtr p)
+{
+	if (!p || !p->get_info ()) {
+		return;
+	}
+
+	p->deactivate ();
+
+	Entries dropped;
+
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		expire_locked (dropped);
+		_entries.push_back (Entry (p->get_info()->type, p->get_info()->unique_id, p));
+
+		while (_entries.size() > max_kept) {
+			dropped.splice (dropped.end(), _entries, _entries.begin());
+		}
+	}
+
+	/* dropped instances are destroyed here, without holding the lock */
+}
+
+void
+PluginPool::expire ()
+{
+	Entries dropped;
+
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		expire_locked (dropped);
+	}
+}
+
+/** move entries that are older than max_age to @param dropped; _lock must be held */
+void
+PluginPool::expire_locked (Entries& dropped)
+{
+	const gint64 now = g_get_monotonic_time ();
+
+	/* entries are in the order they were added */
+
+	while (!_entries.empty() && now - _entries.front().kept > max_age) {
+		dropped.splice (dropped.end(), _entries, _entries.begin());
+	}
+}
+
+void
+PluginPool::clear ()
+{
+	wait ();
+
+	Entries dropped;
+
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		dropped.swap (_entries);
+	}
+}
@@ -84,6 +84,7 @@
 #include "ardour/playlist.h"
 #include "ardour/plugin.h"
 #include "ardour/plugin_insert.h"
+#include "ardour/plugin_pool.h"
 #include "ardour/process_thread.h"
 #include "ardour/profile.h"
 #include "ardour/rc_configuration.h"
@@ -226,6 +227,9 @@ Session::Session (AudioEngine &eng,
 	, _state_of_the_state (StateOfTheState(CannotSave|InitialConnecting|Loading))
 	, _suspend_save (0)
 	, _save_queued (false)
+	, _save_thread (0)
+	, _background_save (0)
+	, _background_save_done (0)
 	, _last_roll_location (0)
 	, _last_roll_or_reversal_location (0)
 	, _last_record_location (0)
@@ -238,6 +242,7 @@ Session::Session (AudioEngine &eng,
 	, lua (lua_newstate (&PBD::ReallocPool::lalloc, &_mempool))
 	, _n_lua_scripts (0)
 	, _butler (new Butler (*this))
+	, _plugin_pool (new PluginPool (*this))
 	, _post_transport_work (0)
 	,  cumulative_rf_motion (0)
 	, rf_scale (1.0)
@@ -586,6 +591,12 @@ Session::destroy ()
 {
 	vector<void*> debug_pointers;
 
+	{
+		/* let an autosave finish (and be reported) while everything it uses is still here */
+		Glib::Threads::Mutex::Lock lm (save_state_lock);
+		wait_for_background_save ();
+	}
+
 	/* if we got to here, leaving pending capture state around
 	   is a mistake.
 	*/
@@ -630,6 +641,10 @@ Session::destroy ()
 
 	_history.clear ();
 
+	if (!_history_spill_dir.empty()) {
+		PBD::remove_directory (_history_spill_dir);
+	}
+
 	/* clear state tree so that no references to objects are held any more */
 
 	delete state_tree;
@@ -715,6 +730,9 @@ Session::destroy ()
 	}
 	routes.flush ();
 
+	delete _plugin_pool;
+	_plugin_pool = 0;
+
 	{
 		DEBUG_TRACE (DEBUG::Destruction, "delete sources\n");
 		Glib::Threads::Mutex::Lock lm (source_lock);
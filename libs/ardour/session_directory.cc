@@ -233,6 +233,12 @@ SessionDirectory::peak_path () const
 	return Glib::build_filename (m_root_path, peak_dir_name);
 }
 
+const std::string
+SessionDirectory::automation_path () const
+{
+	return Glib::build_filename (m_root_path, automation_dir_name);
+}
+
 const std::string
 SessionDirectory::dead_path () const
 {
@@ -254,6 +260,7 @@ SessionDirectory::sub_directories () const
 	tmp_paths.push_back (midi_path ());
 	tmp_paths.push_back (video_path ());
 	tmp_paths.push_back (peak_path ());
+	tmp_paths.push_back (automation_path ());
 	tmp_paths.push_back (dead_path ());
 	tmp_paths.push_back (export_path ());
 
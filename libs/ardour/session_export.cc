@@ -112,6 +112,37 @@ Session::start_audio_export (framepos_t position)
 
 	_export_preroll = Config->get_export_preroll() * nominal_frame_rate ();
 
+	if (relocate_audio_export (position)) {
+		return -1;
+	}
+
+	export_status->stop = false;
+
+	/* get transport ready. note how this is calling butler functions
+	   from a non-butler thread. we waited for the butler to stop
+	   what it was doing earlier in Session::pre_export() and nothing
+	   since then has re-awakened it.
+	 */
+
+	/* we are ready to go ... */
+
+	if (!_engine.connected()) {
+		return -1;
+	}
+
+	_engine.Freewheel.connect_same_thread (export_freewheel_connection, boost::bind (&Session::process_export_fw, this, _1));
+	_export_rolling = true;
+	return _engine.freewheel (true);
+}
+
+/** Move all tracks to @param position for export, without starting an export
+ *  run: unlike start_audio_export() this does not reset the preroll or
+ *  re-arm freewheeling, so it may be called from the export process callback
+ *  to skip part of the timespan.
+ */
+int
+Session::relocate_audio_export (framepos_t position)
+{
 	/* We're about to call Track::seek, so the butler must have finished everything
 	   up otherwise it could be doing do_refill in its thread while we are doing
 	   it here.
@@ -141,23 +172,7 @@ Session::start_audio_export (framepos_t position)
 	*/
 
 	_transport_frame = position;
-	export_status->stop = false;
-
-	/* get transport ready. note how this is calling butler functions
-	   from a non-butler thread. we waited for the butler to stop
-	   what it was doing earlier in Session::pre_export() and nothing
-	   since then has re-awakened it.
-	 */
-
-	/* we are ready to go ... */
-
-	if (!_engine.connected()) {
-		return -1;
-	}
-
-	_engine.Freewheel.connect_same_thread (export_freewheel_connection, boost::bind (&Session::process_export_fw, this, _1));
-	_export_rolling = true;
-	return _engine.freewheel (true);
+	return 0;
 }
 
 int
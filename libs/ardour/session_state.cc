@@ -30,6 +30,7 @@
 #include <cstdio> /* snprintf(3) ... grrr */
 #include <cmath>
 #include <unistd.h>
+#include <fcntl.h>
 #include <climits>
 #include <signal.h>
 #include <sys/time.h>
@@ -71,6 +72,7 @@
 #include "pbd/pthread_utils.h"
 #include "pbd/stacktrace.h"
 #include "pbd/convert.h"
+#include "pbd/cpus.h"
 #include "pbd/localtime_r.h"
 #include "pbd/unwind.h"
 
@@ -82,6 +84,7 @@
 #include "ardour/audiofilesource.h"
 #include "ardour/audioregion.h"
 #include "ardour/automation_control.h"
+#include "ardour/automation_list.h"
 #include "ardour/boost_debug.h"
 #include "ardour/butler.h"
 #include "ardour/control_protocol_manager.h"
@@ -98,6 +101,7 @@
 #include "ardour/pannable.h"
 #include "ardour/playlist_factory.h"
 #include "ardour/playlist_source.h"
+#include "ardour/plugin_pool.h"
 #include "ardour/port.h"
 #include "ardour/processor.h"
 #include "ardour/profile.h"
@@ -181,6 +185,7 @@ Session::pre_engine_init (string fullpath)
 	last_rr_session_dir = session_dirs.begin();
 
 	set_history_depth (Config->get_history_depth());
+	set_history_memory_budget (Config->get_history_memory_budget());
 
         /* default: assume simple stereo speaker configuration */
 
@@ -484,6 +489,13 @@ Session::ensure_subdirs ()
 		return -1;
 	}
 
+	dir = session_directory().automation_path();
+
+	if (g_mkdir_with_parents (dir.c_str(), 0755) < 0) {
+		error << string_compose(_("Session: cannot create session automation folder \"%1\" (%2)"), dir, strerror (errno)) << endmsg;
+		return -1;
+	}
+
 	dir = session_directory().dead_path();
 
 	if (g_mkdir_with_parents (dir.c_str(), 0755) < 0) {
@@ -683,14 +695,30 @@ Session::create (const string& session_template, BusProfile* bus_profile)
 void
 Session::maybe_write_autosave()
 {
+	{
+		/* report on the last autosave if it has finished */
+		Glib::Threads::Mutex::Lock lm (save_state_lock, Glib::Threads::TRY_LOCK);
+		if (lm.locked() && g_atomic_int_get (&_background_save_done)) {
+			wait_for_background_save ();
+		}
+	}
+
         if (dirty() && record_status() != Recording) {
-                save_state("", true);
+                save_state_in_background ("", true);
         }
+
+	_plugin_pool->expire ();
 }
 
 void
 Session::remove_pending_capture_state ()
 {
+	{
+		/* an autosave may still be writing it */
+		Glib::Threads::Mutex::Lock lm (save_state_lock);
+		wait_for_background_save ();
+	}
+
 	std::string pending_state_file_path(_session_dir->root_path());
 
 	pending_state_file_path = Glib::build_filename (pending_state_file_path, legalize_for_path (_current_snapshot_name) + pending_suffix);
@@ -759,15 +787,119 @@ Session::remove_state (string snapshot_name)
 int
 Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot, bool template_only)
 {
-	DEBUG_TRACE (DEBUG::Locale, string_compose ("Session::save_state locale '%1'\n", setlocale (LC_NUMERIC, NULL)));
+	/* prevent concurrent saves from different threads */
 
-	XMLTree tree;
-	std::string xml_path(_session_dir->root_path());
+	Glib::Threads::Mutex::Lock lm (save_state_lock);
 
-	/* prevent concurrent saves from different threads */
+	wait_for_background_save ();
+
+	SavedState saved;
+	int ret;
+
+	if ((ret = capture_state (snapshot_name, pending, switch_to_snapshot, template_only, saved)) != 0) {
+		return ret;
+	}
+
+	ret = write_state (saved);
+	state_written (saved);
+
+	if (!pending) {
+		/* a good moment to give back the memory of unused plugin instances */
+		_plugin_pool->clear ();
+	}
 
+	return ret;
+}
+
+/** Like save_state(), but only the XML is created in the calling thread;
+ *  it is written to disk by another thread. StateSaveFinished is emitted
+ *  once the state is on disk or saving it has failed, see there.
+ *  @return zero if saving was started
+ */
+int
+Session::save_state_in_background (string snapshot_name, bool pending)
+{
 	Glib::Threads::Mutex::Lock lm (save_state_lock);
 
+	wait_for_background_save ();
+
+	SavedState* saved = new SavedState;
+	int ret;
+
+	if ((ret = capture_state (snapshot_name, pending, false, false, *saved)) != 0) {
+		delete saved;
+		return ret;
+	}
+
+	_background_save = saved;
+	g_atomic_int_set (&_background_save_done, 0);
+
+	try {
+		_save_thread = Glib::Threads::Thread::create (boost::bind (&Session::background_save, this, saved));
+	} catch (Glib::Threads::ThreadError&) {
+		background_save (saved);
+		wait_for_background_save ();
+	}
+
+	return 0;
+}
+
+/** Write state in the save thread. This only records how it went,
+ *  messages included: the session is told by wait_for_background_save().
+ */
+void
+Session::background_save (SavedState* saved)
+{
+	{
+		Transmitter::Capture capture;
+		write_state (*saved);
+		saved->messages = capture.messages ();
+	}
+
+	g_atomic_int_set (&_background_save_done, 1);
+}
+
+/** Wait for the state saved by save_state_in_background(), if any,
+ *  to be written, and act on the outcome from the calling thread.
+ *  Caller must hold save_state_lock.
+ */
+void
+Session::wait_for_background_save ()
+{
+	if (_save_thread) {
+		_save_thread->join ();
+		_save_thread = 0;
+	}
+
+	if (!_background_save) {
+		return;
+	}
+
+	SavedState* saved = _background_save;
+	_background_save = 0;
+
+	Transmitter::Capture::send (saved->messages);
+	state_written (*saved);
+	StateSaveFinished (saved->snapshot_name, saved->written); /* EMIT SIGNAL */
+
+	delete saved;
+}
+
+Session::SavedState::~SavedState ()
+{
+	delete state;
+	delete history;
+}
+
+/** Create the XML for everything that save_state() writes.
+ *  Caller must hold save_state_lock.
+ *  @return zero on success, 1 if the session cannot be saved right now, -1 on error
+ */
+int
+Session::capture_state (string snapshot_name, bool pending, bool switch_to_snapshot, bool template_only, SavedState& saved)
+{
+	DEBUG_TRACE (DEBUG::Locale, string_compose ("Session::save_state locale '%1'\n", setlocale (LC_NUMERIC, NULL)));
+
 	if (!_writable || (_state_of_the_state & CannotSave)) {
 		return 1;
 	}
@@ -786,7 +918,7 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 	}
 
 #ifndef NDEBUG
-	const int64_t save_start_time = g_get_monotonic_time();
+	saved.start_time = g_get_monotonic_time();
 #endif
 
 	/* tell sources we're saving first, in case they write out to a new file
@@ -807,11 +939,15 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 		mark_as_clean = false;
 	}
 
+	saved.state = new XMLTree;
+
 	if (template_only) {
 		mark_as_clean = false;
-		tree.set_root (&get_template());
+		saved.state->set_root (&get_template());
 	} else {
-		tree.set_root (&get_state());
+		/* dense automation is much smaller and faster to write as binary files */
+		AutomationList::EventFiles ef (automation_dir (), config.get_automation_event_files ());
+		saved.state->set_root (&get_state());
 	}
 
 	if (snapshot_name.empty()) {
@@ -822,7 +958,61 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 
 	assert (!snapshot_name.empty());
 
-	if (!pending) {
+	saved.snapshot_name = snapshot_name;
+	saved.pending = pending;
+
+	if (!pending && should_save_history ()) {
+		saved.history = new XMLTree;
+		saved.history->set_root (&_history.get_state (Config->get_saved_history_depth()));
+	}
+
+	/* the state is as it is now, whenever it gets written */
+
+	if (!pending && mark_as_clean) {
+		bool was_dirty = dirty();
+
+		_state_of_the_state = StateOfTheState (_state_of_the_state & ~Dirty);
+
+		if (was_dirty) {
+			DirtyChanged (); /* EMIT SIGNAL */
+		}
+	}
+
+	return 0;
+}
+
+/** Make sure that the data of the file at @a path is on disk */
+static bool
+sync_file (const string& path)
+{
+#ifndef PLATFORM_WINDOWS
+	int fd = ::open (path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	const int r = ::fsync (fd);
+	::close (fd);
+
+	return r == 0;
+#else
+	return true;
+#endif
+}
+
+/** Write state captured by capture_state(). This does not touch the
+ *  session's objects, so it may be called from any thread; the caller
+ *  passes @a saved to state_written() from the session's side afterwards.
+ *  @return zero on success
+ */
+int
+Session::write_state (SavedState& saved)
+{
+	std::string xml_path(_session_dir->root_path());
+	const string& snapshot_name (saved.snapshot_name);
+
+	if (!saved.pending) {
 
 		/* proper save: use statefile_suffix (.ardour in English) */
 
@@ -846,7 +1036,7 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 
 	cerr << "actually writing state to " << tmp_path << endl;
 
-	if (!tree.write (tmp_path)) {
+	if (!saved.state->write (tmp_path) || !sync_file (tmp_path)) {
 		error << string_compose (_("state could not be saved to %1"), tmp_path) << endmsg;
 		if (g_remove (tmp_path.c_str()) != 0) {
 			error << string_compose(_("Could not remove temporary session file at path \"%1\" (%2)"),
@@ -867,32 +1057,37 @@ Session::save_state (string snapshot_name, bool pending, bool switch_to_snapshot
 			}
 			return -1;
 		}
-	}
-
-	if (!pending) {
 
-		save_history (snapshot_name);
-
-		if (mark_as_clean) {
-			bool was_dirty = dirty();
-
-			_state_of_the_state = StateOfTheState (_state_of_the_state & ~Dirty);
-
-			if (was_dirty) {
-				DirtyChanged (); /* EMIT SIGNAL */
-			}
-		}
+		/* and that the rename is */
+		sync_file (_session_dir->root_path());
+	}
 
-		StateSaved (snapshot_name); /* EMIT SIGNAL */
+	if (!saved.pending && saved.history) {
+		write_history (*saved.history, snapshot_name);
 	}
 
+	saved.written = true;
+
 #ifndef NDEBUG
-	const int64_t elapsed_time_us = g_get_monotonic_time() - save_start_time;
+	const int64_t elapsed_time_us = g_get_monotonic_time() - saved.start_time;
 	cerr << "saved state in " << fixed << setprecision (1) << elapsed_time_us / 1000. << " ms\n";
 #endif
 	return 0;
 }
 
+/** Tell the session (and anyone listening) whether state
+ *  captured by capture_state() has been written.
+ */
+void
+Session::state_written (SavedState const & saved)
+{
+	if (!saved.written) {
+		set_dirty ();
+	} else if (!saved.pending) {
+		StateSaved (saved.snapshot_name); /* EMIT SIGNAL */
+	}
+}
+
 int
 Session::restore_state (string snapshot_name)
 {
@@ -1304,6 +1499,8 @@ Session::set_state (const XMLNode& node, int version)
 	XMLNode* child;
 	XMLProperty const * prop;
 	int ret = -1;
+	/* for automation lists whose events were saved to binary files */
+	AutomationList::EventFiles ef (automation_dir (), false);
 
 	_state_of_the_state = StateOfTheState (_state_of_the_state|CannotSave);
 
@@ -1382,6 +1579,12 @@ Session::set_state (const XMLNode& node, int version)
                 _speakers->set_state (*child, version);
         }
 
+	/* instantiate the plugins used by routes while sources and playlists are loaded */
+
+	if ((child = find_named_node (node, "Routes")) != 0) {
+		_plugin_pool->preinstantiate (*child, version);
+	}
+
 	if ((child = find_named_node (node, "Sources")) == 0) {
 		error << _("Session: XML state has no sources section") << endmsg;
 		goto out;
@@ -1456,6 +1659,9 @@ Session::set_state (const XMLNode& node, int version)
 		}
 	}
 
+	/* from here on plugins are created in this thread */
+	_plugin_pool->wait ();
+
 	if ((child = find_named_node (node, "Routes")) == 0) {
 		error << _("Session: XML state has no routes section") << endmsg;
 		goto out;
@@ -1463,6 +1669,9 @@ Session::set_state (const XMLNode& node, int version)
 		goto out;
 	}
 
+	/* drop instances that no route asked for */
+	_plugin_pool->clear ();
+
 	/* our diskstreams list is no longer needed as they are now all owned by their Route */
 	_diskstreams_2X.clear ();
 
@@ -1529,6 +1738,7 @@ Session::set_state (const XMLNode& node, int version)
 	return 0;
 
   out:
+	_plugin_pool->clear ();
 	delete state_tree;
 	state_tree = 0;
 	return ret;
@@ -2042,6 +2252,120 @@ Session::reset_write_sources (bool mark_write_complete, bool force)
 	}
 }
 
+namespace {
+
+/** Creates the sources described by a list of XML nodes using one thread
+ *  per core, without announcing them. Opening the files (searching for
+ *  them, reading their headers, checking for peak and analysis files) is
+ *  independent from source to source; everything that needs the rest of
+ *  the session is left to the caller. Messages are kept per source rather
+ *  than sent, for the caller to report in order from its own thread.
+ *
+ *  The only configuration read on the way is the session's search path,
+ *  which cannot change while the caller, the session's only user so far,
+ *  waits for run() to return.
+ */
+class ParallelSourceLoader
+{
+  public:
+	enum Result {
+		NotTried,
+		Created,
+		Missing,
+		Unusable,
+		Failed
+	};
+
+	ParallelSourceLoader (Session& s, XMLNodeList const & nodes)
+		: _session (s)
+		, _nodes (nodes)
+		, _next (0)
+		, results (nodes.size(), NotTried)
+		, sources (nodes.size())
+		, messages (nodes.size())
+	{}
+
+	void run ();
+
+  private:
+	Session&             _session;
+	XMLNodeList const &  _nodes;
+	size_t               _next;
+	Glib::Threads::Mutex _lock;
+
+	void thread_work ();
+
+  public:
+	std::vector<Result>                     results;
+	std::vector<boost::shared_ptr<Source> > sources;
+	std::vector<Transmitter::Capture::Messages> messages;
+};
+
+void
+ParallelSourceLoader::run ()
+{
+	std::vector<Glib::Threads::Thread*> threads;
+	const uint32_t n_threads = std::min ((size_t) hardware_concurrency(), _nodes.size());
+
+	for (uint32_t n = 1; n < n_threads; ++n) {
+		try {
+			threads.push_back (Glib::Threads::Thread::create (boost::bind (&ParallelSourceLoader::thread_work, this)));
+		} catch (Glib::Threads::ThreadError&) {
+			break;
+		}
+	}
+
+	/* this thread works too */
+	thread_work ();
+
+	for (std::vector<Glib::Threads::Thread*>::iterator t = threads.begin(); t != threads.end(); ++t) {
+		(*t)->join ();
+	}
+}
+
+void
+ParallelSourceLoader::thread_work ()
+{
+	while (true) {
+		size_t n;
+
+		{
+			Glib::Threads::Mutex::Lock lm (_lock);
+			if (_next == _nodes.size()) {
+				return;
+			}
+			n = _next++;
+		}
+
+		XMLNode const & node (*_nodes[n]);
+
+		/* nested sources need the session's playlists, create those in order */
+		if (node.name() != "Source" || node.property ("playlist")) {
+			continue;
+		}
+
+		Transmitter::Capture capture;
+
+		try {
+			/* note: do peak building in another thread when loading session state */
+			if ((sources[n] = SourceFactory::create (_session, node, true, false)) != 0) {
+				results[n] = Created;
+			} else {
+				results[n] = Failed;
+			}
+		} catch (MissingSource&) {
+			/* the user may have to be asked about it, which can only be done in order */
+			results[n] = Missing;
+		} catch (failed_constructor&) {
+			results[n] = Unusable;
+		}
+
+		messages[n] = capture.messages ();
+	}
+}
+
+} // anonymous namespace
+
 int
 Session::load_sources (const XMLNode& node)
 {
@@ -2056,7 +2380,32 @@ Session::load_sources (const XMLNode& node)
 
 	set_dirty();
 
-	for (niter = nlist.begin(); niter != nlist.end(); ++niter) {
+	ParallelSourceLoader loader (*this, nlist);
+	loader.run ();
+
+	size_t n = 0;
+
+	for (niter = nlist.begin(); niter != nlist.end(); ++niter, ++n) {
+
+		/* a missing source is tried again below, which repeats its messages */
+		if (loader.results[n] != ParallelSourceLoader::Missing) {
+			Transmitter::Capture::send (loader.messages[n]);
+		}
+
+		switch (loader.results[n]) {
+		case ParallelSourceLoader::Created:
+			SourceFactory::SourceCreated (loader.sources[n]);
+			continue;
+		case ParallelSourceLoader::Unusable:
+			error << string_compose (_("Found a sound file that cannot be used by %1. Talk to the programmers."), PROGRAM_NAME) << endmsg;
+			/* fallthru */
+		case ParallelSourceLoader::Failed:
+			error << _("Session: cannot create Source from XML description.") << endmsg;
+			continue;
+		default:
+			break;
+		}
+
           retry:
 		try {
 			if ((source = XMLSourceFactory (**niter)) == 0) {
@@ -2425,7 +2774,7 @@ Session::get_best_session_directory_for_new_audio ()
 string
 Session::automation_dir () const
 {
-	return Glib::build_filename (_path, automation_dir_name);
+	return _session_dir->automation_path ();
 }
 
 string
@@ -2858,6 +3207,64 @@ Session::find_all_sources_across_snapshots (set<string>& result, bool exclude_th
 	return 0;
 }
 
+static void
+find_event_files (XMLNode const & node, set<string>& result)
+{
+	if (node.name() == X_("events")) {
+		XMLProperty const * prop = node.property (X_("file"));
+		if (prop) {
+			result.insert (prop->value());
+		}
+		return;
+	}
+
+	XMLNodeList const & children (node.children());
+
+	for (XMLNodeConstIterator i = children.begin(); i != children.end(); ++i) {
+		find_event_files (**i, result);
+	}
+}
+
+/** Remove the binary automation event files which are not used by any
+ *  of the session's state files, pending state or state file backups.
+ */
+void
+Session::cleanup_automation_event_files ()
+{
+	vector<string> state_files;
+	const string root (_session_dir->root_path());
+
+	find_files_matching_pattern (state_files, root, string ("*") + statefile_suffix);
+	find_files_matching_pattern (state_files, root, string ("*") + pending_suffix);
+	find_files_matching_pattern (state_files, root, string ("*") + statefile_suffix + backup_suffix);
+
+	set<string> used;
+
+	for (vector<string>::const_iterator i = state_files.begin(); i != state_files.end(); ++i) {
+		XMLTree tree;
+
+		if (!tree.read (*i)) {
+			/* better keep everything than remove what it uses */
+			error << string_compose (_("Cannot read %1, unused automation data not removed"), *i) << endmsg;
+			return;
+		}
+
+		find_event_files (*tree.root(), used);
+	}
+
+	vector<string> event_files;
+	find_files_matching_pattern (event_files, automation_dir (), X_("*.events"));
+
+	for (vector<string>::const_iterator i = event_files.begin(); i != event_files.end(); ++i) {
+		if (used.find (Glib::path_get_basename (*i)) != used.end()) {
+			continue;
+		}
+		if (g_unlink (i->c_str()) != 0) {
+			error << string_compose (_("cannot remove unused automation data %1 (%2)"), *i, strerror (errno)) << endmsg;
+		}
+	}
+}
+
 struct RegionCounter {
     typedef std::map<PBD::ID,boost::shared_ptr<AudioSource> > AudioSourceList;
     AudioSourceList::iterator iter;
@@ -3256,6 +3663,12 @@ Session::cleanup_sources (CleanupReport& rep)
 	*/
 
 	save_state ("");
+
+	/* with that saved, automation data that was only used by earlier
+	   versions of this snapshot can go.
+	*/
+
+	cleanup_automation_event_files ();
 	ret = 0;
 
   out:
@@ -3510,20 +3923,38 @@ Session::instant_xml (const string& node_name)
 	return Stateful::instant_xml (node_name, _path);
 }
 
-int
-Session::save_history (string snapshot_name)
+bool
+Session::should_save_history () const
 {
-	XMLTree tree;
-
 	if (!_writable) {
-	        return 0;
+	        return false;
 	}
 
 	if (!Config->get_save_history() || Config->get_saved_history_depth() < 0 ||
 	    (_history.undo_depth() == 0 && _history.redo_depth() == 0)) {
+		return false;
+	}
+
+	return true;
+}
+
+int
+Session::save_history (string snapshot_name)
+{
+	XMLTree tree;
+
+	if (!should_save_history ()) {
 		return 0;
 	}
 
+	tree.set_root (&_history.get_state (Config->get_saved_history_depth()));
+
+	return write_history (tree, snapshot_name);
+}
+
+int
+Session::write_history (XMLTree& tree, string snapshot_name)
+{
 	if (snapshot_name.empty()) {
 		snapshot_name = _current_snapshot_name;
 	}
@@ -3540,8 +3971,6 @@ Session::save_history (string snapshot_name)
 		}
 	}
 
-	tree.set_root (&_history.get_state (Config->get_saved_history_depth()));
-
 	if (!tree.write (xml_path))
 	{
 		error << string_compose (_("history could not be saved to %1"), xml_path) << endmsg;
@@ -3561,6 +3990,16 @@ Session::save_history (string snapshot_name)
 	return 0;
 }
 
+/** MIDI models are loaded on demand; history commands need one to operate on */
+static void
+ensure_model (boost::shared_ptr<MidiSource> midi_source)
+{
+	if (!midi_source->model()) {
+		Source::Lock lm (midi_source->mutex());
+		midi_source->load_model (lm);
+	}
+}
+
 int
 Session::restore_history (string snapshot_name)
 {
@@ -3591,77 +4030,88 @@ Session::restore_history (string snapshot_name)
 	_history.clear();
 
 	for (XMLNodeConstIterator it  = tree.root()->children().begin(); it != tree.root()->children().end(); it++) {
+		_history.add (undo_transaction_from_state (**it));
+	}
 
-		XMLNode *t = *it;
-		UndoTransaction* ut = new UndoTransaction ();
-		struct timeval tv;
-
-		ut->set_name(t->property("name")->value());
-		stringstream ss(t->property("tv-sec")->value());
-		ss >> tv.tv_sec;
-		ss.str(t->property("tv-usec")->value());
-		ss >> tv.tv_usec;
-		ut->set_timestamp(tv);
-
-		for (XMLNodeConstIterator child_it  = t->children().begin();
-				child_it != t->children().end(); child_it++)
-		{
-			XMLNode *n = *child_it;
-			Command *c;
+	return 0;
+}
 
-			if (n->name() == "MementoCommand" ||
-					n->name() == "MementoUndoCommand" ||
-					n->name() == "MementoRedoCommand") {
+/** Create an undo transaction from state written by UndoTransaction::get_state().
+ *  Commands whose objects no longer exist are left out.
+ */
+UndoTransaction*
+Session::undo_transaction_from_state (XMLNode const & node)
+{
+	XMLNode const * t = &node;
+	UndoTransaction* ut = new UndoTransaction ();
+	struct timeval tv;
+
+	ut->set_name(t->property("name")->value());
+	stringstream ss(t->property("tv-sec")->value());
+	ss >> tv.tv_sec;
+	ss.str(t->property("tv-usec")->value());
+	ss >> tv.tv_usec;
+	ut->set_timestamp(tv);
+
+	for (XMLNodeConstIterator child_it  = t->children().begin();
+			child_it != t->children().end(); child_it++)
+	{
+		XMLNode *n = *child_it;
+		Command *c;
 
-				if ((c = memento_command_factory(n))) {
-					ut->add_command(c);
-				}
+		if (n->name() == "MementoCommand" ||
+				n->name() == "MementoUndoCommand" ||
+				n->name() == "MementoRedoCommand") {
 
-			} else if (n->name() == "NoteDiffCommand") {
-				PBD::ID id (n->property("midi-source")->value());
-				boost::shared_ptr<MidiSource> midi_source =
-					boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-				if (midi_source) {
-					ut->add_command (new MidiModel::NoteDiffCommand(midi_source->model(), *n));
-				} else {
-					error << _("Failed to downcast MidiSource for NoteDiffCommand") << endmsg;
-				}
+			if ((c = memento_command_factory(n))) {
+				ut->add_command(c);
+			}
 
-			} else if (n->name() == "SysExDiffCommand") {
+		} else if (n->name() == "NoteDiffCommand") {
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ensure_model (midi_source);
+				ut->add_command (new MidiModel::NoteDiffCommand(midi_source->model(), *n));
+			} else {
+				error << _("Failed to downcast MidiSource for NoteDiffCommand") << endmsg;
+			}
 
-				PBD::ID id (n->property("midi-source")->value());
-				boost::shared_ptr<MidiSource> midi_source =
-					boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-				if (midi_source) {
-					ut->add_command (new MidiModel::SysExDiffCommand (midi_source->model(), *n));
-				} else {
-					error << _("Failed to downcast MidiSource for SysExDiffCommand") << endmsg;
-				}
+		} else if (n->name() == "SysExDiffCommand") {
 
-			} else if (n->name() == "PatchChangeDiffCommand") {
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ensure_model (midi_source);
+				ut->add_command (new MidiModel::SysExDiffCommand (midi_source->model(), *n));
+			} else {
+				error << _("Failed to downcast MidiSource for SysExDiffCommand") << endmsg;
+			}
 
-				PBD::ID id (n->property("midi-source")->value());
-				boost::shared_ptr<MidiSource> midi_source =
-					boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
-				if (midi_source) {
-					ut->add_command (new MidiModel::PatchChangeDiffCommand (midi_source->model(), *n));
-				} else {
-					error << _("Failed to downcast MidiSource for PatchChangeDiffCommand") << endmsg;
-				}
+		} else if (n->name() == "PatchChangeDiffCommand") {
 
-			} else if (n->name() == "StatefulDiffCommand") {
-				if ((c = stateful_diff_command_factory (n))) {
-					ut->add_command (c);
-				}
+			PBD::ID id (n->property("midi-source")->value());
+			boost::shared_ptr<MidiSource> midi_source =
+				boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
+			if (midi_source) {
+				ensure_model (midi_source);
+				ut->add_command (new MidiModel::PatchChangeDiffCommand (midi_source->model(), *n));
 			} else {
-				error << string_compose(_("Couldn't figure out how to make a Command out of a %1 XMLNode."), n->name()) << endmsg;
+				error << _("Failed to downcast MidiSource for PatchChangeDiffCommand") << endmsg;
 			}
-		}
 
-		_history.add (ut);
+		} else if (n->name() == "StatefulDiffCommand") {
+			if ((c = stateful_diff_command_factory (n))) {
+				ut->add_command (c);
+			}
+		} else {
+			error << string_compose(_("Couldn't figure out how to make a Command out of a %1 XMLNode."), n->name()) << endmsg;
+		}
 	}
 
-	return 0;
+	return ut;
 }
 
 void
@@ -3831,6 +4281,8 @@ Session::config_changed (std::string p, bool ours)
 		setup_fpu ();
 	} else if (p == "history-depth") {
 		set_history_depth (Config->get_history_depth());
+	} else if (p == "history-memory-budget") {
+		set_history_memory_budget (Config->get_history_memory_budget());
 	} else if (p == "remote-model") {
 		/* XXX DO SOMETHING HERE TO TELL THE GUI THAT WE NEED
 		   TO SET REMOTE ID'S
@@ -3876,6 +4328,27 @@ Session::set_history_depth (uint32_t d)
 	_history.set_depth (d);
 }
 
+void
+Session::set_history_memory_budget (uint32_t megabytes)
+{
+	/* old transactions are written to a directory rather than being forgotten */
+	_history.set_spill_directory (boost::bind (&Session::history_spill_dir, this), boost::bind (&Session::undo_transaction_from_state, this, _1));
+	_history.set_memory_budget ((size_t) megabytes * 1048576);
+}
+
+/** @return the directory that undo history is spilled to, creating it
+ *  the first time it is needed.
+ */
+std::string
+Session::history_spill_dir ()
+{
+	if (_history_spill_dir.empty()) {
+		_history_spill_dir = PBD::tmp_writable_directory (PACKAGE, "undo-");
+	}
+
+	return _history_spill_dir;
+}
+
 int
 Session::load_diskstreams_2X (XMLNode const & node, int)
 {
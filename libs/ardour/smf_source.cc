@@ -65,6 +65,7 @@ SMFSource::SMFSource (Session& s, const string& path, Source::Flag flags)
 	, _last_ev_time_frames(0)
 	, _smf_last_read_end (0)
 	, _smf_last_read_time (0)
+	, _length_pending (false)
 {
 	/* note that origin remains empty */
 
@@ -101,6 +102,7 @@ SMFSource::SMFSource (Session& s, const string& path)
 	, _last_ev_time_frames(0)
 	, _smf_last_read_end (0)
 	, _smf_last_read_time (0)
+	, _length_pending (false)
 {
 	/* note that origin remains empty */
 
@@ -116,7 +118,7 @@ SMFSource::SMFSource (Session& s, const string& path)
 		return;
 	}
 
-	if (open (_path)) {
+	if (open_for_read ()) {
 		throw failed_constructor ();
 	}
 
@@ -133,6 +135,7 @@ SMFSource::SMFSource (Session& s, const XMLNode& node, bool must_exist)
 	, _last_ev_time_frames(0)
 	, _smf_last_read_end (0)
 	, _smf_last_read_time (0)
+	, _length_pending (false)
 {
 	if (set_state(node, Stateful::loading_state_version)) {
 		throw failed_constructor ();
@@ -178,7 +181,7 @@ SMFSource::SMFSource (Session& s, const XMLNode& node, bool must_exist)
 		return;
 	}
 
-	if (open (_path)) {
+	if (open_for_read ()) {
 		throw failed_constructor ();
 	}
 
@@ -187,11 +190,143 @@ SMFSource::SMFSource (Session& s, const XMLNode& node, bool must_exist)
 
 SMFSource::~SMFSource ()
 {
+	_mapped.close ();
+
 	if (removable()) {
 		::g_unlink (_path.c_str());
 	}
 }
 
+/** Open an existing file for reading.
+ *
+ * The file is memory-mapped rather than parsed by libsmf, so opening is
+ * cheap and no per-event memory is used. Playback reads events straight
+ * from the mapping (see read_mapped()), and a MidiModel is only built when
+ * someone asks for it through load_model().
+ */
+int
+SMFSource::open_for_read ()
+{
+	if (_mapped.open (_path)) {
+		/* not something the mapped reader understands, let libsmf try */
+		if (open (_path)) {
+			return -1;
+		}
+
+		/* libsmf holds all events in memory already, so finding the
+		   length (which would otherwise be set by load_model()) is cheap.
+		*/
+		uint64_t           duration = 0;
+		uint32_t           delta_t;
+		uint32_t           size = 0;
+		uint8_t*           buf = 0;
+		Evoral::event_id_t ignored;
+		int                ret;
+
+		for (unsigned i = 1; i <= num_tracks(); ++i) {
+			if (Evoral::SMF::seek_to_track (i)) continue;
+			uint64_t time = 0;
+			while ((ret = read_event (&delta_t, &size, &buf, &ignored)) >= 0) {
+				time += delta_t;
+				if (ret > 0) {
+					duration = max (duration, time);
+				}
+			}
+		}
+
+		free (buf);
+		Evoral::SMF::seek_to_track (1);
+
+		_length_beats = Evoral::Beats::ticks_at_rate (duration, ppqn ());
+		return 0;
+	}
+
+	_mapped_cursor = Evoral::MappedSMF::Cursor ();
+	_smf_last_read_end = 0;
+
+	/* finding the length means decoding every track, leave that until
+	   someone asks for it (see ensure_length()).
+	*/
+	_length_pending = true;
+
+	return 0;
+}
+
+/** Find the length of a file that was opened through the mapped reader,
+ * if that has not been done yet.
+ */
+void
+SMFSource::ensure_length () const
+{
+	if (!_length_pending) {
+		return;
+	}
+
+	_length_pending = false;
+
+	if (_mapped.is_open ()) {
+		_length_beats = max (_length_beats, Evoral::Beats::ticks_at_rate (_mapped.duration_ticks (), _mapped.ppqn ()));
+	}
+}
+
+bool
+SMFSource::empty () const
+{
+	ensure_length ();
+	return MidiSource::empty ();
+}
+
+framecnt_t
+SMFSource::length (framepos_t pos) const
+{
+	ensure_length ();
+	return MidiSource::length (pos);
+}
+
+/** Make sure that the file is loaded through libsmf, which is needed to
+ * write to it. Any mapping of the file is dropped, since it would not
+ * survive the file being rewritten.
+ */
+int
+SMFSource::ensure_smf_loaded ()
+{
+	if (!_mapped.is_open ()) {
+		return 0;
+	}
+
+	/* the length can not be found once the mapping is gone */
+	ensure_length ();
+
+	_mapped.close ();
+	_mapped_cursor = Evoral::MappedSMF::Cursor ();
+	_smf_last_read_end = 0;
+
+	return open (_path);
+}
+
+uint16_t
+SMFSource::num_tracks () const
+{
+	return _mapped.is_open () ? _mapped.num_tracks () : Evoral::SMF::num_tracks ();
+}
+
+uint16_t
+SMFSource::ppqn () const
+{
+	return _mapped.is_open () ? _mapped.ppqn () : Evoral::SMF::ppqn ();
+}
+
+bool
+SMFSource::is_empty () const
+{
+	if (!_mapped.is_open ()) {
+		return Evoral::SMF::is_empty ();
+	}
+
+	ensure_length ();
+	return _length_beats == Evoral::Beats ();
+}
+
 int
 SMFSource::open_for_write ()
 {
@@ -226,6 +361,10 @@ SMFSource::read_unlocked (const Lock&                    lock,
 		return duration;
 	}
 
+	if (_mapped.is_open ()) {
+		return read_mapped (destination, source_start, start, duration, tracker, filter);
+	}
+
 	DEBUG_TRACE (DEBUG::MidiSourceIO, string_compose ("SMF read_unlocked: start %1 duration %2\n", start, duration));
 
 	// Output parameters for read_event (which will allocate scratch in buffer as needed)
@@ -308,6 +447,86 @@ SMFSource::read_unlocked (const Lock&                    lock,
 	return duration;
 }
 
+/** Read events straight from the mapped file; all stamps in audio frames.
+ *
+ * Contiguous reads continue from where the previous one stopped, anything
+ * else seeks using the reader's index instead of decoding the track from
+ * the start.
+ */
+framecnt_t
+SMFSource::read_mapped (Evoral::EventSink<framepos_t>& destination,
+                        framepos_t const               source_start,
+                        framepos_t                     start,
+                        framecnt_t                     duration,
+                        MidiStateTracker*              tracker,
+                        MidiChannelFilter*             filter) const
+{
+	Evoral::MappedSMF::Cursor& cursor (_mapped_cursor);
+	BeatsFramesConverter       converter (_session.tempo_map(), source_start);
+
+	DEBUG_TRACE (DEBUG::MidiSourceIO, string_compose ("SMF read_mapped: start %1 duration %2\n", start, duration));
+
+	if (_smf_last_read_end == 0 || start != _smf_last_read_end) {
+		const uint64_t start_ticks = converter.from (start).to_ticks (_mapped.ppqn ());
+		DEBUG_TRACE (DEBUG::MidiSourceIO, string_compose ("SMF read_mapped: seek to %1 (%2 ticks)\n", start, start_ticks));
+		if (_mapped.seek_to_track (cursor, 1) || _mapped.seek_to_time (cursor, start_ticks)) {
+			/* no events after start */
+			_smf_last_read_end = start + duration;
+			return duration;
+		}
+	}
+
+	_smf_last_read_end = start + duration;
+
+	uint32_t             ev_delta_t;
+	uint32_t             ev_size;
+	const uint8_t*       ev_buffer;
+	Evoral::event_id_t   ignored;
+	std::vector<uint8_t> filtered;
+
+	while (true) {
+		/* remember where we are, the next event might be beyond this read */
+		cursor.mark ();
+
+		const int ret = _mapped.read_event (cursor, &ev_delta_t, &ev_size, &ev_buffer, &ignored);
+
+		if (ret < 0) { // EOF
+			break;
+		}
+
+		if (ret == 0) { // meta-event (skipped, just accumulate time)
+			continue;
+		}
+
+		/* Note that we add on the source start time (in session frames) here so that ev_frame_time
+		   is in session frames.
+		*/
+		const framepos_t ev_frame_time = converter.to (Evoral::Beats::ticks_at_rate (cursor.time_ticks(), _mapped.ppqn())) + source_start;
+
+		if (ev_frame_time >= start + duration) {
+			cursor.reset ();
+			break;
+		}
+
+		if (filter) {
+			/* the filter may modify the event */
+			filtered.assign (ev_buffer, ev_buffer + ev_size);
+			if (filter->filter (&filtered[0], ev_size)) {
+				continue;
+			}
+			ev_buffer = &filtered[0];
+		}
+
+		destination.write (ev_frame_time, midi_parameter_type (ev_buffer[0]), ev_size, ev_buffer);
+
+		if (tracker) {
+			tracker->track (ev_buffer);
+		}
+	}
+
+	return duration;
+}
+
 framecnt_t
 SMFSource::write_unlocked (const Lock&                 lock,
                            MidiRingBuffer<framepos_t>& source,
@@ -528,6 +747,11 @@ SMFSource::mark_streaming_midi_write_started (const Lock& lock, NoteMode mode)
 		return;
 	}
 
+	if (ensure_smf_loaded ()) {
+		error << string_compose (_("cannot load MIDI file %1 for write"), _path) << endmsg;
+		return;
+	}
+
 	MidiSource::mark_streaming_midi_write_started (lock, mode);
 	Evoral::SMF::begin_write ();
 	_last_ev_time_beats  = Evoral::Beats();
@@ -565,7 +789,7 @@ bool
 SMFSource::valid_midi_file (const string& file)
 {
 	if (safe_midi_file_extension (file) ) {
-		return (SMF::test (file) );
+		return (Evoral::MappedSMF::test (file) || SMF::test (file));
 	}
 	return false;
 }
@@ -615,7 +839,9 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 		return;
 	}
 
-	if (!_model) {
+	const bool new_model = !_model;
+
+	if (new_model) {
 		_model = boost::shared_ptr<MidiModel> (new MidiModel (shared_from_this ()));
 	} else {
 		_model->clear();
@@ -628,7 +854,8 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 	}
 
 	_model->start_write();
-	Evoral::SMF::seek_to_start();
+
+	Evoral::MappedSMF::Cursor cursor;
 
 	uint64_t time = 0; /* in SMF ticks */
 	Evoral::Event<Evoral::Beats> ev;
@@ -646,12 +873,12 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 	std::list< std::pair< Evoral::Event<Evoral::Beats>*, gint > > eventlist;
 
 	for (unsigned i = 1; i <= num_tracks(); ++i) {
-		if (seek_to_track(i)) continue;
+		if (seek_track (cursor, i)) continue;
 
 		time = 0;
 		have_event_id = false;
 
-		while ((ret = read_event (&delta_t, &size, &buf, &event_id)) >= 0) {
+		while ((ret = read_track_event (cursor, &delta_t, &size, &buf, &event_id)) >= 0) {
 
 			time += delta_t;
 
@@ -702,6 +929,9 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 		}
 	}
 
+	/* every event has been seen, so the length is known now */
+	_length_pending = false;
+
 	eventlist.sort(compare_eventlist);
 
 	std::list< std::pair< Evoral::Event<Evoral::Beats>*, gint > >::iterator it;
@@ -719,6 +949,47 @@ SMFSource::load_model (const Glib::Threads::Mutex::Lock& lock, bool force_reload
 	invalidate(lock);
 
 	free(buf);
+
+	if (new_model) {
+		/* models are built on demand, regions may be waiting for this one */
+		ModelChanged (); /* EMIT SIGNAL */
+	}
+}
+
+/** Position @a cursor at the start of @a track, using whichever reader holds the file */
+int
+SMFSource::seek_track (Evoral::MappedSMF::Cursor& cursor, int track)
+{
+	if (_mapped.is_open ()) {
+		return _mapped.seek_to_track (cursor, track);
+	}
+
+	return Evoral::SMF::seek_to_track (track);
+}
+
+/** Read the next event of the track set up by seek_track().
+ *  Arguments and return value are as for Evoral::SMF::read_event().
+ */
+int
+SMFSource::read_track_event (Evoral::MappedSMF::Cursor& cursor, uint32_t* delta_t, uint32_t* size, uint8_t** buf, Evoral::event_id_t* note_id) const
+{
+	if (!_mapped.is_open ()) {
+		return Evoral::SMF::read_event (delta_t, size, buf, note_id);
+	}
+
+	const uint8_t* ev_buf;
+	uint32_t       ev_size;
+	const int      ret = _mapped.read_event (cursor, delta_t, &ev_size, &ev_buf, note_id);
+
+	if (ret > 0) {
+		if (*size < ev_size) {
+			*buf = (uint8_t*) realloc (*buf, ev_size);
+		}
+		memcpy (*buf, ev_buf, ev_size);
+		*size = ev_size;
+	}
+
+	return ret;
 }
 
 void
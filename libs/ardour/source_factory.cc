@@ -147,7 +147,7 @@ SourceFactory::createSilent (Session& s, const XMLNode& node, framecnt_t nframes
 }
 
 boost::shared_ptr<Source>
-SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
+SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks, bool announce)
 {
 	DataType type = DataType::AUDIO;
 	XMLProperty const * prop = node.property("type");
@@ -171,7 +171,9 @@ SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
 
 				ap->check_for_analysis_data_on_disk ();
 
-				SourceCreated (ap);
+				if (announce) {
+					SourceCreated (ap);
+				}
 				return ap;
 
 			} catch (failed_constructor&) {
@@ -191,7 +193,9 @@ SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
 					return boost::shared_ptr<Source>();
 				}
 				ret->check_for_analysis_data_on_disk ();
-				SourceCreated (ret);
+				if (announce) {
+					SourceCreated (ret);
+				}
 				return ret;
 			}
 
@@ -212,7 +216,9 @@ SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
 				}
 
 				ret->check_for_analysis_data_on_disk ();
-				SourceCreated (ret);
+				if (announce) {
+					SourceCreated (ret);
+				}
 				return ret;
 #else
 				throw; // rethrow
@@ -220,14 +226,15 @@ SourceFactory::create (Session& s, const XMLNode& node, bool defer_peaks)
 			}
 		}
 	} else if (type == DataType::MIDI) {
+		/* the model is only loaded when someone needs it, playback reads the file directly */
 		boost::shared_ptr<SMFSource> src (new SMFSource (s, node));
-		Source::Lock lock(src->mutex());
-		src->load_model (lock, true);
 #ifdef BOOST_SP_ENABLE_DEBUG_HOOKS
 		// boost_debug_shared_ptr_mark_interesting (src, "Source");
 #endif
 		src->check_for_analysis_data_on_disk ();
-		SourceCreated (src);
+		if (announce) {
+			SourceCreated (src);
+		}
 		return src;
 	}
 
@@ -289,9 +296,8 @@ SourceFactory::createExternal (DataType type, Session& s, const string& path,
 
 	} else if (type == DataType::MIDI) {
 
+		/* the model is only loaded when someone needs it, playback reads the file directly */
 		boost::shared_ptr<SMFSource> src (new SMFSource (s, path));
-		Source::Lock lock(src->mutex());
-		src->load_model (lock, true);
 #ifdef BOOST_SP_ENABLE_DEBUG_HOOKS
 		// boost_debug_shared_ptr_mark_interesting (src, "Source");
 #endif
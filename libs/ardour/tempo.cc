@@ -275,7 +275,15 @@ struct MetricSectionSorter {
     }
 };
 
+struct bbtcmp {
+    bool operator() (const BBT_Time& a, const BBT_Time& b) {
+	    return a < b;
+    }
+};
+
 TempoMap::TempoMap (framecnt_t fr)
+	: _index_frames_ordered (false)
+	, _index_bbt_ordered (false)
 {
 	_frame_rate = fr;
 	BBT_Time start;
@@ -295,6 +303,8 @@ TempoMap::TempoMap (framecnt_t fr)
 
 	metrics.push_back (t);
 	metrics.push_back (m);
+
+	rebuild_index ();
 }
 
 TempoMap::~TempoMap ()
@@ -310,7 +320,7 @@ TempoMap::remove_tempo (const TempoSection& tempo, bool complete_operation)
 		Glib::Threads::RWLock::WriterLock lm (lock);
 		if ((removed = remove_tempo_locked (tempo))) {
 			if (complete_operation) {
-				recompute_map (true);
+				recompute_map_from (tempo.start(), true);
 			}
 		}
 	}
@@ -330,6 +340,7 @@ TempoMap::remove_tempo_locked (const TempoSection& tempo)
 			if (tempo.frame() == (*i)->frame()) {
 				if ((*i)->movable()) {
 					metrics.erase (i);
+					rebuild_index ();
 					return true;
 				}
 			}
@@ -348,7 +359,7 @@ TempoMap::remove_meter (const MeterSection& tempo, bool complete_operation)
 		Glib::Threads::RWLock::WriterLock lm (lock);
 		if ((removed = remove_meter_locked (tempo))) {
 			if (complete_operation) {
-				recompute_map (true);
+				recompute_map_from (tempo.start(), true);
 			}
 		}
 	}
@@ -368,6 +379,7 @@ TempoMap::remove_meter_locked (const MeterSection& tempo)
 			if (tempo.frame() == (*i)->frame()) {
 				if ((*i)->movable()) {
 					metrics.erase (i);
+					rebuild_index ();
 					return true;
 				}
 			}
@@ -486,6 +498,8 @@ TempoMap::do_insert (MetricSection* section)
 
 		metrics.insert (i, section);
 	}
+
+	rebuild_index ();
 }
 
 void
@@ -496,8 +510,10 @@ TempoMap::replace_tempo (const TempoSection& ts, const Tempo& tempo, const BBT_T
 		TempoSection& first (first_tempo());
 
 		if (ts.start() != first.start()) {
+			const BBT_Time old_start (ts.start());
 			remove_tempo_locked (ts);
-			add_tempo_locked (tempo, where, true);
+			add_tempo_locked (tempo, where, false);
+			recompute_map_from (min (old_start, where), false);
 		} else {
 			{
 				/* cannot move the first tempo section */
@@ -563,7 +579,7 @@ TempoMap::add_tempo_locked (const Tempo& tempo, BBT_Time where, bool recompute)
 	do_insert (ts);
 
 	if (recompute) {
-		recompute_map (false);
+		recompute_map_from (where, false);
 	}
 }
 
@@ -575,8 +591,10 @@ TempoMap::replace_meter (const MeterSection& ms, const Meter& meter, const BBT_T
 		MeterSection& first (first_meter());
 
 		if (ms.start() != first.start()) {
+			const BBT_Time old_start (ms.start());
 			remove_meter_locked (ms);
-			add_meter_locked (meter, where, true);
+			add_meter_locked (meter, where, false);
+			recompute_map_from (min (old_start, where), true);
 		} else {
 			/* cannot move the first meter section */
 			*static_cast<Meter*>(&first) = meter;
@@ -626,7 +644,7 @@ TempoMap::add_meter_locked (const Meter& meter, BBT_Time where, bool recompute)
 	do_insert (new MeterSection (where, meter.divisions_per_bar(), meter.note_divisor()));
 
 	if (recompute) {
-		recompute_map (true);
+		recompute_map_from (where, true);
 	}
 
 }
@@ -693,7 +711,7 @@ TempoMap::change_existing_tempo_at (framepos_t where, double beats_per_minute, d
 		Glib::Threads::RWLock::WriterLock lm (lock);
 		/* cannot move the first tempo section */
 		*((Tempo*)prev) = newtempo;
-		recompute_map (false);
+		recompute_map_from (prev->start(), false);
 	}
 
 	PropertyChanged (PropertyChange ());
@@ -859,51 +877,122 @@ TempoMap::recompute_map (bool reassign_tempo_bbt, framepos_t end)
 	current.ticks = 0;
 
 	if (reassign_tempo_bbt) {
+		reassign_tempo_bbt_from_bar_offsets ();
+	}
 
-		MeterSection* rmeter = meter;
+	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("start with meter = %1 tempo = %2\n", *((Meter*)meter), *((Tempo*)tempo)));
 
-		DEBUG_TRACE (DEBUG::TempoMath, "\tUpdating tempo marks BBT time from bar offset\n");
+	next_metric = metrics.begin();
+	++next_metric; // skip meter (or tempo)
+	++next_metric; // skip tempo (or meter)
 
-		for (Metrics::iterator i = metrics.begin(); i != metrics.end(); ++i) {
+	_map.clear ();
 
-			TempoSection* ts;
-			MeterSection* ms;
+	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("Add first bar at 1|1 @ %2\n", current.bars, current_frame));
+	_map.push_back (BBTPoint (*meter, *tempo,(framepos_t) llrint(current_frame), 1, 1));
 
-			if ((ts = dynamic_cast<TempoSection*>(*i)) != 0) {
+	if (end != 0) {
+		/* (zero is a silly call from Session::process() during startup) */
+		_extend_map (tempo, meter, next_metric, current, current_frame, end);
+	}
 
-				/* reassign the BBT time of this tempo section
-				 * based on its bar offset position.
-				 */
+	rebuild_index ();
+}
 
-				ts->update_bbt_time_from_bar_offset (*rmeter);
+void
+TempoMap::reassign_tempo_bbt_from_bar_offsets ()
+{
+	/* CALLER MUST HOLD WRITE LOCK */
 
-			} else if ((ms = dynamic_cast<MeterSection*>(*i)) != 0) {
-				rmeter = ms;
-			} else {
-				fatal << _("programming error: unhandled MetricSection type") << endmsg;
-				abort(); /*NOTREACHED*/
-			}
+	MeterSection* rmeter = &first_meter ();
+
+	DEBUG_TRACE (DEBUG::TempoMath, "\tUpdating tempo marks BBT time from bar offset\n");
+
+	for (Metrics::iterator i = metrics.begin(); i != metrics.end(); ++i) {
+
+		TempoSection* ts;
+		MeterSection* ms;
+
+		if ((ts = dynamic_cast<TempoSection*>(*i)) != 0) {
+
+			/* reassign the BBT time of this tempo section
+			 * based on its bar offset position.
+			 */
+
+			ts->update_bbt_time_from_bar_offset (*rmeter);
+
+		} else if ((ms = dynamic_cast<MeterSection*>(*i)) != 0) {
+			rmeter = ms;
+		} else {
+			fatal << _("programming error: unhandled MetricSection type") << endmsg;
+			abort(); /*NOTREACHED*/
 		}
 	}
+}
 
-	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("start with meter = %1 tempo = %2\n", *((Meter*)meter), *((Tempo*)tempo)));
+/** Recompute the map after a change to the metric section(s) at or after
+ * @p changed. The map up to the last bar before the change can not be
+ * affected, so it is kept and only the remainder is regenerated.
+ */
+void
+TempoMap::recompute_map_from (const BBT_Time& changed, bool reassign_tempo_bbt)
+{
+	/* CALLER MUST HOLD WRITE LOCK */
 
-	next_metric = metrics.begin();
-	++next_metric; // skip meter (or tempo)
-	++next_metric; // skip tempo (or meter)
+	/* a section on the first beat of a bar changes the metric of that bar's point */
+	const uint32_t restart_bar = (changed.beats == 1 && changed.ticks == 0) ? changed.bars - 1 : changed.bars;
 
-	_map.clear ();
+	if (_map.empty() || restart_bar < 1) {
+		recompute_map (reassign_tempo_bbt);
+		return;
+	}
 
-	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("Add first bar at 1|1 @ %2\n", current.bars, current_frame));
-	_map.push_back (BBTPoint (*meter, *tempo,(framepos_t) llrint(current_frame), 1, 1));
+	/* find the last bar point at or before the start of restart_bar */
 
-	if (end == 0) {
-		/* silly call from Session::process() during startup
-		 */
+	bbtcmp cmp;
+	BBTPointList::iterator p = lower_bound (_map.begin(), _map.end(), BBT_Time (restart_bar, 1, 0), cmp);
+
+	if (p == _map.end() || (*p).bar != restart_bar || (*p).beat != 1) {
+		/* the map does not reach that far, restart from its last bar */
+		do {
+			--p;
+		} while (p != _map.begin() && !(*p).is_bar());
+	}
+
+	if (p == _map.begin()) {
+		recompute_map (reassign_tempo_bbt);
 		return;
 	}
 
-	_extend_map (tempo, meter, next_metric, current, current_frame, end);
+	if (reassign_tempo_bbt) {
+		reassign_tempo_bbt_from_bar_offsets ();
+	}
+
+	const BBTPoint restart (*p);
+
+	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("recomputing tempo map from %1 (change at %2)\n", restart.bbt(), changed));
+
+	_map.erase (++p, _map.end());
+
+	/* the metric sections at the restart point are already in effect */
+
+	Metrics::iterator next_metric;
+
+	for (next_metric = metrics.begin(); next_metric != metrics.end(); ++next_metric) {
+		if ((*next_metric)->start() > restart.bbt()) {
+			break;
+		}
+	}
+
+	/* we cast away const here because this is the one place where we need
+	 * to actually modify the frame time of each metric section.
+	 */
+
+	_extend_map (const_cast<TempoSection*> (restart.tempo),
+		     const_cast<MeterSection*> (restart.meter),
+		     next_metric, restart.bbt(), restart.exact_frame, max_framepos);
+
+	rebuild_index ();
 }
 
 void
@@ -945,20 +1034,23 @@ TempoMap::extend_map (framepos_t end)
 
 	_extend_map (const_cast<TempoSection*> ((*i).tempo),
 		     const_cast<MeterSection*> ((*i).meter),
-		     next_metric, BBT_Time ((*i).bar, (*i).beat, 0), (*i).frame, end);
+		     next_metric, BBT_Time ((*i).bar, (*i).beat, 0), (*i).exact_frame, end);
+
+	/* extending the map may have positioned more metric sections */
+	rebuild_index ();
 }
 
 void
 TempoMap::_extend_map (TempoSection* tempo, MeterSection* meter,
 		       Metrics::iterator next_metric,
-		       BBT_Time current, framepos_t current_frame, framepos_t end)
+		       BBT_Time current, double current_frame_exact, framepos_t end)
 {
 	/* CALLER MUST HOLD WRITE LOCK */
 
 	TempoSection* ts;
 	MeterSection* ms;
 	double beat_frames;
-	double current_frame_exact;
+	framepos_t current_frame = llrint (current_frame_exact);
 	framepos_t bar_start_frame;
 
 	DEBUG_TRACE (DEBUG::TempoMath, string_compose ("Extend map to %1 from %2 = %3\n", end, current, current_frame));
@@ -970,7 +1062,6 @@ TempoMap::_extend_map (TempoSection* tempo, MeterSection* meter,
 	}
 
 	beat_frames = meter->frames_per_grid (*tempo,_frame_rate);
-	current_frame_exact = current_frame;
 
 	while (current_frame < end) {
 
@@ -1091,11 +1182,11 @@ TempoMap::_extend_map (TempoSection* tempo, MeterSection* meter,
 
 		if (current.beats == 1) {
 			DEBUG_TRACE (DEBUG::TempoMath, string_compose ("Add Bar at %1|1 @ %2\n", current.bars, current_frame));
-			_map.push_back (BBTPoint (*meter, *tempo, current_frame, current.bars, 1));
+			_map.push_back (BBTPoint (*meter, *tempo, current_frame_exact, current.bars, 1));
 			bar_start_frame = current_frame;
 		} else {
 			DEBUG_TRACE (DEBUG::TempoMath, string_compose ("Add Beat at %1|%2 @ %3\n", current.bars, current.beats, current_frame));
-			_map.push_back (BBTPoint (*meter, *tempo, current_frame, current.bars, current.beats));
+			_map.push_back (BBTPoint (*meter, *tempo, current_frame_exact, current.bars, current.beats));
 		}
 
 		if (next_metric == metrics.end()) {
@@ -1109,10 +1200,165 @@ TempoMap::_extend_map (TempoSection* tempo, MeterSection* meter,
 	}
 }
 
+struct IndexFrameCompare {
+	template<typename Entry> bool operator() (framepos_t frame, const Entry& e) const {
+		return frame < e.frame;
+	}
+};
+
+struct IndexBeatCompare {
+	template<typename Entry> bool operator() (double beats, const Entry& e) const {
+		return beats < e.beats;
+	}
+};
+
+struct IndexBBTCompare {
+	/* like metric_at(BBT_Time), this ignores ticks */
+	template<typename Entry> bool operator() (const BBT_Time& bbt, const Entry& e) const {
+		return bbt.bars < e.start.bars || (bbt.bars == e.start.bars && bbt.beats < e.start.beats);
+	}
+};
+
+void
+TempoMap::rebuild_index ()
+{
+	/* CALLER MUST HOLD WRITE LOCK */
+
+	_metric_index.clear ();
+	_tempo_index.clear ();
+	_index_frames_ordered = false;
+	_index_bbt_ordered = false;
+
+	const TempoSection* tempo = 0;
+	const MeterSection* meter = 0;
+
+	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end() && !(tempo && meter); ++i) {
+		if (!tempo) {
+			tempo = dynamic_cast<const TempoSection*> (*i);
+		}
+		if (!meter) {
+			meter = dynamic_cast<const MeterSection*> (*i);
+		}
+	}
+
+	if (!tempo || !meter) {
+		/* not a usable map (yet), lookups will use the metric list */
+		return;
+	}
+
+	_index_frames_ordered = true;
+	_index_bbt_ordered = true;
+
+	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+
+		const TempoSection* t;
+		const MeterSection* m;
+
+		if (!_metric_index.empty()) {
+			if ((*i)->frame() < _metric_index.back().frame) {
+				_index_frames_ordered = false;
+			}
+			if ((*i)->start() < _metric_index.back().start) {
+				_index_bbt_ordered = false;
+			}
+		}
+
+		if ((t = dynamic_cast<const TempoSection*> (*i)) != 0) {
+
+			TempoIndexEntry te;
+
+			te.frame = t->frame();
+			te.tempo = t;
+			te.frames_per_beat = t->frames_per_beat (_frame_rate);
+			te.beats = 0.0;
+
+			if (!_tempo_index.empty()) {
+				const TempoIndexEntry& prev (_tempo_index.back());
+				if (te.frame >= prev.frame) {
+					/* same arithmetic as walking through the section */
+					te.beats = prev.beats + Evoral::Beats::ticks_at_rate (te.frame - prev.frame, prev.frames_per_beat).to_double();
+				}
+			}
+
+			_tempo_index.push_back (te);
+			tempo = t;
+
+		} else if ((m = dynamic_cast<const MeterSection*> (*i)) != 0) {
+			meter = m;
+		}
+
+		MetricIndexEntry me;
+
+		me.frame = (*i)->frame();
+		me.start = (*i)->start();
+		me.tempo = tempo;
+		me.meter = meter;
+		me.iter  = i;
+
+		_metric_index.push_back (me);
+	}
+}
+
+/** @return the index entry of the last metric section at or before @p frame,
+ *  or 0 if there is none or the index can not be used.
+ */
+const TempoMap::MetricIndexEntry*
+TempoMap::metric_index_at (framepos_t frame) const
+{
+	/* CALLER MUST HOLD READ LOCK */
+
+	if (!_index_frames_ordered) {
+		return 0;
+	}
+
+	std::vector<MetricIndexEntry>::const_iterator i = upper_bound (_metric_index.begin(), _metric_index.end(), frame, IndexFrameCompare());
+
+	if (i == _metric_index.begin()) {
+		return 0;
+	}
+
+	return &*(--i);
+}
+
+/** @return the position in _tempo_index of the last tempo section at or
+ *  before @p frame, or _tempo_index.size() if there is none or the index
+ *  can not be used.
+ */
+size_t
+TempoMap::tempo_index_at (framepos_t frame) const
+{
+	/* CALLER MUST HOLD READ LOCK */
+
+	if (!_index_frames_ordered) {
+		return _tempo_index.size();
+	}
+
+	std::vector<TempoIndexEntry>::const_iterator i = upper_bound (_tempo_index.begin(), _tempo_index.end(), frame, IndexFrameCompare());
+
+	if (i == _tempo_index.begin()) {
+		return _tempo_index.size();
+	}
+
+	return (i - _tempo_index.begin()) - 1;
+}
+
 TempoMetric
 TempoMap::metric_at (framepos_t frame, Metrics::const_iterator* last) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
+
+	const MetricIndexEntry* e = metric_index_at (frame);
+
+	if (e) {
+		TempoMetric m (*e->meter, *e->tempo);
+		m.set_frame (e->frame);
+		m.set_start (e->start);
+		if (last) {
+			*last = e->iter;
+		}
+		return m;
+	}
+
 	TempoMetric m (first_meter(), first_tempo());
 
 	/* at this point, we are *guaranteed* to have m.meter and m.tempo pointing
@@ -1142,6 +1388,19 @@ TempoMetric
 TempoMap::metric_at (BBT_Time bbt) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
+
+	if (_index_bbt_ordered) {
+		std::vector<MetricIndexEntry>::const_iterator e = upper_bound (_metric_index.begin(), _metric_index.end(), bbt, IndexBBTCompare());
+
+		if (e != _metric_index.begin()) {
+			--e;
+			TempoMetric m (*e->meter, *e->tempo);
+			m.set_frame (e->frame);
+			m.set_start (e->start);
+			return m;
+		}
+	}
+
 	TempoMetric m (first_meter(), first_tempo());
 
 	/* at this point, we are *guaranteed* to have m.meter and m.tempo pointing
@@ -1578,7 +1837,8 @@ TempoMap::get_grid (TempoMap::BBTPointList::const_iterator& begin,
 	{
 		Glib::Threads::RWLock::WriterLock lm (lock);
 		if (_map.empty() || (_map.back().frame < upper)) {
-			recompute_map (false, upper);
+			/* only generate what is needed to cover the range */
+			extend_map (upper);
 		}
 	}
 
@@ -1590,6 +1850,13 @@ const TempoSection&
 TempoMap::tempo_section_at (framepos_t frame) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
+
+	const MetricIndexEntry* e = metric_index_at (frame);
+
+	if (e) {
+		return *e->tempo;
+	}
+
 	Metrics::const_iterator i;
 	TempoSection* prev = 0;
 
@@ -1625,6 +1892,13 @@ const MeterSection&
 TempoMap::meter_section_at (framepos_t frame) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
+
+	const MetricIndexEntry* e = metric_index_at (frame);
+
+	if (e) {
+		return *e->meter;
+	}
+
 	Metrics::const_iterator i;
 	MeterSection* prev = 0;
 
@@ -1729,6 +2003,8 @@ TempoMap::set_state (const XMLNode& node, int /*version*/)
 			metrics.sort (cmp);
 		}
 
+		rebuild_index ();
+
 		/* check for multiple tempo/meters at the same location, which
 		   ardour2 somehow allowed.
 		*/
@@ -1971,6 +2247,34 @@ framepos_t
 TempoMap::framepos_plus_beats (framepos_t pos, Evoral::Beats beats) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
+
+	/* pos could be -ve, in which case the initial tempo (at time 0) is
+	   considered to be in effect at pos.
+	*/
+	const size_t first = tempo_index_at (max (pos, (framepos_t) 0));
+
+	if (first < _tempo_index.size() && beats.to_double() >= 0) {
+
+		/* find the tempo section in which we end up, by the number of
+		   beats from the first tempo section.
+		*/
+
+		const TempoIndexEntry& start (_tempo_index[first]);
+		const double           target = start.beats + ((pos - start.frame) / (double) start.frames_per_beat) + beats.to_double();
+
+		std::vector<TempoIndexEntry>::const_iterator e = upper_bound (_tempo_index.begin() + first + 1, _tempo_index.end(), target, IndexBeatCompare());
+		--e;
+
+		DEBUG_TRACE (DEBUG::TempoMath, string_compose ("frame %1 plus %2 beats, from tempo @ %3 to tempo @ %4\n",
+		                                               pos, beats, start.frame, e->frame));
+
+		if (e == _tempo_index.begin() + first) {
+			return pos + beats.to_ticks (start.frames_per_beat);
+		}
+
+		return e->frame + Evoral::Beats (target - e->beats).to_ticks (e->frames_per_beat);
+	}
+
 	Metrics::const_iterator next_tempo;
 	const TempoSection* tempo = 0;
 
@@ -2318,6 +2622,37 @@ TempoMap::framewalk_to_beats (framepos_t pos, framecnt_t distance) const
 	const TempoSection* tempo = 0;
 	framepos_t effective_pos = max (pos, (framepos_t) 0);
 
+	/* distance is often max_framepos, in which case pos + distance
+	   overflows and we walk the metric list as ever.
+	*/
+	const size_t first = tempo_index_at (effective_pos);
+
+	if (first < _tempo_index.size() && distance >= 0 && pos <= max_framepos - distance) {
+
+		const framepos_t end  = pos + distance;
+		const size_t     last = max (first, tempo_index_at (max (end, effective_pos)));
+
+		DEBUG_TRACE (DEBUG::TempoMath, string_compose ("frame %1 walk by %2 frames, tempo index %3 to %4\n",
+		                                               pos, distance, first, last));
+
+		const TempoIndexEntry& s (_tempo_index[first]);
+
+		if (first == last) {
+			return Evoral::Beats::ticks_at_rate (distance, s.frames_per_beat);
+		}
+
+		/* the rest of the first section, all intermediate sections,
+		   and the part of the last section that we reach.
+		*/
+
+		const TempoIndexEntry& n (_tempo_index[first + 1]);
+		const TempoIndexEntry& e (_tempo_index[last]);
+
+		return Evoral::Beats::ticks_at_rate (n.frame - pos, s.frames_per_beat)
+			+ Evoral::Beats (e.beats - n.beats)
+			+ Evoral::Beats::ticks_at_rate (end - e.frame, e.frames_per_beat);
+	}
+
 	/* Find the relevant initial tempo metric  */
 
 	for (next_tempo = metrics.begin(); next_tempo != metrics.end(); ++next_tempo) {
@@ -2435,12 +2770,6 @@ TempoMap::bbt_before_or_at (framepos_t pos)
 	return i;
 }
 
-struct bbtcmp {
-    bool operator() (const BBT_Time& a, const BBT_Time& b) {
-	    return a < b;
-    }
-};
-
 TempoMap::BBTPointList::const_iterator
 TempoMap::bbt_before_or_at (const BBT_Time& bbt)
 {
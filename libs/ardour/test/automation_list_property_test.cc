@@ -162,3 +162,72 @@ AutomationListPropertyTest::undoTest ()
 	write_automation_list_xml (&sheila->get_state(), test_data_filename);
 	check_xml (&sheila->get_state(), test_data_file4, ignore_properties);
 }
+
+/** Check that events saved to a binary file are loaded back unchanged,
+ *  and that inline events still work.
+ */
+void
+AutomationListPropertyTest::eventFileTest ()
+{
+	std::string const directory = new_test_output_dir ("automation_event_files");
+
+	Evoral::Parameter const gain (GainAutomation);
+	AutomationList integral (gain);
+	AutomationList fractional (gain);
+
+	for (int i = 0; i < 1000; ++i) {
+		integral.fast_simple_add (i * 64, (i / 100) % 2 ? 0.5 : 1.0 + i / 1000.0);
+		fractional.fast_simple_add (i * 0.75, -i / 7.0);
+	}
+
+	AutomationList* lists[] = { &integral, &fractional };
+
+	for (size_t n = 0; n < 2; ++n) {
+		XMLNode* state;
+
+		{
+			AutomationList::EventFiles ef (directory, true);
+			state = &lists[n]->get_state ();
+		}
+
+		XMLNode* events = state->child ("events");
+		CPPUNIT_ASSERT (events);
+		CPPUNIT_ASSERT (events->property ("file"));
+		CPPUNIT_ASSERT (events->children().empty());
+
+		AutomationList::EventFiles reading (directory, false);
+
+		AutomationList loaded (*state, gain);
+		CPPUNIT_ASSERT_EQUAL (lists[n]->size(), loaded.size());
+		CPPUNIT_ASSERT (!(static_cast<Evoral::ControlList&> (loaded) != *lists[n]));
+
+		/* saving the same events again gives the same file */
+		{
+			AutomationList::EventFiles ef (directory, true);
+			XMLNode* again = &loaded.get_state ();
+			CPPUNIT_ASSERT_EQUAL (events->property ("file")->value(), again->child ("events")->property ("file")->value());
+			delete again;
+		}
+
+		/* a short file is an error, and loads no points */
+		std::string const path = Glib::build_filename (directory, events->property ("file")->value());
+		gchar* contents;
+		gsize length;
+		CPPUNIT_ASSERT (g_file_get_contents (path.c_str(), &contents, &length, 0));
+		CPPUNIT_ASSERT (g_file_set_contents (path.c_str(), contents, length - 1, 0));
+		g_free (contents);
+
+		CPPUNIT_ASSERT (loaded.set_state (*events, Stateful::loading_state_version) != 0);
+		CPPUNIT_ASSERT_EQUAL ((size_t) 0, loaded.size());
+
+		delete state;
+	}
+
+	/* without EventFiles, events stay inline */
+	XMLNode* state = &integral.get_state ();
+	CPPUNIT_ASSERT (state->child ("events")->property ("file") == 0);
+	CPPUNIT_ASSERT (!state->child ("events")->children().empty());
+	AutomationList loaded (*state, gain);
+	CPPUNIT_ASSERT_EQUAL (integral.size(), loaded.size());
+	delete state;
+}
@@ -135,3 +135,41 @@ FramewalkToBeatsTest::tripleTempoTest ()
 	double r = map.framewalk_to_beats (2 * 24e3, (2 * 24e3) + (4 * 12e3) + (4 * 18e3)).to_double();
 	CPPUNIT_ASSERT_EQUAL (10.0, r);
 }
+
+/* Walks across many tempo changes, which are found in the map's lookup tables */
+void
+FramewalkToBeatsTest::manyTempoTest ()
+{
+	int const sampling_rate = 48000;
+	int const bars = 1000;
+
+	TempoMap map (sampling_rate);
+	Meter meter (4, 4);
+	map.add_meter (meter, BBT_Time (1, 1, 0));
+
+	/* 120bpm (96e3 samples per bar) on odd bars, 240bpm (48e3) on even bars */
+	for (int b = 1; b <= bars; ++b) {
+		map.add_tempo (Tempo ((b % 2) ? 120 : 240), BBT_Time (b, 1, 0));
+	}
+
+	for (int b = 1; b < bars; b += 7) {
+
+		int const walk = 1 + (b % 13);
+
+		if (b + walk > bars) {
+			continue;
+		}
+
+		framepos_t const from = ((b - 1) / 2) * 144e3 + ((b - 1) % 2) * 96e3;
+		framepos_t const to = ((b + walk - 1) / 2) * 144e3 + ((b + walk - 1) % 2) * 96e3;
+
+		/* Walk whole bars from the start of bar b */
+		double r = map.framewalk_to_beats (from, to - from).to_double();
+		CPPUNIT_ASSERT_EQUAL (4.0 * walk, r);
+
+		/* Walk from half way through the first beat of bar b */
+		framepos_t const half_beat = (b % 2) ? 12e3 : 6e3;
+		r = map.framewalk_to_beats (from + half_beat, to - from - half_beat).to_double();
+		CPPUNIT_ASSERT_EQUAL (4.0 * walk - 0.5, r);
+	}
+}
@@ -0,0 +1,121 @@
+#include <vector>
+
+#include "ardour/midi_buffer.h"
+
+#include "midi_buffer_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (MidiBufferTest);
+
+using namespace std;
+using namespace ARDOUR;
+
+static void
+push_note_on (MidiBuffer& buf, MidiBuffer::TimeType time, uint8_t channel, uint8_t note)
+{
+	const uint8_t data[3] = { (uint8_t) (0x90 | channel), note, 0x40 };
+	CPPUNIT_ASSERT (buf.push_back (time, 3, data));
+}
+
+static void
+check_sorted (const MidiBuffer& buf, size_t expected_events)
+{
+	size_t n = 0;
+	MidiBuffer::TimeType last = 0;
+
+	for (MidiBuffer::const_iterator i = buf.begin(); i != buf.end(); ++i, ++n) {
+		CPPUNIT_ASSERT ((*i).time() >= last);
+		last = (*i).time();
+	}
+
+	CPPUNIT_ASSERT_EQUAL (expected_events, n);
+}
+
+void
+MidiBufferTest::mergeManyTest ()
+{
+	const size_t n_tracks = 64;
+	const size_t n_events = 16;
+
+	vector<MidiBuffer*> tracks;
+	for (size_t t = 0; t < n_tracks; ++t) {
+		MidiBuffer* b = new MidiBuffer (1024);
+		for (size_t e = 0; e < n_events; ++e) {
+			push_note_on (*b, e * 7 + t % 5, t % 16, e);
+		}
+		tracks.push_back (b);
+	}
+
+	MidiBuffer bus (n_tracks * n_events * 16);
+	CPPUNIT_ASSERT (bus.merge_in_place (&tracks[0], tracks.size()));
+	check_sorted (bus, n_tracks * n_events);
+
+	for (vector<MidiBuffer*>::iterator i = tracks.begin(); i != tracks.end(); ++i) {
+		delete *i;
+	}
+}
+
+void
+MidiBufferTest::mergeIntoNonEmptyTest ()
+{
+	MidiBuffer a (256);
+	MidiBuffer b (256);
+	MidiBuffer dst (256);
+
+	push_note_on (dst, 0, 0, 60);
+	push_note_on (dst, 10, 0, 61);
+	push_note_on (dst, 20, 0, 62);
+
+	push_note_on (a, 5, 1, 70);
+	push_note_on (a, 25, 1, 71);
+
+	push_note_on (b, 1, 2, 80);
+	push_note_on (b, 15, 2, 81);
+
+	const MidiBuffer* srcs[2] = { &a, &b };
+	CPPUNIT_ASSERT (dst.merge_in_place (srcs, 2));
+	check_sorted (dst, 7);
+
+	const uint8_t expected_notes[7] = { 60, 80, 70, 61, 81, 62, 71 };
+	size_t n = 0;
+	for (MidiBuffer::iterator i = dst.begin(); i != dst.end(); ++i, ++n) {
+		CPPUNIT_ASSERT_EQUAL ((int) expected_notes[n], (int) (*i).buffer()[1]);
+	}
+}
+
+void
+MidiBufferTest::mergeSimultaneousTest ()
+{
+	MidiBuffer notes (256);
+	MidiBuffer controls (256);
+	MidiBuffer dst (256);
+
+	push_note_on (notes, 0, 0, 60);
+
+	const uint8_t cc[3] = { 0xb0, 7, 100 };
+	CPPUNIT_ASSERT (controls.push_back (0, 3, cc));
+
+	const MidiBuffer* srcs[2] = { &notes, &controls };
+	CPPUNIT_ASSERT (dst.merge_in_place (srcs, 2));
+	check_sorted (dst, 2);
+
+	/* controller messages precede note-ons on the same channel */
+	CPPUNIT_ASSERT_EQUAL ((int) 0xb0, (int) (*dst.begin()).buffer()[0]);
+}
+
+void
+MidiBufferTest::mergeOverflowTest ()
+{
+	MidiBuffer a (64);
+	MidiBuffer b (64);
+	MidiBuffer dst (64);
+
+	for (size_t e = 0; e < 4; ++e) {
+		push_note_on (a, e, 0, e);
+		push_note_on (b, e, 1, e);
+	}
+
+	/* only one of the sources fits, the other one is dropped */
+	const MidiBuffer* srcs[2] = { &a, &b };
+	CPPUNIT_ASSERT (!dst.merge_in_place (srcs, 2));
+	check_sorted (dst, 4);
+}
@@ -0,0 +1,18 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class MidiBufferTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (MidiBufferTest);
+	CPPUNIT_TEST (mergeManyTest);
+	CPPUNIT_TEST (mergeIntoNonEmptyTest);
+	CPPUNIT_TEST (mergeSimultaneousTest);
+	CPPUNIT_TEST (mergeOverflowTest);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void mergeManyTest ();
+	void mergeIntoNonEmptyTest ();
+	void mergeSimultaneousTest ();
+	void mergeOverflowTest ();
+};
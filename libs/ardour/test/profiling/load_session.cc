@@ -1,7 +1,11 @@
 #include "test_util.h"
+#include <glibmm/miscutils.h>
 #include "pbd/failed_constructor.h"
+#include "pbd/timing.h"
+#include "pbd/xml++.h"
 #include "ardour/ardour.h"
 #include "ardour/audioengine.h"
+#include "ardour/filename_extensions.h"
 #include "ardour/session.h"
 #include <iostream>
 #include <cstdlib>
@@ -20,10 +24,27 @@ int main (int argc, char* argv[])
 
 	ARDOUR::init (false, true, localedir);
 
+	PBD::Timing timing;
+
+	{
+		/* the state file alone, as read by Session::load_state() */
+		XMLTree tree;
+		timing.start ();
+		if (!tree.read (Glib::build_filename (argv[1], string (argv[2]) + statefile_suffix))) {
+			cerr << "Could not read the state file\n";
+			exit (EXIT_FAILURE);
+		}
+		timing.update ();
+	}
+
+	cout << "INFO: read state file in " << timing.elapsed() / 1000 << "ms\n";
+
 	Session* s = 0;
 
 	try {
+		timing.start ();
 		s = load_session (argv[1], argv[2]);
+		timing.update ();
 	} catch (failed_constructor& e) {
 		cerr << "failed_constructor: " << e.what() << "\n";
 		exit (EXIT_FAILURE);
@@ -38,6 +59,8 @@ int main (int argc, char* argv[])
 		exit (EXIT_FAILURE);
 	}
 
+	cout << "INFO: loaded session in " << timing.elapsed() / 1000 << "ms\n";
+
 	AudioEngine::instance()->remove_session ();
 	delete s;
 	AudioEngine::instance()->stop ();
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <glib.h>
+#include "ardour/ardour.h"
+#include "ardour/tempo.h"
+
+using namespace std;
+using namespace ARDOUR;
+using namespace Timecode;
+
+static const char* localedir = LOCALEDIR;
+
+/* Time tempo map lookups in a map with lots of tempo changes, as in a film score */
+int
+main (int argc, char* argv[])
+{
+	int const bars = argc > 1 ? atoi (argv[1]) : 1000;
+	int const lookups = 1000000;
+
+	ARDOUR::init (false, true, localedir);
+
+	TempoMap map (48000);
+	map.add_meter (Meter (4, 4), BBT_Time (1, 1, 0));
+
+	for (int b = 1; b <= bars; ++b) {
+		map.add_tempo (Tempo ((b % 2) ? 120 : 240), BBT_Time (b, 1, 0));
+	}
+
+	framepos_t const end = map.frame_time (BBT_Time (bars, 1, 0));
+	double bpm = 0;
+
+	gint64 start = g_get_monotonic_time ();
+	for (int n = 0; n < lookups; ++n) {
+		bpm += map.tempo_at ((end / lookups) * n).beats_per_minute ();
+	}
+	cout << "tempo_at: " << (g_get_monotonic_time () - start) * 1000.0 / lookups << " ns per lookup\n";
+
+	start = g_get_monotonic_time ();
+	for (int n = 0; n < lookups; ++n) {
+		bpm += map.metric_at (BBT_Time (1 + (n % bars), 2, 0)).tempo().beats_per_minute ();
+	}
+	cout << "metric_at: " << (g_get_monotonic_time () - start) * 1000.0 / lookups << " ns per lookup\n";
+
+	start = g_get_monotonic_time ();
+	for (int n = 0; n < lookups; ++n) {
+		bpm += map.framewalk_to_beats ((end / lookups) * n, 96000).to_double ();
+	}
+	cout << "framewalk_to_beats: " << (g_get_monotonic_time () - start) * 1000.0 / lookups << " ns per walk\n";
+
+	/* so that the lookups are not optimised away */
+	return bpm > 0 ? 0 : 1;
+}
@@ -48,3 +48,129 @@ TempoTest::recomputeMapTest ()
 	--i;
 	CPPUNIT_ASSERT_EQUAL (framepos_t (288e3), (*i)->frame ());
 }
+
+/* Lookups in a map with lots of tempo changes, as in a film score */
+void
+TempoTest::manyTempoLookupTest ()
+{
+	int const sampling_rate = 48000;
+	int const bars = 1000;
+
+	TempoMap map (sampling_rate);
+	Meter meterA (4, 4);
+	map.add_meter (meterA, BBT_Time (1, 1, 0));
+
+	/*
+	  120bpm on odd bars, 240bpm on even bars
+
+	  120bpm = 24e3 samples per beat, 96e3 per bar
+	  240bpm = 12e3 samples per beat, 48e3 per bar
+	*/
+
+	for (int b = 1; b <= bars; ++b) {
+		map.add_tempo (Tempo ((b % 2) ? 120 : 240), BBT_Time (b, 1, 0));
+	}
+
+	CPPUNIT_ASSERT_EQUAL (bars, map.n_tempos ());
+
+	for (int b = 1; b < bars; b += 3) {
+
+		double const bpm = (b % 2) ? 120 : 240;
+		framepos_t const bar_frame = ((b - 1) / 2) * 144e3 + ((b - 1) % 2) * 96e3;
+
+		CPPUNIT_ASSERT_EQUAL (bpm, map.tempo_at (bar_frame).beats_per_minute ());
+		CPPUNIT_ASSERT_EQUAL (bpm, map.tempo_at (bar_frame + 1).beats_per_minute ());
+		CPPUNIT_ASSERT_EQUAL (bar_frame, map.tempo_section_at (bar_frame + 1).frame ());
+		CPPUNIT_ASSERT_EQUAL (framepos_t (0), map.meter_section_at (bar_frame + 1).frame ());
+
+		TempoMetric metric = map.metric_at (BBT_Time (b, 2, 0));
+		CPPUNIT_ASSERT_EQUAL (bpm, metric.tempo().beats_per_minute ());
+		CPPUNIT_ASSERT_EQUAL (bar_frame, metric.frame ());
+
+		/* Add 4 bars worth of beats (over 4 tempo changes) */
+		framepos_t const four_bars_later = bar_frame + 2 * 144e3;
+		if (b + 4 <= bars) {
+			CPPUNIT_ASSERT_EQUAL (four_bars_later, map.framepos_plus_beats (bar_frame, Evoral::Beats (16)));
+		}
+	}
+}
+
+/* Edits only regenerate the map from the changed section onwards; the
+   result must be the same as regenerating all of it.
+*/
+void
+TempoTest::incrementalRecomputeTest ()
+{
+	int const sampling_rate = 44100;
+
+	TempoMap map (sampling_rate);
+	map.add_meter (Meter (4, 4), BBT_Time (1, 1, 0));
+	map.add_tempo (Tempo (133), BBT_Time (1, 1, 0));
+
+	for (uint32_t b = 10; b <= 200; b += 10) {
+		/* tempo changes half way through a bar, at odd tempos */
+		map.add_tempo (Tempo (90 + (b % 7) * 11.3), BBT_Time (b, 3, 0));
+		checkAgainstFullRecompute (map);
+	}
+
+	map.add_meter (Meter (7, 8), BBT_Time (55, 1, 0));
+	checkAgainstFullRecompute (map);
+	map.add_meter (Meter (3, 4), BBT_Time (120, 1, 0));
+	checkAgainstFullRecompute (map);
+
+	/* edits near the end */
+
+	map.add_tempo (Tempo (101.5), BBT_Time (195, 2, 0));
+	checkAgainstFullRecompute (map);
+
+	framepos_t const late = map.frame_time (BBT_Time (190, 4, 0));
+
+	map.remove_tempo (map.tempo_section_at (late), true);
+	checkAgainstFullRecompute (map);
+
+	map.change_existing_tempo_at (late, 140, 4);
+	checkAgainstFullRecompute (map);
+
+	map.replace_meter (map.meter_section_at (late), Meter (5, 4), BBT_Time (130, 1, 0));
+	checkAgainstFullRecompute (map);
+
+	map.remove_meter (map.meter_section_at (late), true);
+	checkAgainstFullRecompute (map);
+
+	/* and at the very start */
+
+	map.change_initial_tempo (150, 4);
+	checkAgainstFullRecompute (map);
+}
+
+void
+TempoTest::checkAgainstFullRecompute (TempoMap& map)
+{
+	TempoMap::BBTPointList const incremental = map._map;
+
+	vector<framepos_t> incremental_metrics;
+	for (Metrics::const_iterator i = map.metrics.begin(); i != map.metrics.end(); ++i) {
+		incremental_metrics.push_back ((*i)->frame ());
+	}
+
+	map.recompute_map (false);
+
+	/* the map must at least reach the last metric section */
+	CPPUNIT_ASSERT (!incremental.empty ());
+	CPPUNIT_ASSERT (incremental.back().frame >= map.metrics.back()->frame ());
+
+	size_t const n = min (incremental.size (), map._map.size ());
+
+	for (size_t i = 0; i < n; ++i) {
+		CPPUNIT_ASSERT_EQUAL (map._map[i].frame, incremental[i].frame);
+		CPPUNIT_ASSERT_EQUAL (map._map[i].bar, incremental[i].bar);
+		CPPUNIT_ASSERT_EQUAL (map._map[i].beat, incremental[i].beat);
+		CPPUNIT_ASSERT (map._map[i].tempo == incremental[i].tempo);
+		CPPUNIT_ASSERT (map._map[i].meter == incremental[i].meter);
+	}
+
+	size_t m = 0;
+	for (Metrics::const_iterator i = map.metrics.begin(); i != map.metrics.end(); ++i, ++m) {
+		CPPUNIT_ASSERT_EQUAL ((*i)->frame (), incremental_metrics[m]);
+	}
+}
@@ -2,10 +2,16 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+namespace ARDOUR {
+	class TempoMap;
+}
+
 class TempoTest : public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE (TempoTest);
 	CPPUNIT_TEST (recomputeMapTest);
+	CPPUNIT_TEST (manyTempoLookupTest);
+	CPPUNIT_TEST (incrementalRecomputeTest);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -13,5 +19,10 @@ public:
 	void tearDown () {}
 
 	void recomputeMapTest ();
+	void manyTempoLookupTest ();
+	void incrementalRecomputeTest ();
+
+private:
+	void checkAgainstFullRecompute (ARDOUR::TempoMap&);
 };
 
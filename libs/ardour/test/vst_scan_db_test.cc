@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ardour/vst_info_file.h"
+
+#include "vst_scan_db_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (VSTScanDBTest);
+
+using namespace std;
+using namespace ARDOUR;
+
+static VSTInfo*
+make_info (const char* name, int id, const char* category, int n_params)
+{
+	VSTInfo* info = (VSTInfo*) calloc (1, sizeof (VSTInfo));
+
+	info->name = strdup (name);
+	info->creator = strdup ("Test");
+	info->UniqueID = id;
+	info->Category = strdup (category);
+	info->numInputs = 2;
+	info->numOutputs = 2;
+	info->numParams = n_params;
+	info->canProcessReplacing = 1;
+	info->ParamNames = (char**) malloc (sizeof (char*) * n_params);
+	info->ParamLabels = (char**) malloc (sizeof (char*) * n_params);
+
+	for (int i = 0; i < n_params; ++i) {
+		info->ParamNames[i] = strdup ("Gain");
+		info->ParamLabels[i] = strdup ("dB");
+	}
+
+	return info;
+}
+
+/** A shell plugin, stored with its own info followed by that of the
+ *  plugins in it, must not disturb the record that follows it.
+ */
+void
+VSTScanDBTest::shellRoundTripTest ()
+{
+	vector<VSTInfo*>* shell = new vector<VSTInfo*>;
+	shell->push_back (make_info ("Shell", 1, "Shell", 0));
+	shell->push_back (make_info ("First", 2, "Effect", 1));
+	shell->push_back (make_info ("Second", 3, "Synth", 2));
+
+	vector<VSTInfo*>* plain = new vector<VSTInfo*>;
+	plain->push_back (make_info ("Plain", 4, "Effect", 3));
+
+	FILE* fp = tmpfile ();
+	CPPUNIT_ASSERT (fp);
+
+	CPPUNIT_ASSERT (vstfx_write_scan_record (fp, "/vst/shell.so", 10, *shell));
+	CPPUNIT_ASSERT (vstfx_write_scan_record (fp, "/vst/plain.so", 20, *plain));
+	rewind (fp);
+
+	string path;
+	int64_t mtime;
+	vector<VSTInfo*>* infos = new vector<VSTInfo*>;
+
+	CPPUNIT_ASSERT (vstfx_read_scan_record (fp, path, mtime, *infos));
+	CPPUNIT_ASSERT_EQUAL (string ("/vst/shell.so"), path);
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 10, mtime);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 3, infos->size ());
+	CPPUNIT_ASSERT_EQUAL (string ("Shell"), string ((*infos)[0]->Category));
+	CPPUNIT_ASSERT_EQUAL (string ("First"), string ((*infos)[1]->name));
+	CPPUNIT_ASSERT_EQUAL (3, (*infos)[2]->UniqueID);
+	CPPUNIT_ASSERT_EQUAL (2, (*infos)[2]->numParams);
+	vstfx_free_info_list (infos);
+
+	infos = new vector<VSTInfo*>;
+	CPPUNIT_ASSERT (vstfx_read_scan_record (fp, path, mtime, *infos));
+	CPPUNIT_ASSERT_EQUAL (string ("/vst/plain.so"), path);
+	CPPUNIT_ASSERT_EQUAL ((int64_t) 20, mtime);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 1, infos->size ());
+	CPPUNIT_ASSERT_EQUAL (string ("Plain"), string ((*infos)[0]->name));
+	CPPUNIT_ASSERT_EQUAL (string ("dB"), string ((*infos)[0]->ParamLabels[2]));
+	vstfx_free_info_list (infos);
+
+	infos = new vector<VSTInfo*>;
+	CPPUNIT_ASSERT (!vstfx_read_scan_record (fp, path, mtime, *infos));
+	CPPUNIT_ASSERT (infos->empty ());
+	vstfx_free_info_list (infos);
+
+	fclose (fp);
+	vstfx_free_info_list (shell);
+	vstfx_free_info_list (plain);
+}
@@ -0,0 +1,12 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class VSTScanDBTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (VSTScanDBTest);
+	CPPUNIT_TEST (shellRoundTripTest);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void shellRoundTripTest ();
+};
@@ -23,6 +23,8 @@
  */
 
 #include <cassert>
+#include <list>
+#include <map>
 
 #include <sys/types.h>
 #include <fcntl.h>
@@ -42,6 +44,7 @@
 #include "pbd/compose.h"
 
 #ifndef VST_SCANNER_APP
+#include "pbd/cpus.h"
 #include "ardour/plugin_manager.h" // scanner_bin_path
 #include "ardour/rc_configuration.h"
 #include "ardour/system_exec.h"
@@ -77,6 +80,9 @@ static bool vstfx_instantiate_and_get_info_lx (const char* dllpath, vector<VSTIn
 /* ID for shell plugins */
 static int vstfx_current_loading_id = 0;
 
+/* false if whoever runs the scanner app looks after the blacklist */
+static bool vstfx_blacklist_while_scanning = true;
+
 /* *** CACHE FILE PATHS *** */
 
 static string
@@ -391,6 +397,7 @@ vstfx_write_info_block (FILE* fp, VSTInfo *info)
 	}
 }
 
+#ifdef VST_SCANNER_APP
 static void
 vstfx_write_info_file (FILE* fp, vector<VSTInfo *> *infos)
 {
@@ -415,6 +422,7 @@ vstfx_write_info_file (FILE* fp, vector<VSTInfo *> *infos)
 		PBD::warning << _("VST object file contains no plugins.") << endmsg;
 	}
 }
+#endif
 
 
 /* *** CACHE MANAGEMENT *** */
@@ -460,6 +468,7 @@ vstfx_infofile_for_read (const char* dllpath)
 	return NULL;
 }
 
+#ifdef VST_SCANNER_APP
 /** newly created cache file for given plugin
  * @return FILE for the .fsi cache or NULL on error
  */
@@ -478,6 +487,7 @@ vstfx_infofile_for_write (const char* dllpath)
 	string const path = vstfx_infofile_path (dllpath);
 	return g_fopen (path.c_str (), "wb");
 }
+#endif
 
 /** check if cache-file exists, is up-to-date and parse cache file
  * @param infos [return] loaded plugin info
@@ -500,6 +510,251 @@ vstfx_get_info_from_file (const char* dllpath, vector<VSTInfo*> *infos)
 
 
 
+#ifndef VST_SCANNER_APP
+
+/* *** SCAN DATABASE *** */
+
+/* The information about all plugins is kept in one file, which is read
+ * when the first plugin is looked up and written back after discovery
+ * found something new.  This saves hashing the path, opening and parsing
+ * a separate file for every plugin at each start.  The .fsi files that the
+ * scanner app writes are only used to hand its results over; they are
+ * moved into the database and removed.
+ */
+
+#define VST_SCAN_DB_HEADER "Ardour VST scan database 2"
+
+struct VSTScanRecord {
+	VSTScanRecord () : mtime (0) {}
+	int64_t          mtime; ///< of the plugin when it was scanned
+	vector<VSTInfo*> infos;
+};
+
+typedef std::map<std::string, VSTScanRecord> VSTScanDB;
+
+static VSTScanDB _scan_db;
+static bool      _scan_db_loaded = false;
+static bool      _scan_db_dirty = false;
+
+static string
+vstfx_scan_db_path ()
+{
+	return Glib::build_filename (get_vst_info_cache_dir (), VST_SCAN_DB);
+}
+
+static int64_t
+vstfx_mtime (const char* path)
+{
+	GStatBuf statbuf;
+	if (g_stat (path, &statbuf) != 0) {
+		return -1;
+	}
+	return statbuf.st_mtime;
+}
+
+/** read a line of any length, without the newline */
+static bool
+read_line (FILE* fp, std::string& line)
+{
+	char buf[MAX_STRING_LEN];
+	line.clear ();
+
+	while (fgets (buf, MAX_STRING_LEN, fp)) {
+		line += buf;
+		if (!line.empty () && line[line.length () - 1] == '\n') {
+			line.erase (line.length () - 1);
+			return true;
+		}
+	}
+
+	return !line.empty ();
+}
+
+bool
+vstfx_write_scan_record (FILE* fp, std::string const & dllpath, int64_t mtime, vector<VSTInfo*> const & infos)
+{
+	assert (fp);
+
+	fprintf (fp, "%s\n", dllpath.c_str ());
+	fprintf (fp, "%lld\n", (long long) mtime);
+	fprintf (fp, "%d\n", (int) infos.size ());
+
+	for (vector<VSTInfo*>::const_iterator x = infos.begin (); x != infos.end (); ++x) {
+		vstfx_write_info_block (fp, *x);
+	}
+
+	return !ferror (fp);
+}
+
+bool
+vstfx_read_scan_record (FILE* fp, std::string& dllpath, int64_t& mtime, vector<VSTInfo*>& infos)
+{
+	assert (fp);
+
+	std::string line;
+	int n_infos;
+
+	if (!read_line (fp, dllpath) || !read_line (fp, line) || read_int (fp, &n_infos) || n_infos < 0) {
+		return false;
+	}
+
+	mtime = g_ascii_strtoll (line.c_str (), NULL, 10);
+
+	for (int i = 0; i < n_infos; ++i) {
+		VSTInfo* info;
+		if ((info = (VSTInfo*) calloc (1, sizeof (VSTInfo))) == 0) {
+			vstfx_clear_info_list (&infos);
+			return false;
+		}
+		if (!vstfx_load_info_block (fp, info)) {
+			vstfx_free_info (info);
+			vstfx_clear_info_list (&infos);
+			return false;
+		}
+		infos.push_back (info);
+	}
+
+	return true;
+}
+
+static VSTInfo*
+vstfx_copy_info (VSTInfo const * info)
+{
+	VSTInfo* copy = (VSTInfo*) calloc (1, sizeof (VSTInfo));
+
+	*copy = *info;
+	copy->name = strdup (info->name);
+	copy->creator = strdup (info->creator);
+	copy->Category = strdup (info->Category);
+	copy->ParamNames = NULL;
+	copy->ParamLabels = NULL;
+
+	if (info->numParams > 0) {
+		copy->ParamNames = (char **) malloc (sizeof (char*) * info->numParams);
+		copy->ParamLabels = (char **) malloc (sizeof (char*) * info->numParams);
+		for (int i = 0; i < info->numParams; ++i) {
+			copy->ParamNames[i] = strdup (info->ParamNames[i]);
+			copy->ParamLabels[i] = strdup (info->ParamLabels[i]);
+		}
+	}
+
+	return copy;
+}
+
+static void
+vstfx_load_scan_db ()
+{
+	if (_scan_db_loaded) {
+		return;
+	}
+
+	_scan_db_loaded = true;
+
+	FILE* fp = g_fopen (vstfx_scan_db_path ().c_str (), "rb");
+
+	if (!fp) {
+		return;
+	}
+
+	std::string line;
+
+	if (read_line (fp, line) && line == VST_SCAN_DB_HEADER) {
+
+		std::string dllpath;
+		VSTScanRecord record;
+
+		while (vstfx_read_scan_record (fp, dllpath, record.mtime, record.infos)) {
+			VSTScanRecord& entry (_scan_db[dllpath]);
+			vstfx_clear_info_list (&entry.infos);
+			entry.mtime = record.mtime;
+			entry.infos.swap (record.infos);
+		}
+	}
+
+	::fclose (fp);
+}
+
+/** copy up-to-date information about @a dllpath from the database
+ * @return true if there was any
+ */
+static bool
+vstfx_get_info_from_db (const char* dllpath, vector<VSTInfo*> *infos)
+{
+	vstfx_load_scan_db ();
+
+	VSTScanDB::iterator i = _scan_db.find (dllpath);
+
+	if (i == _scan_db.end ()) {
+		return false;
+	}
+
+	if (i->second.mtime != vstfx_mtime (dllpath)) {
+		vstfx_clear_info_list (&i->second.infos);
+		_scan_db.erase (i);
+		_scan_db_dirty = true;
+		return false;
+	}
+
+	for (vector<VSTInfo*>::const_iterator x = i->second.infos.begin (); x != i->second.infos.end (); ++x) {
+		infos->push_back (vstfx_copy_info (*x));
+	}
+
+	return true;
+}
+
+static void
+vstfx_add_to_db (const char* dllpath, vector<VSTInfo*> const * infos)
+{
+	if (infos->empty ()) {
+		return;
+	}
+
+	vstfx_load_scan_db ();
+
+	VSTScanRecord& record (_scan_db[dllpath]);
+
+	vstfx_clear_info_list (&record.infos);
+	record.mtime = vstfx_mtime (dllpath);
+
+	for (vector<VSTInfo*>::const_iterator x = infos->begin (); x != infos->end (); ++x) {
+		record.infos.push_back (vstfx_copy_info (*x));
+	}
+
+	_scan_db_dirty = true;
+}
+
+/** move the information that the scanner app (or an older version) wrote
+ * to the .fsi file of @a dllpath into the database
+ */
+static void
+vstfx_import_infofile (const char* dllpath, vector<VSTInfo*> const * infos)
+{
+	vstfx_add_to_db (dllpath, infos);
+	vstfx_remove_infofile (dllpath);
+}
+
+/** @return true if the cache has current information about @a dllpath, without reading it */
+static bool
+vstfx_info_is_current (const char* dllpath)
+{
+	vstfx_load_scan_db ();
+
+	VSTScanDB::const_iterator i = _scan_db.find (dllpath);
+	if (i != _scan_db.end () && i->second.mtime == vstfx_mtime (dllpath)) {
+		return true;
+	}
+
+	GStatBuf dllstat;
+	GStatBuf fsistat;
+
+	return g_stat (dllpath, &dllstat) == 0
+		&& g_stat (vstfx_infofile_path (dllpath).c_str (), &fsistat) == 0
+		&& dllstat.st_mtime <= fsistat.st_mtime;
+}
+
+#endif // VST_SCANNER_APP
+
+
 /* *** VST system-under-test methods *** */
 
 static
@@ -890,19 +1145,207 @@ close_error_log () {
 #endif
 
 
+/* *** PARALLEL SCANNING *** */
+#ifndef VST_SCANNER_APP
+
+static void
+parse_parallel_scanner_output (std::string dllpath, std::string msg, size_t /*len*/)
+{
+	PBD::error << "VST '" << dllpath << "': " << msg;
+}
+
+namespace {
+
+struct VSTScanJob {
+	VSTScanJob (std::string const & p) : dllpath (p), scanner (0), timeout (PLUGIN_SCAN_TIMEOUT) {}
+	std::string                 dllpath;
+	ARDOUR::SystemExec*         scanner;
+	int                         timeout; ///< deciseconds left
+	PBD::ScopedConnectionList   cons;
+};
+
+}
+
+/** Run the scanner app for all of @a dllpaths that have no current cache
+ * entry and are not blacklisted, several at a time.
+ *
+ * Each scan has its own timeout.  The scanner processes do not touch the
+ * blacklist (they could not safely share the file); plugins whose scan
+ * fails or times out are blacklisted here instead.  The results are picked
+ * up from the cache by the usual vstfx_get_info_*() calls afterwards.
+ */
+void
+vstfx_scan_parallel (std::vector<std::string> const & dllpaths)
+{
+	const std::string scanner_bin_path = ARDOUR::PluginManager::scanner_bin_path;
+
+	if (scanner_bin_path.empty ()) {
+		/* scanning in-process can only be done one at a time */
+		return;
+	}
+
+	std::list<std::string> todo;
+
+	for (vector<string>::const_iterator i = dllpaths.begin (); i != dllpaths.end (); ++i) {
+		if (!vst_is_blacklisted (i->c_str ()) && !vstfx_info_is_current (i->c_str ())) {
+			todo.push_back (*i);
+		}
+	}
+
+	const size_t max_jobs = std::max (1U, hardware_concurrency ());
+	const bool   no_timeout = (PLUGIN_SCAN_TIMEOUT <= 0);
+	std::list<VSTScanJob*> running;
+	int ticks = 0;
+
+	while (!todo.empty () || !running.empty ()) {
+
+		const bool cancelled = ARDOUR::PluginManager::instance ().cancelled ();
+
+		while (!cancelled && !todo.empty () && running.size () < max_jobs) {
+
+			VSTScanJob* job = new VSTScanJob (todo.front ());
+			todo.pop_front ();
+
+			char **argp = (char**) calloc (4, sizeof (char*));
+			argp[0] = strdup (scanner_bin_path.c_str ());
+			argp[1] = strdup ("-n");
+			argp[2] = strdup (job->dllpath.c_str ());
+			argp[3] = 0;
+
+			job->scanner = new ARDOUR::SystemExec (scanner_bin_path, argp);
+			job->scanner->ReadStdout.connect_same_thread (job->cons, boost::bind (&parse_parallel_scanner_output, job->dllpath, _1, _2));
+
+			if (job->scanner->start (2 /* send stderr&stdout via signal */)) {
+				PBD::error << string_compose (_("Cannot launch VST scanner app '%1': %2"), scanner_bin_path, strerror (errno)) << endmsg;
+				delete job->scanner;
+				delete job;
+				continue;
+			}
+
+			ARDOUR::PluginScanMessage (_("VST"), job->dllpath, true);
+			running.push_back (job);
+		}
+
+		ARDOUR::GUIIdle ();
+		Glib::usleep (100000);
+
+		int timeout_left = PLUGIN_SCAN_TIMEOUT;
+
+		for (std::list<VSTScanJob*>::iterator j = running.begin (); j != running.end (); ) {
+
+			VSTScanJob* job = *j;
+			bool finished = !job->scanner->is_running ();
+
+			if (!finished && !no_timeout && !ARDOUR::PluginManager::instance ().no_timeout ()) {
+				if (--job->timeout <= 0) {
+					PBD::warning << string_compose (_("VST scanner timed out on '%1'"), job->dllpath) << endmsg;
+					finished = true;
+				}
+			}
+
+			if (!finished && !cancelled) {
+				timeout_left = std::min (timeout_left, job->timeout);
+				++j;
+				continue;
+			}
+
+			job->scanner->terminate ();
+
+			if (cancelled && !finished) {
+				/* scan incomplete, try again next time */
+				vstfx_remove_infofile (job->dllpath.c_str ());
+			} else if (!vstfx_info_is_current (job->dllpath.c_str ())) {
+				vstfx_blacklist (job->dllpath.c_str ());
+			}
+
+			delete job->scanner;
+			delete job;
+			j = running.erase (j);
+		}
+
+		if (!no_timeout && !running.empty () && (++ticks % 5) == 0) {
+			ARDOUR::PluginScanTimeout (timeout_left);
+		}
+	}
+}
+
+void
+vstfx_save_scan_db ()
+{
+	if (!_scan_db_dirty) {
+		return;
+	}
+
+	const string path = vstfx_scan_db_path ();
+	const string tmp_path = path + ".tmp";
+
+	FILE* fp = g_fopen (tmp_path.c_str (), "wb");
+
+	if (!fp) {
+		PBD::warning << string_compose (_("Cannot write VST scan database '%1'"), path) << endmsg;
+		return;
+	}
+
+	bool ok = fprintf (fp, "%s\n", VST_SCAN_DB_HEADER) > 0;
+
+	for (VSTScanDB::iterator i = _scan_db.begin (); ok && i != _scan_db.end (); ++i) {
+		ok = vstfx_write_scan_record (fp, i->first, i->second.mtime, i->second.infos);
+	}
+
+	if (::fclose (fp) != 0) {
+		ok = false;
+	}
+
+	if (!ok) {
+		PBD::warning << string_compose (_("Cannot write VST scan database '%1': %2"), path, strerror (errno)) << endmsg;
+		::g_unlink (tmp_path.c_str ());
+		return;
+	}
+
+	::g_unlink (path.c_str ());
+	if (::g_rename (tmp_path.c_str (), path.c_str ()) == 0) {
+		_scan_db_dirty = false;
+	}
+}
+
+void
+vstfx_clear_scan_db ()
+{
+	for (VSTScanDB::iterator i = _scan_db.begin (); i != _scan_db.end (); ++i) {
+		vstfx_clear_info_list (&i->second.infos);
+	}
+
+	_scan_db.clear ();
+	_scan_db_loaded = true;
+	_scan_db_dirty = false;
+
+	::g_unlink (vstfx_scan_db_path ().c_str ());
+}
+
+#endif // VST_SCANNER_APP
+
+
 /* *** the main function that uses all of the above *** */
 
 static vector<VSTInfo *> *
 vstfx_get_info (const char* dllpath, enum ARDOUR::PluginType type, enum VSTScanMode mode)
 {
-	FILE* infofile;
 	vector<VSTInfo*> *infos = new vector<VSTInfo*>;
 
 	if (vst_is_blacklisted (dllpath)) {
 		return infos;
 	}
 
+#ifndef VST_SCANNER_APP
+	if (vstfx_get_info_from_db (dllpath, infos)) {
+		return infos;
+	}
+#endif
+
 	if (vstfx_get_info_from_file (dllpath, infos)) {
+#ifndef VST_SCANNER_APP
+		vstfx_import_infofile (dllpath, infos);
+#endif
 		return infos;
 	}
 
@@ -958,8 +1401,8 @@ vstfx_get_info (const char* dllpath, enum ARDOUR::PluginType type, enum VSTScanM
 		close_error_log ();
 		/* re-read index (generated by external scanner) */
 		vstfx_clear_info_list (infos);
-		if (!vst_is_blacklisted (dllpath)) {
-			vstfx_get_info_from_file (dllpath, infos);
+		if (!vst_is_blacklisted (dllpath) && vstfx_get_info_from_file (dllpath, infos)) {
+			vstfx_import_infofile (dllpath, infos);
 		}
 		return infos;
 	}
@@ -970,7 +1413,9 @@ vstfx_get_info (const char* dllpath, enum ARDOUR::PluginType type, enum VSTScanM
 
 	bool ok;
 	/* blacklist in case instantiation fails */
-	vstfx_blacklist (dllpath);
+	if (vstfx_blacklist_while_scanning) {
+		vstfx_blacklist (dllpath);
+	}
 
 	switch (type) {
 #ifdef WINDOWS_VST_SUPPORT
@@ -993,10 +1438,13 @@ vstfx_get_info (const char* dllpath, enum ARDOUR::PluginType type, enum VSTScanM
 	}
 
 	/* remove from blacklist */
-	vstfx_un_blacklist (dllpath);
+	if (vstfx_blacklist_while_scanning) {
+		vstfx_un_blacklist (dllpath);
+	}
 
-	/* crate cache/whitelist */
-	infofile = vstfx_infofile_for_write (dllpath);
+#ifdef VST_SCANNER_APP
+	/* hand the result over to the calling process */
+	FILE* infofile = vstfx_infofile_for_write (dllpath);
 	if (!infofile) {
 		PBD::warning << string_compose (_("Cannot cache VST information for '%1': cannot create cache file."), dllpath) << endmsg;
 		return infos;
@@ -1004,6 +1452,9 @@ vstfx_get_info (const char* dllpath, enum ARDOUR::PluginType type, enum VSTScanM
 		vstfx_write_info_file (infofile, infos);
 		fclose (infofile);
 	}
+#else
+	vstfx_add_to_db (dllpath, infos);
+#endif
 	return infos;
 }
 
@@ -519,6 +519,20 @@ VSTPlugin::signal_latency () const
 #endif
 }
 
+framecnt_t
+VSTPlugin::signal_tail_length () const
+{
+	/* 0: not implemented (unknown), 1: no tail */
+	const intptr_t tail = _plugin->dispatcher (_plugin, effGetTailSize, 0, 0, NULL, 0.0f);
+
+	if (tail == 1) {
+		return 0;
+	} else if (tail > 1) {
+		return tail;
+	}
+	return -1;
+}
+
 set<Evoral::Parameter>
 VSTPlugin::automatable () const
 {
@@ -8,6 +8,8 @@
 #include <iostream>
 
 #include "audiographer/visibility.h"
+#include "audiographer/debug_utils.h"
+#include "audiographer/types.h"
 
 namespace AudioGrapher
 {
@@ -36,13 +38,17 @@ enum LIBAUDIOGRAPHER_API DebugLevel
   * The checks specified in \a other_optional_conditionals are only
   * optimized out if \a debug_level() is placed before it with a
   * logical and (short-circuiting).
+  *
+  * Vertices may also count the data passing through them with
+  * \a count_throughput(), and report it with \a debug_throughput(),
+  * to see how much of it had to be copied on the way.
   */
 template<DebugLevel L = DEFAULT_DEBUG_LEVEL>
 class /*LIBAUDIOGRAPHER_API*/ Debuggable
 {
   protected:
 	Debuggable(std::ostream & debug_stream = std::cerr)
-		: stream (debug_stream) {}
+		: stream (debug_stream), frames_processed (0), frames_copied (0) {}
 
 	bool debug_level (DebugLevel level) {
 #ifndef NDEBUG
@@ -54,8 +60,32 @@ class /*LIBAUDIOGRAPHER_API*/ Debuggable
 	}
 	std::ostream & debug_stream() { return stream; }
 
+	/// Counts \a frames processed, \a copied of which had to be copied
+	void count_throughput (framecnt_t frames, framecnt_t copied)
+	{
+		if (debug_level (DebugProcess)) {
+			frames_processed += frames;
+			frames_copied += copied;
+		}
+	}
+
+	/// Prints and resets the counts of \a self, e.g. at the end of input
+	template<typename SelfType>
+	void debug_throughput (SelfType const & self)
+	{
+		if (debug_level (DebugProcess)) {
+			debug_stream() << DebugUtils::demangled_name (self) << ": "
+			               << frames_processed << " frames processed, "
+			               << frames_copied << " copied" << std::endl;
+			frames_processed = 0;
+			frames_copied = 0;
+		}
+	}
+
   private:
 	  std::ostream & stream;
+	  framecnt_t frames_processed;
+	  framecnt_t frames_copied;
 };
 
 
@@ -31,7 +31,11 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
   public:
 	Analyser (float sample_rate, unsigned int channels, framecnt_t bufsize, framecnt_t n_samples);
 	~Analyser ();
-	void process (ProcessContext<float> const & c);
+
+	/** Analysis of the data processed so far. The first call concludes the
+	 * analysis, so this may be called again (e.g. for every file that uses
+	 * this analyser), but no more data should be processed after it.
+	 */
 	ARDOUR::ExportAnalysisPtr result ();
 
 	void set_normalization_gain (float gain) {
@@ -41,12 +45,15 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
 
 	static const float fft_range_db;
 
-	using Sink<float>::process;
+  protected:
+	void read (ProcessContext<float> const & c);
 
 	private:
 	float fft_power_at_bin (const uint32_t b, const float norm) const;
+	void finalize ();
 
 	ARDOUR::ExportAnalysis _result;
+	bool                   _finalized;
 
 	framecnt_t   _n_samples;
 	framecnt_t   _pos;
@@ -60,6 +67,11 @@ class LIBAUDIOGRAPHER_API Analyser : public LoudnessReader
 	float*     _fft_data_out;
 	float*     _fft_power;
 	fftwf_plan _fft_plan;
+
+	/* stereo phase correlation */
+	double     _sum_lr;
+	double     _sum_ll;
+	double     _sum_rr;
 };
 
 } // namespace
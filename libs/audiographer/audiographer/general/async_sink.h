@@ -0,0 +1,240 @@
+#ifndef AUDIOGRAPHER_ASYNC_SINK_H
+#define AUDIOGRAPHER_ASYNC_SINK_H
+
+#include <glibmm/threads.h>
+#include <sigc++/functors/mem_fun.h>
+#include <boost/shared_ptr.hpp>
+
+#include <glib.h>
+#include <algorithm>
+
+#include "pbd/ringbuffer.h"
+
+#include "audiographer/visibility.h"
+#include "audiographer/exception.h"
+#include "audiographer/sink.h"
+#include "audiographer/source.h"
+#include "audiographer/general/threader.h"
+
+namespace AudioGrapher
+{
+
+/// Statistics on how often an asynchronous sink had to wait for its output
+class /*LIBAUDIOGRAPHER_API*/ AsyncSinkStats
+{
+  public:
+	AsyncSinkStats () : _stalls (0), _stall_time (0) {}
+	virtual ~AsyncSinkStats () {}
+
+	/// Number of times the producer found the queue full
+	uint32_t stalls () const { return _stalls; }
+
+	/// Total time the producer spent waiting for space in the queue, in microseconds
+	gint64 stall_time () const { return _stall_time; }
+
+  protected:
+	uint32_t _stalls;
+	gint64   _stall_time;
+};
+
+/** Sink that passes data on to another sink in a thread of its own.
+  * Data is handed over through a bounded lock-free queue, so that the producer
+  * only has to wait when the output can not keep up, e.g. with an expensive encoder.
+  * When the end of input is processed, process() returns only after the output
+  * has processed all data, so the output may be closed right after.
+  */
+template <typename T = DefaultSampleType>
+class /*LIBAUDIOGRAPHER_API*/ AsyncSink
+  : public Sink<T>
+  , public AsyncSinkStats
+{
+  public:
+	/** Constructor. Starts the thread feeding \a output.
+	  * \n NOT RT safe
+	  * \param output the sink that is fed from the background thread
+	  * \param channels channel count of the data
+	  * \param queue_frames size of the queue, in samples (all channels)
+	  */
+	AsyncSink (typename Source<T>::SinkPtr output, ChannelCount channels, framecnt_t queue_frames)
+	  : output (output)
+	  , channels (channels)
+	  , queue (std::max (queue_frames, (framecnt_t) 2 * max_chunk_frames * channels))
+	  , buffer_size (max_chunk_frames * channels)
+	  , end_of_input (false)
+	  , finished (false)
+	  , quit (false)
+	{
+		buffer = new T[buffer_size];
+		thread = Glib::Threads::Thread::create (sigc::mem_fun (*this, &AsyncSink::thread_work));
+	}
+
+	~AsyncSink ()
+	{
+		stop ();
+		delete [] buffer;
+	}
+
+	/** Stops the thread, data that was not processed yet is dropped.
+	  * The output is not used anymore once this returns.
+	  * \n NOT RT safe
+	  */
+	void stop ()
+	{
+		if (!thread) {
+			return;
+		}
+
+		{
+			Glib::Threads::Mutex::Lock lm (mutex);
+			quit = true;
+			finished = true;
+			data_cond.signal ();
+			space_cond.signal ();
+		}
+		thread->join ();
+		thread = 0;
+	}
+
+	/** Queues the data in \a c for the output.
+	  * Waits for space in the queue if it is full, and for the output to finish
+	  * if \a c has the EndOfInput flag set.
+	  * Exceptions thrown by the output are rethrown here.
+	  */
+	void process (ProcessContext<T> const & c)
+	{
+		T const * data = c.data ();
+		framecnt_t frames_left = c.frames ();
+
+		while (frames_left > 0) {
+			framecnt_t frames = std::min (frames_left, (framecnt_t) queue.write_space ());
+			frames -= frames % channels;
+
+			if (frames == 0) {
+				wait_for_space ();
+				continue;
+			}
+
+			queue.write (data, frames);
+			data += frames;
+			frames_left -= frames;
+
+			Glib::Threads::Mutex::Lock lm (mutex);
+			data_cond.signal ();
+		}
+
+		if (c.has_flag (ProcessContext<T>::EndOfInput)) {
+			Glib::Threads::Mutex::Lock lm (mutex);
+			end_of_input = true;
+			data_cond.signal ();
+			while (!finished) {
+				space_cond.wait (mutex);
+			}
+			lm.release ();
+			rethrow_exception ();
+		}
+	}
+
+	using Sink<T>::process;
+
+  private:
+	static const framecnt_t max_chunk_frames = 8192;
+
+	void wait_for_space ()
+	{
+		gint64 const start = g_get_monotonic_time ();
+
+		Glib::Threads::Mutex::Lock lm (mutex);
+		++_stalls;
+		while (queue.write_space () < channels && !finished) {
+			space_cond.wait (mutex);
+		}
+		bool const output_finished = finished;
+		lm.release ();
+
+		_stall_time += g_get_monotonic_time () - start;
+		rethrow_exception ();
+
+		if (output_finished) {
+			throw Exception (*this, "Data processed after end of input");
+		}
+	}
+
+	void rethrow_exception ()
+	{
+		if (exception) {
+			throw *exception;
+		}
+	}
+
+	void thread_work ()
+	{
+		while (true) {
+			bool last;
+
+			{
+				Glib::Threads::Mutex::Lock lm (mutex);
+				while (queue.read_space () < channels && !end_of_input && !quit) {
+					data_cond.wait (mutex);
+				}
+				if (quit) {
+					return;
+				}
+				/* all data was queued before end_of_input was set */
+				last = end_of_input;
+			}
+
+			framecnt_t frames = std::min ((framecnt_t) queue.read_space (), buffer_size);
+			frames -= frames % channels;
+			queue.read (buffer, frames);
+			last = last && queue.read_space () == 0;
+
+			{
+				Glib::Threads::Mutex::Lock lm (mutex);
+				space_cond.signal ();
+			}
+
+			ProcessContext<T> c (buffer, frames, channels);
+			if (last) {
+				c.set_flag (ProcessContext<T>::EndOfInput);
+			}
+
+			try {
+				output->process (c);
+			} catch (std::exception const & e) {
+				Glib::Threads::Mutex::Lock lm (mutex);
+				exception.reset (new ThreaderException (*this, e));
+				finished = true;
+				space_cond.signal ();
+				return;
+			}
+
+			if (last) {
+				Glib::Threads::Mutex::Lock lm (mutex);
+				finished = true;
+				space_cond.signal ();
+				return;
+			}
+		}
+	}
+
+	typename Source<T>::SinkPtr output;
+	ChannelCount   channels;
+
+	RingBuffer<T>  queue;
+	T *            buffer;
+	framecnt_t     buffer_size;
+
+	Glib::Threads::Thread * thread;
+	Glib::Threads::Mutex    mutex;
+	Glib::Threads::Cond     data_cond;   ///< signalled when data is queued
+	Glib::Threads::Cond     space_cond;  ///< signalled when data is dequeued, or the output finished
+	bool end_of_input;
+	bool finished;
+	bool quit;
+
+	boost::shared_ptr<ThreaderException> exception;
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_ASYNC_SINK_H
@@ -36,9 +36,26 @@ class /*LIBAUDIOGRAPHER_API*/ Chunker
 
 	/** Outputs data in \a context in chunks with the size specified in the constructor.
 	  * Note that some calls might not produce any output, while others may produce several.
+	  * Whole chunks are passed on straight from \a context when nothing is buffered,
+	  * only the data that does not line up with the chunks is copied.
 	  * \n RT safe
 	  */
 	void process (ProcessContext<T> const & context)
+	{
+		chunk (context, false);
+	}
+
+	/** Same as the const version, but whole chunks that are passed on
+	  * straight from \a context may be processed in place.
+	  * \n RT safe
+	  */
+	void process (ProcessContext<T> & context)
+	{
+		chunk (context, true);
+	}
+
+  private:
+	void chunk (ProcessContext<T> const & context, bool writable)
 	{
 		check_flags (*this, context);
 
@@ -46,9 +63,25 @@ class /*LIBAUDIOGRAPHER_API*/ Chunker
 		framecnt_t input_position = 0;
 
 		while (position + frames_left >= chunk_size) {
+			if (position == 0) {
+				// Nothing buffered, borrow a whole chunk from the context
+				ProcessContext<T> c_out (context, const_cast<T *> (&context.data()[input_position]), chunk_size);
+				input_position += chunk_size;
+				frames_left -= chunk_size;
+
+				if (frames_left) { c_out.remove_flag(ProcessContext<T>::EndOfInput); }
+				if (writable) {
+					ListedSource<T>::output (c_out);
+				} else {
+					ListedSource<T>::output (static_cast<ProcessContext<T> const &> (c_out));
+				}
+				continue;
+			}
+
 			// Copy from context to buffer
 			framecnt_t const frames_to_copy = chunk_size - position;
 			TypeUtils<T>::copy (&context.data()[input_position], &buffer[position], frames_to_copy);
+			count_throughput (0, frames_to_copy);
 
 			// Update counters
 			position = 0;
@@ -64,17 +97,22 @@ class /*LIBAUDIOGRAPHER_API*/ Chunker
 		if (frames_left) {
 			// Copy the rest of the data
 			TypeUtils<T>::copy (&context.data()[input_position], &buffer[position], frames_left);
+			count_throughput (0, frames_left);
 			position += frames_left;
 		}
 
+		count_throughput (context.frames(), 0);
+
 		if (context.has_flag (ProcessContext<T>::EndOfInput) && position > 0) {
 			ProcessContext<T> c_out (context, buffer, position);
 			ListedSource<T>::output (c_out);
 		}
+
+		if (context.has_flag (ProcessContext<T>::EndOfInput)) {
+			debug_throughput (*this);
+		}
 	}
-	using Sink<T>::process;
 
-  private:
 	framecnt_t chunk_size;
 	framecnt_t position;
 	T * buffer;
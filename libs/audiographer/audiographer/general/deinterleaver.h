@@ -73,6 +73,12 @@ class /*LIBAUDIOGRAPHER_API*/ DeInterleaver
 			throw Exception (*this, "too many frames given to process()");
 		}
 
+		if (channels == 1) {
+			// Nothing to deinterleave, pass the data on as it is
+			if (outputs[0]) { outputs[0]->process (c); }
+			return;
+		}
+
 		unsigned int channel = 0;
 		for (typename std::vector<OutputPtr>::iterator it = outputs.begin(); it != outputs.end(); ++it, ++channel) {
 			if (!*it) { continue; }
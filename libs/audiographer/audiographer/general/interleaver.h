@@ -112,6 +112,13 @@ class /*LIBAUDIOGRAPHER_API*/ Interleaver
 			throw Exception (*this, "Too many frames given to an input");
 		}
 
+		if (channels == 1) {
+			// Nothing to interleave, pass the data on as it is
+			ListedSource<T>::output (c);
+			reset_channels ();
+			return;
+		}
+
 		for (unsigned int i = 0; i < c.frames(); ++i) {
 			buffer[channel + (channels * i)] = c.data()[i];
 		}
@@ -43,11 +43,23 @@ class LIBAUDIOGRAPHER_API LoudnessReader : public ListedSource<float>, public Si
 		return 1.f / get_normalize_gain (target_lufs, target_dbtp);
 	}
 
-	virtual void process (ProcessContext<float> const & c);
+	/// Reads the data, and passes it on
+	void process (ProcessContext<float> const & c)
+	{
+		read (c);
+		ListedSource<float>::output (c);
+	}
 
-	using Sink<float>::process;
+	/// Reads the data, and passes it on for in-place processing
+	void process (ProcessContext<float> & c)
+	{
+		read (c);
+		ListedSource<float>::output (c);
+	}
 
   protected:
+	virtual void read (ProcessContext<float> const & c);
+
 	Vamp::Plugin*  _ebur_plugin;
 	Vamp::Plugin** _dbtp_plugin;
 
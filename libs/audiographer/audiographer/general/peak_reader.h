@@ -29,7 +29,12 @@ class /*LIBAUDIOGRAPHER_API*/ PeakReader : public ListedSource<float>, public Si
 		ListedSource<float>::output(c);
 	}
 
-	using Sink<float>::process;
+	/// Finds peaks from the data, and passes it on for in-place processing \n RT safe
+	void process (ProcessContext<float> & c)
+	{
+		peak = Routines::compute_peak (c.data(), c.frames(), peak);
+		ListedSource<float>::output(c);
+	}
 
   private:
 	float peak;
@@ -2,6 +2,7 @@
 #define AUDIOGRAPHER_SAMPLE_FORMAT_CONVERTER_H
 
 #include "audiographer/visibility.h"
+#include "audiographer/debuggable.h"
 #include "audiographer/sink.h"
 #include "audiographer/utils/listed_source.h"
 #include "private/gdither/gdither_types.h"
@@ -26,6 +27,7 @@ class LIBAUDIOGRAPHER_API SampleFormatConverter
   : public Sink<float>
   , public ListedSource<TOut>
   , public Throwing<>
+  , public Debuggable<>
 {
   public:
 	/** Constructor
@@ -59,6 +61,9 @@ class LIBAUDIOGRAPHER_API SampleFormatConverter
 
 	ChannelCount channels;
 	GDither      dither;
+	bool         use_kernels;   ///< convert all channels at once, without gdither
+	DitherType   dither_type;
+	uint32_t     noise[4];      ///< noise generator state for the kernels
 	framecnt_t   data_out_size;
 	TOut *       data_out;
 
@@ -1,6 +1,11 @@
 #ifndef AUDIOGRAPHER_SR_CONVERTER_H
 #define AUDIOGRAPHER_SR_CONVERTER_H
 
+#include <vector>
+
+#include <glib.h>
+#include <glibmm/threadpool.h>
+#include <glibmm/threads.h>
 #include <samplerate.h>
 
 #include "audiographer/visibility.h"
@@ -25,6 +30,13 @@ class LIBAUDIOGRAPHER_API SampleRateConverter
 	SampleRateConverter (uint32_t channels);
 	~SampleRateConverter ();
 
+	/** Convert on the threads of \a thread_pool, must be called before init().
+	  * Multichannel data is converted one channel per thread, mono data in
+	  * overlapping blocks, one block per thread.
+	  * \n Not RT safe
+	  */
+	void set_thread_pool (Glib::ThreadPool & thread_pool) { this->thread_pool = &thread_pool; }
+
 	/// Init converter \n Not RT safe
 	void init (framecnt_t in_rate, framecnt_t out_rate, int quality = 0);
 
@@ -42,6 +54,33 @@ class LIBAUDIOGRAPHER_API SampleRateConverter
 
   private:
 
+	enum Mode {
+		Serial,          ///< one converter for all channels
+		ChannelParallel, ///< one converter per channel, run concurrently
+		BlockParallel    ///< mono data, blocks converted concurrently
+	};
+
+	struct Job {
+		Job () : state (0), discard (0), take (0), produced (0), error (0) {}
+		SRC_STATE *        state;
+		SRC_DATA           data;
+		std::vector<float> in;
+		std::vector<float> out;
+		framecnt_t         discard;  ///< output frames generated from the block overlap
+		framecnt_t         take;     ///< output frames to use, -1 for all
+		framecnt_t         produced;
+		int                error;
+	};
+
+	void process_channels (ProcessContext<float> const & c);
+	void process_blocks (ProcessContext<float> const & c);
+	void convert_blocks (ProcessContext<float> const & c, bool end_of_input);
+	void output_blocks (ProcessContext<float> const & c, float * data, framecnt_t frames, bool last);
+
+	void run_jobs (uint32_t count);
+	void run_job (uint32_t job);
+	void convert_block (Job & job);
+
 	void set_end_of_input (ProcessContext<float> const & c);
 	void reset ();
 
@@ -58,6 +97,23 @@ class LIBAUDIOGRAPHER_API SampleRateConverter
 
 	SRC_DATA       src_data;
 	SRC_STATE*     src_state;
+
+	Glib::ThreadPool *   thread_pool;
+	Mode                 mode;
+	std::vector<Job>     jobs;
+	gint                 pending_jobs;
+	Glib::Threads::Mutex jobs_mutex;
+	Glib::Threads::Cond  jobs_cond;
+
+	/* BlockParallel: input is kept from block_position on */
+	std::vector<float>   block_data;
+	framecnt_t           block_position;
+	framecnt_t           block_frames;
+	framecnt_t           next_block;
+	framecnt_t           block_length;
+	framecnt_t           block_overlap;
+	framecnt_t           ratio_in;   ///< block_length and block_overlap are multiples of this,
+	framecnt_t           ratio_out;  ///< and yield this many output frames per multiple
 };
 
 } // namespace
@@ -0,0 +1,150 @@
+#ifndef AUDIOGRAPHER_SNDFILE_SPLICER_H
+#define AUDIOGRAPHER_SNDFILE_SPLICER_H
+
+#include <list>
+#include <string>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "audiographer/sink.h"
+#include "audiographer/types.h"
+#include "audiographer/utils/listed_source.h"
+#include "audiographer/sndfile/sndfile_base.h"
+
+namespace AudioGrapher
+{
+
+/** Fills in ranges of a stream from a previously written file.
+  * The input holds the data of every position that is not in one of the ranges,
+  * the data of the ranges is read from the file (at the same position), and
+  * output in between, so that the output is the complete stream.
+  * Positions are in frames (per channel) from the beginning of the stream.
+  * Only short, int and float are valid template parameters
+  */
+template<typename T = DefaultSampleType>
+class SndfileSplicer
+  : public virtual SndfileBase
+  , public ListedSource<T>
+  , public Sink<T>
+  , public Throwing<>
+{
+  public:
+	/// Ranges as position and length, in frames
+	typedef std::list<std::pair<framecnt_t, framecnt_t> > RangeList;
+
+	/** Constructor. \n NOT RT safe
+	  * \param path file to read the ranges from
+	  * \param ranges ranges to splice in, sorted by position and not overlapping
+	  */
+	SndfileSplicer (std::string const & path, RangeList const & ranges)
+	  : SndfileHandle (path)
+	  , ranges (ranges)
+	  , position (0)
+	  , buffer (0)
+	{
+		if (error ()) {
+			throw Exception (*this, boost::str (boost::format
+				("Could not open file to splice from: %1% (%2%)") % path % strError ()));
+		}
+		buffer = new T[buffer_frames * channels()];
+	}
+
+	~SndfileSplicer ()
+	{
+		delete [] buffer;
+	}
+
+	/** Outputs the data in \a c after all ranges before it.
+	  * If \a c has the EndOfInput flag set, the rest of the ranges are output
+	  * after it, followed by an empty context that has EndOfInput set.
+	  */
+	void process (ProcessContext<T> const & c)
+	{
+		if (c.channels() != channels()) {
+			throw Exception (*this, boost::str (boost::format
+				("Wrong number of channels given to process(), %1% instead of %2%")
+				% c.channels() % channels()));
+		}
+
+		T const * data = c.data();
+		framecnt_t frames_left = c.frames_per_channel();
+
+		while (frames_left > 0) {
+			splice_ranges ();
+
+			framecnt_t frames = frames_left;
+			if (!ranges.empty()) {
+				frames = std::min (frames, ranges.front().first - position);
+			}
+
+			ProcessContext<T> c_out (c, const_cast<T *> (data), frames * c.channels());
+			c_out.remove_flag (ProcessContext<T>::EndOfInput);
+			ListedSource<T>::output (c_out);
+
+			data += frames * c.channels();
+			frames_left -= frames;
+			position += frames;
+		}
+
+		if (!c.has_flag (ProcessContext<T>::EndOfInput)) {
+			return;
+		}
+
+		splice_ranges ();
+
+		if (!ranges.empty()) {
+			throw Exception (*this, boost::str (boost::format
+				("Input ended at frame %1%, before the range at %2%")
+				% position % ranges.front().first));
+		}
+
+		ProcessContext<T> c_out (c, buffer, 0);
+		ListedSource<T>::output (c_out);
+	}
+
+	using Sink<T>::process;
+
+  private:
+	static const framecnt_t buffer_frames = 8192;
+
+	/// Outputs the ranges that start at the current position
+	void splice_ranges ()
+	{
+		while (!ranges.empty() && ranges.front().first == position) {
+
+			if (seek (position, SEEK_SET) != position) {
+				throw Exception (*this, boost::str (boost::format
+					("Could not seek to frame %1% of the file to splice from") % position));
+			}
+
+			framecnt_t frames_left = ranges.front().second;
+			while (frames_left > 0) {
+				framecnt_t const frames = std::min (frames_left, (framecnt_t) buffer_frames);
+				framecnt_t const samples = frames * channels();
+
+				if (read (buffer, samples) != samples) {
+					throw Exception (*this, boost::str (boost::format
+						("Could not read frames %1% to %2% of the file to splice from")
+						% position % (position + frames)));
+				}
+
+				ProcessContext<T> c_out (buffer, samples, channels());
+				ListedSource<T>::output (c_out);
+
+				frames_left -= frames;
+				position += frames;
+			}
+
+			ranges.pop_front ();
+		}
+	}
+
+	RangeList  ranges;
+	framecnt_t position;
+	T *        buffer;
+};
+
+} // namespace
+
+#endif // AUDIOGRAPHER_SNDFILE_SPLICER_H
@@ -32,14 +32,19 @@ class /*LIBAUDIOGRAPHER_API*/ ListedSource : public Source<T>
 		}
 	}
 
+	/** Helper for derived classes that may hand \a c on for in-place processing.
+	  * All outputs but the last one are given \a c as const, the last one is
+	  * done after everybody else has seen the data, so it may modify it.
+	  */
 	void output (ProcessContext<T> & c)
 	{
-		if (output_size_is_one()) {
-			// only one output, so we can keep this non-const
-			outputs.front()->process (c);
-		} else {
-			output (const_cast<ProcessContext<T> const &> (c));
+		if (outputs.empty()) { return; }
+
+		typename SinkList::iterator last = --outputs.end();
+		for (typename SinkList::iterator i = outputs.begin(); i != last; ++i) {
+			(*i)->process (const_cast<ProcessContext<T> const &> (c));
 		}
+		(*last)->process (c);
 	}
 
 	inline bool output_size_is_one () { return (!outputs.empty() && ++outputs.begin() == outputs.end()); }
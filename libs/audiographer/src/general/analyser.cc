@@ -25,8 +25,12 @@ const float Analyser::fft_range_db (120); // dB
 
 Analyser::Analyser (float sample_rate, unsigned int channels, framecnt_t bufsize, framecnt_t n_samples)
 	: LoudnessReader (sample_rate, channels, bufsize)
+	, _finalized (false)
 	, _n_samples (n_samples)
 	, _pos (0)
+	, _sum_lr (0)
+	, _sum_ll (0)
+	, _sum_rr (0)
 {
 	//printf ("NEW ANALYSER %p r:%.1f c:%d f:%ld l%ld\n", this, sample_rate, channels, bufsize, n_samples);
 	assert (bufsize % channels == 0);
@@ -102,7 +106,7 @@ Analyser::~Analyser ()
 }
 
 void
-Analyser::process (ProcessContext<float> const & ctx)
+Analyser::read (ProcessContext<float> const & ctx)
 {
 	const framecnt_t n_samples = ctx.frames () / ctx.channels ();
 	assert (ctx.channels () == _channels);
@@ -113,7 +117,6 @@ Analyser::process (ProcessContext<float> const & ctx)
 	// allow 1 sample slack for resampling
 	if (_pos + n_samples > _n_samples + 1) {
 		_pos += n_samples;
-		ListedSource<float>::output (ctx);
 		return;
 	}
 
@@ -137,6 +140,14 @@ Analyser::process (ProcessContext<float> const & ctx)
 		}
 	}
 
+	if (_result.n_channels == 2) {
+		for (s = 0; s < n_samples; ++s) {
+			_sum_lr += _bufs[0][s] * _bufs[1][s];
+			_sum_ll += _bufs[0][s] * _bufs[0][s];
+			_sum_rr += _bufs[1][s] * _bufs[1][s];
+		}
+	}
+
 	for (; s < _bufsize; ++s) {
 		_fft_data_in[s] = 0;
 		for (unsigned int c = 0; c < _result.n_channels; ++c) {
@@ -148,9 +159,16 @@ Analyser::process (ProcessContext<float> const & ctx)
 		_ebur_plugin->process (_bufs, Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
 	}
 
+	/* the first (two) channel(s) are already de-interleaved for the loudness
+	 * analysis, only other channels need to be copied for the true-peak analysis.
+	 */
 	float const * const data = ctx.data ();
 	for (unsigned int c = 0; c < _channels; ++c) {
 		if (!_dbtp_plugin[c]) { continue; }
+		if (c < _result.n_channels) {
+			_dbtp_plugin[c]->process (&_bufs[c], Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
+			continue;
+		}
 		for (s = 0; s < n_samples; ++s) {
 			_bufs[0][s] = data[s * _channels + c];
 		}
@@ -196,9 +214,6 @@ Analyser::process (ProcessContext<float> const & ctx)
 	}
 
 	_pos += n_samples;
-
-	/* pass audio audio through */
-	ListedSource<float>::output (ctx);
 }
 
 ARDOUR::ExportAnalysisPtr
@@ -209,6 +224,17 @@ Analyser::result ()
 		return ARDOUR::ExportAnalysisPtr ();
 	}
 
+	if (!_finalized) {
+		finalize ();
+		_finalized = true;
+	}
+
+	return ARDOUR::ExportAnalysisPtr (new ARDOUR::ExportAnalysis (_result));
+}
+
+void
+Analyser::finalize ()
+{
 	if (_pos + 1 < _n_samples) {
 		// crude re-bin (silence stripped version)
 		const size_t peaks = sizeof (_result.peaks) / sizeof (ARDOUR::PeakData::PeakDatum) / 4;
@@ -265,7 +291,10 @@ Analyser::result ()
 		}
 	}
 
-	return ARDOUR::ExportAnalysisPtr (new ARDOUR::ExportAnalysis (_result));
+	if (_result.n_channels == 2 && _sum_ll > 0 && _sum_rr > 0) {
+		_result.correlation = _sum_lr / sqrt (_sum_ll * _sum_rr);
+		_result.have_correlation = true;
+	}
 }
 
 float
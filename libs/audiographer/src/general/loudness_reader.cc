@@ -89,7 +89,7 @@ LoudnessReader::reset ()
 }
 
 void
-LoudnessReader::process (ProcessContext<float> const & ctx)
+LoudnessReader::read (ProcessContext<float> const & ctx)
 {
 	const framecnt_t n_samples = ctx.frames () / ctx.channels ();
 	assert (ctx.channels () == _channels);
@@ -118,7 +118,7 @@ LoudnessReader::process (ProcessContext<float> const & ctx)
 			_dbtp_plugin[0]->process (&_bufs[0], Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
 		}
 		if (_channels == 2 && _dbtp_plugin[1]) {
-			_dbtp_plugin[0]->process (&_bufs[1], Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
+			_dbtp_plugin[1]->process (&_bufs[1], Vamp::RealTime::fromSeconds ((double) _pos / _sample_rate));
 		}
 	}
 
@@ -138,7 +138,6 @@ LoudnessReader::process (ProcessContext<float> const & ctx)
 	}
 
 	_pos += n_samples;
-	ListedSource<float>::output (ctx);
 }
 
 float
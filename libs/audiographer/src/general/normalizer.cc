@@ -68,11 +68,15 @@ void Normalizer::process (ProcessContext<float> const & c)
 		throw Exception (*this, "Too many frames given to process()");
 	}
 
-	if (enabled) {
-		memcpy (buffer, c.data(), c.frames() * sizeof(float));
-		Routines::apply_gain_to_buffer (buffer, c.frames(), gain);
+	if (!enabled) {
+		/* nothing to do, pass the data on unmodified */
+		ListedSource<float>::output (c);
+		return;
 	}
 
+	memcpy (buffer, c.data(), c.frames() * sizeof(float));
+	Routines::apply_gain_to_buffer (buffer, c.frames(), gain);
+
 	ProcessContext<float> c_out (c, buffer);
 	ListedSource<float>::output (c_out);
 }
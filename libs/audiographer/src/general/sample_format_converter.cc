@@ -24,19 +24,230 @@
 #include "audiographer/type_utils.h"
 #include "private/gdither/gdither.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 #include <boost/format.hpp>
 
+#include <glib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace AudioGrapher
 {
 
+/* Conversion kernels for the common cases: 16 bit and 24 bit (in 32 bit words)
+ * output with no, rectangular or triangular (TPDF) dither.
+ *
+ * Unlike gdither, these process the interleaved data of all channels in one go.
+ * There are four independent xorshift noise generators, sample n always uses
+ * generator (n % 4), so the SSE2 and the plain C versions produce the same output.
+ * Noise shaping needs the error of the previous sample of the same channel and
+ * is left to gdither.
+ */
+
+namespace {
+
+inline uint32_t
+next_noise (uint32_t & state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/* uniform noise in [0, 1) */
+inline float
+noise_to_float (uint32_t n)
+{
+	return (n >> 8) * (1.0f / 16777216.0f);
+}
+
+template <DitherType D>
+inline float
+dither_sample (float v, uint32_t & state)
+{
+	switch (D) {
+	case D_Rect:
+		return v - noise_to_float (next_noise (state));
+	case D_Tri:
+	{
+		float const a = noise_to_float (next_noise (state));
+		float const b = noise_to_float (next_noise (state));
+		return v + a - b;
+	}
+	default:
+		return v;
+	}
+}
+
+#ifdef __SSE2__
+
+inline __m128
+next_noise_ps (__m128i & state)
+{
+	state = _mm_xor_si128 (state, _mm_slli_epi32 (state, 13));
+	state = _mm_xor_si128 (state, _mm_srli_epi32 (state, 17));
+	state = _mm_xor_si128 (state, _mm_slli_epi32 (state, 5));
+	return _mm_mul_ps (_mm_cvtepi32_ps (_mm_srli_epi32 (state, 8)), _mm_set1_ps (1.0f / 16777216.0f));
+}
+
+template <DitherType D>
+inline __m128i
+convert_ps (__m128 v, __m128i & state, __m128 const & scale, __m128 const & lower, __m128 const & upper)
+{
+	v = _mm_mul_ps (v, scale);
+
+	switch (D) {
+	case D_Rect:
+		v = _mm_sub_ps (v, next_noise_ps (state));
+		break;
+	case D_Tri:
+	{
+		__m128 const a = next_noise_ps (state);
+		__m128 const b = next_noise_ps (state);
+		v = _mm_add_ps (v, _mm_sub_ps (a, b));
+		break;
+	}
+	default:
+		break;
+	}
+
+	/* rounds to nearest, like lrintf() */
+	return _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (v, lower), upper));
+}
+
+#endif
+
+template <DitherType D>
+void
+convert_16 (float const * in, int16_t * out, framecnt_t samples, uint32_t * noise)
+{
+	framecnt_t i = 0;
+
+#ifdef __SSE2__
+	__m128i state = _mm_loadu_si128 ((__m128i const *) noise);
+	__m128 const scale = _mm_set1_ps (32768.0f);
+	__m128 const lower = _mm_set1_ps (-32768.0f);
+	__m128 const upper = _mm_set1_ps (32767.0f);
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i const a = convert_ps<D> (_mm_loadu_ps (in + i), state, scale, lower, upper);
+		__m128i const b = convert_ps<D> (_mm_loadu_ps (in + i + 4), state, scale, lower, upper);
+		_mm_storeu_si128 ((__m128i *) (out + i), _mm_packs_epi32 (a, b));
+	}
+
+	_mm_storeu_si128 ((__m128i *) noise, state);
+#endif
+
+	for (; i < samples; ++i) {
+		float const v = dither_sample<D> (in[i] * 32768.0f, noise[i & 3]);
+		out[i] = (int16_t) lrintf (std::min (std::max (v, -32768.0f), 32767.0f));
+	}
+}
+
+template <DitherType D>
+void
+convert_24 (float const * in, int32_t * out, framecnt_t samples, uint32_t * noise)
+{
+	framecnt_t i = 0;
+
+#ifdef __SSE2__
+	__m128i state = _mm_loadu_si128 ((__m128i const *) noise);
+	__m128 const scale = _mm_set1_ps (8388608.0f);
+	__m128 const lower = _mm_set1_ps (-8388608.0f);
+	__m128 const upper = _mm_set1_ps (8388607.0f);
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i const a = convert_ps<D> (_mm_loadu_ps (in + i), state, scale, lower, upper);
+		__m128i const b = convert_ps<D> (_mm_loadu_ps (in + i + 4), state, scale, lower, upper);
+		_mm_storeu_si128 ((__m128i *) (out + i), _mm_slli_epi32 (a, 8));
+		_mm_storeu_si128 ((__m128i *) (out + i + 4), _mm_slli_epi32 (b, 8));
+	}
+
+	_mm_storeu_si128 ((__m128i *) noise, state);
+#endif
+
+	for (; i < samples; ++i) {
+		float const v = dither_sample<D> (in[i] * 8388608.0f, noise[i & 3]);
+		out[i] = (int32_t) (lrintf (std::min (std::max (v, -8388608.0f), 8388607.0f)) * 256);
+	}
+}
+
+inline void
+convert_samples (DitherType type, float const * in, int16_t * out, framecnt_t samples, uint32_t * noise)
+{
+	switch (type) {
+	case D_Rect: convert_16<D_Rect> (in, out, samples, noise); break;
+	case D_Tri:  convert_16<D_Tri> (in, out, samples, noise); break;
+	default:     convert_16<D_None> (in, out, samples, noise); break;
+	}
+}
+
+inline void
+convert_samples (DitherType type, float const * in, int32_t * out, framecnt_t samples, uint32_t * noise)
+{
+	switch (type) {
+	case D_Rect: convert_24<D_Rect> (in, out, samples, noise); break;
+	case D_Tri:  convert_24<D_Tri> (in, out, samples, noise); break;
+	default:     convert_24<D_None> (in, out, samples, noise); break;
+	}
+}
+
+/* there are no kernels for other types */
+template <typename TOut>
+inline void
+convert_samples (DitherType, float const *, TOut *, framecnt_t, uint32_t *)
+{
+	assert (false);
+}
+
+inline bool
+has_kernel (int type)
+{
+	return type == D_None || type == D_Rect || type == D_Tri;
+}
+
+/** @return a non-zero noise generator seed, different for each call
+ *  (converters of different channels or exports must not produce the
+ *  same dither noise)
+ */
+inline uint32_t
+noise_seed (uint64_t salt)
+{
+	static gint counter = 0;
+	uint64_t x = salt + (uint64_t) g_atomic_int_add (&counter, 1) * 0x9e3779b97f4a7c15ULL;
+
+	/* splitmix64 finalizer */
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+
+	uint32_t const seed = (uint32_t) (x ^ (x >> 32));
+	return seed ? seed : 0x9e3779b9;
+}
+
+} // anon namespace
+
 template <typename TOut>
 SampleFormatConverter<TOut>::SampleFormatConverter (ChannelCount channels) :
   channels (channels),
   dither (0),
+  use_kernels (false),
+  dither_type (D_None),
   data_out_size (0),
   data_out (0),
   clip_floats (false)
 {
+	uint64_t const salt = (uint64_t) (uintptr_t) this;
+
+	for (int i = 0; i < 4; ++i) {
+		noise[i] = noise_seed (salt);
+	}
 }
 
 template <>
@@ -64,6 +275,8 @@ SampleFormatConverter<int32_t>::init (framecnt_t max_frames, int type, int data_
 
 	init_common (max_frames);
 	dither = gdither_new ((GDitherType) type, channels, GDither32bit, data_width);
+	dither_type = (DitherType) type;
+	use_kernels = data_width == 24 && has_kernel (type);
 }
 
 template <>
@@ -77,6 +290,8 @@ SampleFormatConverter<int16_t>::init (framecnt_t max_frames, int type, int data_
 	}
 	init_common (max_frames);
 	dither = gdither_new ((GDitherType) type, channels, GDither16bit, data_width);
+	dither_type = (DitherType) type;
+	use_kernels = data_width == 16 && has_kernel (type);
 }
 
 template <>
@@ -125,6 +340,7 @@ SampleFormatConverter<TOut>::reset()
 	data_out_size = 0;
 	data_out = 0;
 
+	use_kernels = false;
 	clip_floats = false;
 }
 
@@ -139,14 +355,23 @@ SampleFormatConverter<TOut>::process (ProcessContext<float> const & c_in)
 
 	/* Do conversion */
 
-	for (uint32_t chn = 0; chn < c_in.channels(); ++chn) {
-		gdither_runf (dither, chn, c_in.frames_per_channel (), data, data_out);
+	if (use_kernels) {
+		convert_samples (dither_type, data, data_out, c_in.frames (), noise);
+	} else {
+		for (uint32_t chn = 0; chn < c_in.channels(); ++chn) {
+			gdither_runf (dither, chn, c_in.frames_per_channel (), data, data_out);
+		}
 	}
 
 	/* Write forward */
 
 	ProcessContext<TOut> c_out(c_in, data_out);
 	this->output (c_out);
+
+	count_throughput (c_in.frames (), 0);
+	if (c_in.has_flag (ProcessContext<float>::EndOfInput)) {
+		debug_throughput (*this);
+	}
 }
 
 /* Basic non-const version of process(), calls the const one */
@@ -176,16 +401,34 @@ SampleFormatConverter<float>::process (ProcessContext<float> & c_in)
 	}
 
 	output (c_in);
+
+	count_throughput (frames, 0);
+	if (c_in.has_flag (ProcessContext<float>::EndOfInput)) {
+		debug_throughput (*this);
+	}
 }
 
-/* template specialized const version, copies the data, and calls the non-const version */
+/* template specialized const version, copies the data if it needs clipping, and calls the non-const version */
 template<>
 void
 SampleFormatConverter<float>::process (ProcessContext<float> const & c_in)
 {
-	// Make copy of data and pass it to non-const version
 	check_frame_and_channel_count (c_in.frames(), c_in.channels());
+
+	if (!clip_floats) {
+		// Nothing to do, the data can be passed on as it is
+		output (c_in);
+
+		count_throughput (c_in.frames(), 0);
+		if (c_in.has_flag (ProcessContext<float>::EndOfInput)) {
+			debug_throughput (*this);
+		}
+		return;
+	}
+
+	// Make copy of data and pass it to non-const version
 	TypeUtils<float>::copy (c_in.data(), data_out, c_in.frames());
+	count_throughput (0, c_in.frames());
 
 	ProcessContext<float> c (c_in, data_out);
 	process (c);
@@ -25,6 +25,7 @@
 
 #include <cmath>
 #include <boost/format.hpp>
+#include <sigc++/bind.h>
 
 namespace AudioGrapher
 {
@@ -41,6 +42,16 @@ SampleRateConverter::SampleRateConverter (uint32_t channels)
   , data_out (0)
   , data_out_size (0)
   , src_state (0)
+  , thread_pool (0)
+  , mode (Serial)
+  , pending_jobs (0)
+  , block_position (0)
+  , block_frames (0)
+  , next_block (0)
+  , block_length (0)
+  , block_overlap (0)
+  , ratio_in (1)
+  , ratio_out (1)
 {
 	add_supported_flag (ProcessContext<>::EndOfInput);
 }
@@ -56,15 +67,55 @@ SampleRateConverter::init (framecnt_t in_rate, framecnt_t out_rate, int quality)
 	}
 
 	active = true;
+	src_data.src_ratio = (double) out_rate / (double) in_rate;
+
+	uint32_t threads = 1;
+	if (thread_pool) {
+		int const max_threads = thread_pool->get_max_threads ();
+		threads = max_threads > 0 ? max_threads : channels;
+	}
+
+	if (threads > 1 && channels > 1) {
+		mode = ChannelParallel;
+		jobs.resize (channels);
+	} else if (threads > 1) {
+		mode = BlockParallel;
+		jobs.resize (threads);
+
+		/* Blocks start at input positions that map to whole output frames,
+		 * and are preceded and followed by enough input to cover the filter.
+		 */
+		framecnt_t a = in_rate;
+		framecnt_t b = out_rate;
+		while (b) { framecnt_t const t = a % b; a = b; b = t; }
+		ratio_in = in_rate / a;
+		ratio_out = out_rate / a;
+		block_overlap = ratio_in * ((4096 + ratio_in - 1) / ratio_in);
+		block_length = ratio_in * ((65536 + ratio_in - 1) / ratio_in);
+	} else {
+		mode = Serial;
+	}
+
 	int err;
-	src_state = src_new (quality, channels, &err);
-	if (throw_level (ThrowObject) && !src_state) {
-		throw Exception (*this, str (format
-			("Cannot initialize sample rate converter: %1%")
-			% src_strerror (err)));
+
+	if (mode == Serial) {
+		src_state = src_new (quality, channels, &err);
+		if (throw_level (ThrowObject) && !src_state) {
+			throw Exception (*this, str (format
+				("Cannot initialize sample rate converter: %1%")
+				% src_strerror (err)));
+		}
+		return;
 	}
 
-	src_data.src_ratio = (double) out_rate / (double) in_rate;
+	for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+		i->state = src_new (quality, 1, &err);
+		if (throw_level (ThrowObject) && !i->state) {
+			throw Exception (*this, str (format
+				("Cannot initialize sample rate converter: %1%")
+				% src_strerror (err)));
+		}
+	}
 }
 
 SampleRateConverter::~SampleRateConverter ()
@@ -94,6 +145,19 @@ SampleRateConverter::allocate_buffers (framecnt_t max_frames)
 
 		max_frames_in = max_frames;
 		data_out_size = max_frames_out;
+
+		if (mode == ChannelParallel) {
+			for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+				i->in.resize ((max_leftover_frames + max_frames) / channels);
+				i->out.resize (max_frames_out / channels);
+			}
+		} else if (mode == BlockParallel) {
+			block_data.resize (2 * block_overlap + jobs.size() * block_length + max_frames);
+			framecnt_t const block_out = (framecnt_t) ceil ((2 * block_overlap + block_length) * src_data.src_ratio) + 64;
+			for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+				i->out.resize (block_out);
+			}
+		}
 	}
 
 	return max_frames_out;
@@ -118,6 +182,14 @@ SampleRateConverter::process (ProcessContext<float> const & c)
 			% frames % max_frames_in));
 	}
 
+	if (mode == ChannelParallel) {
+		process_channels (c);
+		return;
+	} else if (mode == BlockParallel) {
+		process_blocks (c);
+		return;
+	}
+
 	int err;
 	bool first_time = true;
 
@@ -204,6 +276,253 @@ SampleRateConverter::process (ProcessContext<float> const & c)
 	}
 }
 
+void
+SampleRateConverter::process_channels (ProcessContext<float> const & c)
+{
+	framecnt_t const frames = c.frames_per_channel ();
+	float const * in = c.data ();
+	bool const end_of_input = c.has_flag (ProcessContext<float>::EndOfInput);
+
+	/* deinterleave the new data behind what was left over last time */
+
+	for (uint32_t chn = 0; chn < channels; ++chn) {
+		float * chn_in = &jobs[chn].in[leftover_frames];
+		for (framecnt_t i = 0; i < frames; ++i) {
+			chn_in[i] = in[i * channels + chn];
+		}
+	}
+
+	framecnt_t input_frames = leftover_frames + frames;
+	bool more;
+
+	do {
+		for (uint32_t chn = 0; chn < channels; ++chn) {
+			SRC_DATA & data (jobs[chn].data);
+			data.data_in = &jobs[chn].in[0];
+			data.input_frames = input_frames;
+			data.data_out = &jobs[chn].out[0];
+			data.output_frames = jobs[chn].out.size();
+			data.end_of_input = end_of_input;
+			data.src_ratio = src_data.src_ratio;
+		}
+
+		run_jobs (channels);
+
+		/* all channels see the same amount of data, so they stay in step */
+
+		framecnt_t const used = jobs[0].data.input_frames_used;
+		framecnt_t const generated = jobs[0].data.output_frames_gen;
+
+		for (uint32_t chn = 1; chn < channels; ++chn) {
+			if (throw_level (ThrowProcess) &&
+			    (jobs[chn].data.input_frames_used != used || jobs[chn].data.output_frames_gen != generated)) {
+				throw Exception (*this, "Channels were converted out of step");
+			}
+		}
+
+		for (uint32_t chn = 0; chn < channels; ++chn) {
+			float const * chn_out = &jobs[chn].out[0];
+			for (framecnt_t i = 0; i < generated; ++i) {
+				data_out[i * channels + chn] = chn_out[i];
+			}
+		}
+
+		leftover_frames = input_frames - used;
+
+		if (leftover_frames > 0) {
+			for (uint32_t chn = 0; chn < channels; ++chn) {
+				TypeUtils<float>::move (&jobs[chn].in[used], &jobs[chn].in[0], leftover_frames);
+			}
+		}
+
+		input_frames = leftover_frames;
+
+		if (throw_level (ThrowProcess) && generated == 0 && used == 0 && leftover_frames) {
+			throw Exception (*this, boost::str (boost::format
+				("No output frames genereated with %1% leftover frames")
+				% leftover_frames));
+		}
+
+		/* at the end of input, keep going until the converters are drained */
+		if (end_of_input) {
+			more = generated > 0 || leftover_frames > 0;
+		} else {
+			more = generated > 0 && leftover_frames > 0;
+		}
+
+		if (generated > 0 || !more) {
+			ProcessContext<float> c_out (c, data_out, generated * channels);
+			if (more) {
+				c_out.remove_flag (ProcessContext<float>::EndOfInput);
+			}
+			output (c_out);
+		}
+
+	} while (more);
+}
+
+void
+SampleRateConverter::process_blocks (ProcessContext<float> const & c)
+{
+	bool const end_of_input = c.has_flag (ProcessContext<float>::EndOfInput);
+
+	TypeUtils<float>::copy (c.data(), &block_data[block_frames], c.frames());
+	block_frames += c.frames();
+
+	/* convert as soon as there is enough data for all jobs, plus the overlap
+	 * that follows the last block.
+	 */
+	framecnt_t const batch = jobs.size() * block_length;
+
+	while (block_position + block_frames - next_block >= batch + block_overlap) {
+		convert_blocks (c, false);
+	}
+
+	if (end_of_input) {
+		while (next_block < block_position + block_frames) {
+			convert_blocks (c, true);
+		}
+		output_blocks (c, data_out, 0, true);
+	}
+}
+
+void
+SampleRateConverter::convert_blocks (ProcessContext<float> const & c, bool end_of_input)
+{
+	framecnt_t const end = block_position + block_frames;
+	uint32_t count = 0;
+
+	for (framecnt_t start = next_block; count < jobs.size() && start < end; start += block_length, ++count) {
+		Job & job (jobs[count]);
+
+		/* no history before the very first block */
+		framecnt_t const overlap = std::min (block_overlap, start);
+		framecnt_t const length = std::min (block_length, end - start);
+		framecnt_t const lookahead = std::min (block_overlap, end - start - length);
+
+		job.data.data_in = &block_data[start - overlap - block_position];
+		job.data.input_frames = overlap + length + lookahead;
+		job.discard = overlap / ratio_in * ratio_out;
+
+		if (end_of_input && start + length == end) {
+			job.take = -1;
+		} else {
+			job.take = length / ratio_in * ratio_out;
+		}
+
+		next_block = start + length;
+	}
+
+	run_jobs (count);
+
+	for (uint32_t j = 0; j < count; ++j) {
+		Job & job (jobs[j]);
+		framecnt_t frames = std::max ((framecnt_t) 0, job.produced - job.discard);
+		if (job.take >= 0) {
+			frames = std::min (frames, job.take);
+		}
+		output_blocks (c, &job.out[job.discard], frames, false);
+	}
+
+	/* only keep what the next block needs */
+
+	framecnt_t const keep_from = std::max (block_position, next_block - block_overlap);
+
+	if (keep_from > block_position) {
+		block_frames -= keep_from - block_position;
+		TypeUtils<float>::move (&block_data[keep_from - block_position], &block_data[0], block_frames);
+		block_position = keep_from;
+	}
+}
+
+void
+SampleRateConverter::output_blocks (ProcessContext<float> const & c, float * data, framecnt_t frames, bool last)
+{
+	do {
+		framecnt_t const n = std::min (frames, data_out_size);
+		ProcessContext<float> c_out (c, data, n);
+		data += n;
+		frames -= n;
+
+		if (!last || frames > 0) {
+			c_out.remove_flag (ProcessContext<float>::EndOfInput);
+		}
+		output (c_out);
+	} while (frames > 0);
+}
+
+void
+SampleRateConverter::run_jobs (uint32_t count)
+{
+	Glib::Threads::Mutex::Lock lm (jobs_mutex);
+
+	g_atomic_int_set (&pending_jobs, count);
+
+	for (uint32_t j = 0; j < count; ++j) {
+		thread_pool->push (sigc::bind (sigc::mem_fun (*this, &SampleRateConverter::run_job), j));
+	}
+
+	while (g_atomic_int_get (&pending_jobs) != 0) {
+		jobs_cond.wait (jobs_mutex);
+	}
+
+	for (uint32_t j = 0; j < count; ++j) {
+		if (throw_level (ThrowProcess) && jobs[j].error) {
+			throw Exception (*this, str (format
+			("An error occurred during sample rate conversion: %1%")
+			% src_strerror (jobs[j].error)));
+		}
+	}
+}
+
+void
+SampleRateConverter::run_job (uint32_t j)
+{
+	Job & job (jobs[j]);
+
+	if (mode == BlockParallel) {
+		convert_block (job);
+	} else {
+		job.error = src_process (job.state, &job.data);
+	}
+
+	if (g_atomic_int_dec_and_test (&pending_jobs)) {
+		Glib::Threads::Mutex::Lock lm (jobs_mutex);
+		jobs_cond.signal ();
+	}
+}
+
+/* Convert one block from scratch, until the output frames that are needed have been generated */
+void
+SampleRateConverter::convert_block (Job & job)
+{
+	job.produced = 0;
+	job.error = src_reset (job.state);
+
+	SRC_DATA & data (job.data);
+	data.end_of_input = true;
+	data.src_ratio = src_data.src_ratio;
+
+	framecnt_t const needed = job.take < 0 ? job.out.size() : job.discard + job.take;
+
+	while (!job.error && job.produced < needed) {
+		data.data_out = &job.out[job.produced];
+		data.output_frames = job.out.size() - job.produced;
+
+		if ((job.error = src_process (job.state, &data)) != 0) {
+			break;
+		}
+
+		if (data.output_frames_gen == 0 && data.input_frames_used == 0) {
+			break;
+		}
+
+		job.produced += data.output_frames_gen;
+		data.data_in += data.input_frames_used;
+		data.input_frames -= data.input_frames_used;
+	}
+}
+
 void SampleRateConverter::set_end_of_input (ProcessContext<float> const & c)
 {
 	src_data.end_of_input = true;
@@ -229,12 +548,27 @@ void SampleRateConverter::reset ()
 
 	if (src_state) {
 		src_delete (src_state);
+		src_state = 0;
 	}
 
+	for (std::vector<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+		if (i->state) {
+			src_delete (i->state);
+		}
+	}
+	jobs.clear ();
+	mode = Serial;
+
+	block_data.clear ();
+	block_position = 0;
+	block_frames = 0;
+	next_block = 0;
+
 	leftover_frames = 0;
 	max_leftover_frames = 0;
 	if (leftover_data) {
 		free (leftover_data);
+		leftover_data = 0;
 	}
 
 	data_out_size = 0;
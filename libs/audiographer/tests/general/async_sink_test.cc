@@ -0,0 +1,109 @@
+#include "tests/utils.h"
+
+#include <glibmm/timer.h>
+
+#include "audiographer/general/async_sink.h"
+
+using namespace AudioGrapher;
+
+/// Sink that takes a while for each chunk, like an expensive encoder
+template<typename T>
+class SlowSink : public AppendingVectorSink<T>
+{
+  public:
+	void process (ProcessContext<T> const & c)
+	{
+		Glib::usleep (20000);
+		AppendingVectorSink<T>::process (c);
+	}
+	using Sink<T>::process;
+};
+
+class AsyncSinkTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE (AsyncSinkTest);
+  CPPUNIT_TEST (testProcess);
+  CPPUNIT_TEST (testSmallQueue);
+  CPPUNIT_TEST (testEndOfInput);
+  CPPUNIT_TEST (testExceptions);
+  CPPUNIT_TEST_SUITE_END ();
+
+  public:
+	void setUp()
+	{
+		frames = 2 * 32768;
+		random_data = TestUtils::init_random_data (frames, 1.0);
+
+		sink.reset (new AppendingVectorSink<float>());
+		grabber.reset (new ProcessContextGrabber<float>());
+	}
+
+	void tearDown()
+	{
+		delete [] random_data;
+	}
+
+	void testProcess()
+	{
+		AsyncSink<float> async (sink, 2, frames);
+		process (async, 1024);
+
+		CPPUNIT_ASSERT_EQUAL (frames, (framecnt_t) sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, sink->get_array(), frames));
+	}
+
+	void testSmallQueue()
+	{
+		// The queue holds at least two output chunks (2 * 8192 frames here),
+		// less than the data, so the producer has to wait for a slow output.
+		boost::shared_ptr<SlowSink<float> > slow_sink (new SlowSink<float>());
+		AsyncSink<float> async (slow_sink, 2, 128);
+		process (async, 4096);
+
+		CPPUNIT_ASSERT (async.stalls () > 0);
+		CPPUNIT_ASSERT_EQUAL (frames, (framecnt_t) slow_sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, slow_sink->get_array(), frames));
+	}
+
+	void testEndOfInput()
+	{
+		AsyncSink<float> async (grabber, 2, frames);
+		process (async, 1000);
+
+		framecnt_t frames_output = 0;
+		for (std::list<ProcessContext<float> >::iterator it = grabber->contexts.begin(); it != grabber->contexts.end(); ++it) {
+			std::list<ProcessContext<float> >::iterator next = it; ++next;
+			CPPUNIT_ASSERT_EQUAL (next == grabber->contexts.end(), it->has_flag (ProcessContext<float>::EndOfInput));
+			CPPUNIT_ASSERT_EQUAL ((ChannelCount) 2, it->channels());
+			frames_output += it->frames();
+		}
+		CPPUNIT_ASSERT_EQUAL (frames, frames_output);
+	}
+
+	void testExceptions()
+	{
+		boost::shared_ptr<ThrowingSink<float> > throwing_sink (new ThrowingSink<float>());
+		AsyncSink<float> async (throwing_sink, 2, 128);
+		CPPUNIT_ASSERT_THROW (process (async, 1024), Exception);
+	}
+
+  private:
+	void process (AsyncSink<float> & async, framecnt_t chunk)
+	{
+		for (framecnt_t pos = 0; pos < frames; pos += chunk) {
+			ProcessContext<float> c (&random_data[pos], std::min (chunk, frames - pos), 2);
+			if (pos + chunk >= frames) {
+				c.set_flag (ProcessContext<float>::EndOfInput);
+			}
+			async.process (c);
+		}
+	}
+
+	boost::shared_ptr<AppendingVectorSink<float> > sink;
+	boost::shared_ptr<ProcessContextGrabber<float> > grabber;
+
+	float * random_data;
+	framecnt_t frames;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (AsyncSinkTest);
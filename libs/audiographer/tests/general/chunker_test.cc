@@ -15,6 +15,7 @@ class ChunkerTest : public CppUnit::TestFixture
   CPPUNIT_TEST (testAsynchronousProcess);
   CPPUNIT_TEST (testChoppingProcess);
   CPPUNIT_TEST (testEndOfInputFlagHandling);
+  CPPUNIT_TEST (testBorrowsWholeChunks);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -167,6 +168,47 @@ class ChunkerTest : public CppUnit::TestFixture
 		CPPUNIT_ASSERT(it->has_flag(ProcessContext<>::EndOfInput));
 	}
 
+	void testBorrowsWholeChunks()
+	{
+		boost::shared_ptr<ProcessContextGrabber<float> > grabber(new ProcessContextGrabber<float>());
+		sink.reset (new AppendingVectorSink<float>());
+
+		assert (frames % 8 == 0);
+		chunker.reset (new Chunker<float>(frames / 4));
+		chunker->add_output (grabber);
+		chunker->add_output (sink);
+
+		// Nothing buffered, so both chunks are passed on without copying
+		ProcessContext<float> const context (random_data, frames / 2, 1);
+		chunker->process (context);
+
+		CPPUNIT_ASSERT_EQUAL((int)grabber->contexts.size(), 2);
+		ProcessContextGrabber<float>::ContextList::iterator it = grabber->contexts.begin();
+		CPPUNIT_ASSERT(it->data() == random_data);
+		++it;
+		CPPUNIT_ASSERT(it->data() == &random_data[frames / 4]);
+
+		// Once data is buffered, the chunks are copied
+		ProcessContext<float> const odd_context (random_data, frames / 8, 1);
+		chunker->process (odd_context);
+		chunker->process (context);
+
+		// The chunk that completes the buffered data is copied,
+		// the whole one after it is borrowed again
+		CPPUNIT_ASSERT_EQUAL((int)grabber->contexts.size(), 4);
+		it = grabber->contexts.begin();
+		std::advance (it, 2);
+		CPPUNIT_ASSERT(it->data() != random_data);
+		++it;
+		CPPUNIT_ASSERT(it->data() == &random_data[frames / 8]);
+
+		// The buffer is reused by then, so check the data as it arrived
+		CPPUNIT_ASSERT_EQUAL (frames, (framecnt_t) sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, sink->get_array(), frames / 2));
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, &sink->get_array()[frames / 2], frames / 8));
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, &sink->get_array()[5 * frames / 8], 3 * frames / 8));
+	}
+
   private:
 	boost::shared_ptr<Chunker<float> > chunker;
 	boost::shared_ptr<VectorSink<float> > sink;
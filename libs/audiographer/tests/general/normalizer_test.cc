@@ -9,6 +9,7 @@ class NormalizerTest : public CppUnit::TestFixture
 {
   CPPUNIT_TEST_SUITE (NormalizerTest);
   CPPUNIT_TEST (testConstAmplify);
+  CPPUNIT_TEST (testConstSilence);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -48,6 +49,25 @@ class NormalizerTest : public CppUnit::TestFixture
 		CPPUNIT_ASSERT (-FLT_EPSILON <= (peak - 1.0) && (peak - 1.0) <= 0.0);
 	}
 
+	void testConstSilence()
+	{
+		random_data = new float[frames];
+		memset (random_data, 0, frames * sizeof (float));
+
+		normalizer.reset (new Normalizer(0.0));
+		sink.reset (new VectorSink<float>());
+
+		normalizer->alloc_buffer (frames);
+		normalizer->set_peak (0.0);
+		normalizer->add_output (sink);
+
+		ConstProcessContext<float> c (random_data, frames, 1);
+		normalizer->process (c);
+
+		CPPUNIT_ASSERT_EQUAL (frames, (framecnt_t) sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, sink->get_array(), frames));
+	}
+
   private:
 	boost::shared_ptr<Normalizer> normalizer;
 	boost::shared_ptr<PeakReader> peak_reader;
@@ -1,6 +1,7 @@
 #include "tests/utils.h"
 
 #include "audiographer/general/sample_format_converter.h"
+#include "private/gdither/gdither.h"
 
 using namespace AudioGrapher;
 
@@ -15,6 +16,8 @@ class SampleFormatConverterTest : public CppUnit::TestFixture
   CPPUNIT_TEST (testInt16);
   CPPUNIT_TEST (testUint8);
   CPPUNIT_TEST (testChannelCount);
+  CPPUNIT_TEST (testKernelsMatchGDither);
+  CPPUNIT_TEST (testTriangularDither);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -204,6 +207,64 @@ class SampleFormatConverterTest : public CppUnit::TestFixture
 		CPPUNIT_ASSERT (TestUtils::array_filled(sink->get_array(), pc.frames()));
 	}
 
+	void testKernelsMatchGDither()
+	{
+		// Without dither, the interleaved kernels must produce exactly what gdither does
+		framecnt_t const n = frames - (frames % 3);
+		random_data[4] = -1.5;
+		random_data[5] = 1.5;
+
+		boost::shared_ptr<SampleFormatConverter<int16_t> > converter16 (new SampleFormatConverter<int16_t>(3));
+		boost::shared_ptr<VectorSink<int16_t> > sink16 (new VectorSink<int16_t>());
+		converter16->init (frames, D_None, 16);
+		converter16->add_output (sink16);
+		converter16->process (ProcessContext<float> (random_data, n, 3));
+
+		std::vector<int16_t> expected16 (n);
+		GDither dither = gdither_new (GDitherNone, 3, GDither16bit, 16);
+		for (uint32_t chn = 0; chn < 3; ++chn) {
+			gdither_runf (dither, chn, n / 3, random_data, &expected16[0]);
+		}
+		gdither_free (dither);
+
+		CPPUNIT_ASSERT_EQUAL (n, (framecnt_t) sink16->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (&expected16[0], sink16->get_array(), n));
+
+		boost::shared_ptr<SampleFormatConverter<int32_t> > converter24 (new SampleFormatConverter<int32_t>(3));
+		boost::shared_ptr<VectorSink<int32_t> > sink24 (new VectorSink<int32_t>());
+		converter24->init (frames, D_None, 24);
+		converter24->add_output (sink24);
+		converter24->process (ProcessContext<float> (random_data, n, 3));
+
+		std::vector<int32_t> expected24 (n);
+		dither = gdither_new (GDitherNone, 3, GDither32bit, 24);
+		for (uint32_t chn = 0; chn < 3; ++chn) {
+			gdither_runf (dither, chn, n / 3, random_data, &expected24[0]);
+		}
+		gdither_free (dither);
+
+		CPPUNIT_ASSERT_EQUAL (n, (framecnt_t) sink24->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (&expected24[0], sink24->get_array(), n));
+	}
+
+	void testTriangularDither()
+	{
+		// TPDF dither may not move a sample by more than one step
+		boost::shared_ptr<SampleFormatConverter<int16_t> > converter (new SampleFormatConverter<int16_t>(1));
+		boost::shared_ptr<VectorSink<int16_t> > sink (new VectorSink<int16_t>());
+
+		converter->init (frames, D_Tri, 16);
+		converter->add_output (sink);
+		converter->process (ProcessContext<float> (random_data, frames - 1, 1));
+
+		CPPUNIT_ASSERT_EQUAL (frames - 1, (framecnt_t) sink->get_data().size());
+
+		for (framecnt_t i = 0; i < frames - 1; ++i) {
+			float const ideal = random_data[i] * 32768.0f;
+			CPPUNIT_ASSERT (std::fabs (sink->get_data()[i] - ideal) < 1.5f);
+		}
+	}
+
   private:
 
 	float * random_data;
@@ -11,6 +11,8 @@ class SampleRateConverterTest : public CppUnit::TestFixture
   CPPUNIT_TEST (testUpsampleLength);
   CPPUNIT_TEST (testDownsampleLength);
   CPPUNIT_TEST (testRespectsEndOfInput);
+  CPPUNIT_TEST (testChannelParallel);
+  CPPUNIT_TEST (testBlockParallel);
   CPPUNIT_TEST_SUITE_END ();
 
   public:
@@ -116,8 +118,97 @@ class SampleRateConverterTest : public CppUnit::TestFixture
 		}
 	}
 
+	void testChannelParallel()
+	{
+		framecnt_t const stereo_frames = 2 * 8192;
+		float * stereo_data = TestUtils::init_random_data (stereo_frames);
+
+		convert (0, 2, stereo_data, stereo_frames, 44100, 48000);
+		std::vector<float> serial = sink->get_data();
+
+		Glib::ThreadPool thread_pool (2);
+		sink.reset (new AppendingVectorSink<float>());
+		convert (&thread_pool, 2, stereo_data, stereo_frames, 44100, 48000);
+
+		CPPUNIT_ASSERT_EQUAL (serial.size(), sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_filled (sink->get_array(), sink->get_data().size()));
+		for (size_t i = 0; i < serial.size(); ++i) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL (serial[i], sink->get_data()[i], 1e-6);
+		}
+
+		delete [] stereo_data;
+	}
+
+	void testBlockParallel()
+	{
+		/* long enough for several blocks */
+		framecnt_t const mono_frames = 300000;
+		float * mono_data = TestUtils::init_random_data (mono_frames);
+
+		convert (0, 1, mono_data, mono_frames, 88200, 44100);
+		std::vector<float> serial = sink->get_data();
+		framecnt_t const serial_frames = serial.size();
+
+		Glib::ThreadPool thread_pool (3);
+		sink.reset (new AppendingVectorSink<float>());
+		convert (&thread_pool, 1, mono_data, mono_frames, 88200, 44100);
+
+		std::vector<float> const & parallel = sink->get_data();
+		framecnt_t const parallel_frames = parallel.size();
+		framecnt_t tolerance = 3;
+		CPPUNIT_ASSERT (serial_frames - tolerance < parallel_frames && parallel_frames < serial_frames + tolerance);
+
+		/* blocks are 65536 input frames long (see SampleRateConverter::init),
+		 * the samples close to where they meet, and to the end, may differ a bit.
+		 */
+		framecnt_t const block_out = 65536 / 2;
+		framecnt_t const edge = 128;
+		framecnt_t const compared = std::min (serial_frames, parallel_frames) - edge;
+		framecnt_t checked = 0;
+
+		for (framecnt_t i = 0; i < compared; ++i) {
+			framecnt_t const in_block = i % block_out;
+			if ((i >= block_out && in_block < edge) || block_out - in_block <= edge) {
+				continue;
+			}
+			CPPUNIT_ASSERT_DOUBLES_EQUAL (serial[i], parallel[i], 1e-4);
+			++checked;
+		}
+
+		CPPUNIT_ASSERT (checked > compared / 2);
+
+		for (std::list<ProcessContext<float> >::iterator it = grabber->contexts.begin(); it != grabber->contexts.end(); ++it) {
+			std::list<ProcessContext<float> >::iterator next = it; ++next;
+			CPPUNIT_ASSERT_EQUAL (next == grabber->contexts.end(), it->has_flag (ProcessContext<float>::EndOfInput));
+		}
+
+		delete [] mono_data;
+	}
 
   private:
+	void convert (Glib::ThreadPool * thread_pool, uint32_t channels, float * data, framecnt_t frames, framecnt_t in_rate, framecnt_t out_rate)
+	{
+		framecnt_t const chunk = 1024 * channels;
+
+		converter.reset (new SampleRateConverter (channels));
+		if (thread_pool) {
+			converter->set_thread_pool (*thread_pool);
+		}
+		converter->init (in_rate, out_rate);
+		converter->allocate_buffers (chunk);
+		converter->add_output (sink);
+		grabber.reset (new ProcessContextGrabber<float>());
+		converter->add_output (grabber);
+
+		for (framecnt_t pos = 0; pos < frames; pos += chunk) {
+			ProcessContext<float> c (&data[pos], std::min (chunk, frames - pos), channels);
+			if (pos + chunk >= frames) {
+				c.set_flag (ProcessContext<float>::EndOfInput);
+			}
+			converter->process (c);
+		}
+	}
+
 	boost::shared_ptr<SampleRateConverter > converter;
 	boost::shared_ptr<AppendingVectorSink<float> > sink;
 	boost::shared_ptr<ProcessContextGrabber<float> > grabber;
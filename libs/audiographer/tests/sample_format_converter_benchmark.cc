@@ -0,0 +1,117 @@
+/* Compares the throughput of SampleFormatConverter with running gdither
+ * on each channel, which is what SampleFormatConverter used to do.
+ *
+ * usage: sfc-benchmark [channels] [seconds of audio at 48kHz]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "audiographer/general/sample_format_converter.h"
+#include "private/gdither/gdither.h"
+
+using namespace AudioGrapher;
+
+static framecnt_t const block = 8192;
+
+template<typename T>
+class NullSink : public Sink<T>
+{
+  public:
+	void process (ProcessContext<T> const &) {}
+	using Sink<T>::process;
+};
+
+static double
+seconds_since (clock_t start)
+{
+	return (clock () - start) / (double) CLOCKS_PER_SEC;
+}
+
+template<typename T>
+static double
+run_converter (std::vector<float> const & data, ChannelCount channels, DitherType type, int width)
+{
+	SampleFormatConverter<T> converter (channels);
+	converter.init (block, type, width);
+	converter.add_output (boost::shared_ptr<NullSink<T> > (new NullSink<T>));
+
+	framecnt_t const samples = block - (block % channels);
+	clock_t const start = clock ();
+
+	for (size_t pos = 0; pos + samples <= data.size(); pos += samples) {
+		ConstProcessContext<float> context (&data[pos], samples, channels);
+		converter.process (context);
+	}
+
+	return seconds_since (start);
+}
+
+template<typename T>
+static double
+run_gdither (std::vector<float> const & data, ChannelCount channels, DitherType type, GDitherSize size, int width)
+{
+	GDither dither = gdither_new ((GDitherType) type, channels, size, width);
+	std::vector<T> out (block);
+
+	framecnt_t const samples = block - (block % channels);
+	clock_t const start = clock ();
+
+	for (size_t pos = 0; pos + samples <= data.size(); pos += samples) {
+		for (uint32_t chn = 0; chn < channels; ++chn) {
+			gdither_runf (dither, chn, samples / channels, &data[pos], &out[0]);
+		}
+	}
+
+	double const elapsed = seconds_since (start);
+	gdither_free (dither);
+	return elapsed;
+}
+
+static void
+report (char const * name, size_t samples, double gdither, double converter)
+{
+	printf ("%-22s gdither: %8.1f Msamples/s  converter: %8.1f Msamples/s  (x%.2f)\n",
+	        name, samples / gdither / 1e6, samples / converter / 1e6, gdither / converter);
+}
+
+int
+main (int argc, char* argv[])
+{
+	ChannelCount const channels = argc > 1 ? atoi (argv[1]) : 2;
+	int const seconds = argc > 2 ? atoi (argv[2]) : 600;
+
+	if (channels < 1 || seconds < 1) {
+		fprintf (stderr, "usage: %s [channels] [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<float> data ((size_t) seconds * 48000 * channels);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (rand () / (float) RAND_MAX) * 2.f - 1.f;
+	}
+
+	printf ("%u channel(s), %d seconds at 48kHz\n", channels, seconds);
+
+	report ("16 bit, no dither", data.size(),
+	        run_gdither<int16_t> (data, channels, D_None, GDither16bit, 16),
+	        run_converter<int16_t> (data, channels, D_None, 16));
+	report ("16 bit, triangular", data.size(),
+	        run_gdither<int16_t> (data, channels, D_Tri, GDither16bit, 16),
+	        run_converter<int16_t> (data, channels, D_Tri, 16));
+	report ("16 bit, rectangular", data.size(),
+	        run_gdither<int16_t> (data, channels, D_Rect, GDither16bit, 16),
+	        run_converter<int16_t> (data, channels, D_Rect, 16));
+	report ("24 bit, no dither", data.size(),
+	        run_gdither<int32_t> (data, channels, D_None, GDither32bit, 24),
+	        run_converter<int32_t> (data, channels, D_None, 24));
+	report ("24 bit, triangular", data.size(),
+	        run_gdither<int32_t> (data, channels, D_Tri, GDither32bit, 24),
+	        run_converter<int32_t> (data, channels, D_Tri, 24));
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "tests/utils.h"
+#include "audiographer/sndfile/tmp_file.h"
+#include "audiographer/sndfile/sndfile_splicer.h"
+
+using namespace AudioGrapher;
+
+class SndfileSplicerTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE (SndfileSplicerTest);
+  CPPUNIT_TEST (testSplice);
+  CPPUNIT_TEST (testSpliceAtEnd);
+  CPPUNIT_TEST (testShortInput);
+  CPPUNIT_TEST_SUITE_END ();
+
+  public:
+	void setUp()
+	{
+		channels = 2;
+		frames = 20000;
+		random_data = TestUtils::init_random_data (frames * channels);
+
+		char filename_template[] = "splicer_test_XXXXXX";
+		file.reset (new TmpFile<float> (filename_template, SF_FORMAT_WAV | SF_FORMAT_FLOAT, channels, 44100));
+		path = filename_template;
+
+		ProcessContext<float> c (random_data, frames * channels, channels);
+		c.set_flag (ProcessContext<float>::EndOfInput);
+		file->process (c);
+
+		sink.reset (new AppendingVectorSink<float>());
+		grabber.reset (new ProcessContextGrabber<float>());
+	}
+
+	void tearDown()
+	{
+		file.reset ();
+		delete [] random_data;
+	}
+
+	void testSplice()
+	{
+		SndfileSplicer<float>::RangeList ranges;
+		ranges.push_back (std::make_pair (0, 1000));
+		ranges.push_back (std::make_pair (5000, 10000));
+		ranges.push_back (std::make_pair (15001, 2));
+
+		splice (ranges, 1024);
+
+		CPPUNIT_ASSERT_EQUAL (frames * channels, (framecnt_t) sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, sink->get_array(), frames * channels));
+
+		for (std::list<ProcessContext<float> >::iterator it = grabber->contexts.begin(); it != grabber->contexts.end(); ++it) {
+			std::list<ProcessContext<float> >::iterator next = it; ++next;
+			CPPUNIT_ASSERT_EQUAL (next == grabber->contexts.end(), it->has_flag (ProcessContext<float>::EndOfInput));
+		}
+	}
+
+	void testSpliceAtEnd()
+	{
+		SndfileSplicer<float>::RangeList ranges;
+		ranges.push_back (std::make_pair (frames - 3000, 3000));
+
+		splice (ranges, 999);
+
+		CPPUNIT_ASSERT_EQUAL (frames * channels, (framecnt_t) sink->get_data().size());
+		CPPUNIT_ASSERT (TestUtils::array_equals (random_data, sink->get_array(), frames * channels));
+	}
+
+	void testShortInput()
+	{
+		SndfileSplicer<float>::RangeList ranges;
+		ranges.push_back (std::make_pair (frames, 10));
+
+		// The input ends before the range, which should not happen
+		SndfileSplicer<float> splicer (path, ranges);
+		ProcessContext<float> c (random_data, (frames - 1) * channels, channels);
+		c.set_flag (ProcessContext<float>::EndOfInput);
+		CPPUNIT_ASSERT_THROW (splicer.process (c), Exception);
+	}
+
+  private:
+	/// Feeds the splicer everything outside of the ranges, in chunks of \a chunk frames
+	void splice (SndfileSplicer<float>::RangeList const & ranges, framecnt_t chunk)
+	{
+		std::vector<float> input;
+		SndfileSplicer<float>::RangeList::const_iterator r = ranges.begin();
+		for (framecnt_t pos = 0; pos < frames; ++pos) {
+			if (r != ranges.end() && pos >= r->first + r->second) {
+				++r;
+			}
+			if (r != ranges.end() && pos >= r->first) {
+				continue;
+			}
+			input.insert (input.end(), &random_data[pos * channels], &random_data[(pos + 1) * channels]);
+		}
+
+		SndfileSplicer<float> splicer (path, ranges);
+		splicer.add_output (sink);
+		splicer.add_output (grabber);
+
+		framecnt_t const input_frames = input.size() / channels;
+		for (framecnt_t pos = 0; pos < input_frames; pos += chunk) {
+			framecnt_t const n = std::min (chunk, input_frames - pos);
+			ProcessContext<float> c (&input[pos * channels], n * channels, channels);
+			if (pos + n == input_frames) {
+				c.set_flag (ProcessContext<float>::EndOfInput);
+			}
+			splicer.process (c);
+		}
+	}
+
+	boost::shared_ptr<TmpFile<float> > file;
+	std::string path;
+
+	boost::shared_ptr<AppendingVectorSink<float> > sink;
+	boost::shared_ptr<ProcessContextGrabber<float> > grabber;
+
+	float * random_data;
+	framecnt_t frames;
+	ChannelCount channels;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (SndfileSplicerTest);
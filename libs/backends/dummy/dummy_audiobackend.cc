@@ -1364,8 +1364,10 @@ DummyAudioBackend::main_process_thread ()
 				Glib::usleep (100); // don't hog cpu
 			}
 		} else {
+			/* freewheeling: nobody is listening, process the next
+			 * cycle right away (this is not a realtime thread)
+			 */
 			_dsp_load = 1.0f;
-			Glib::usleep (100); // don't hog cpu
 		}
 
 		/* beginning of next cycle */
@@ -0,0 +1,128 @@
+/* This file is part of Evoral.
+ * Copyright (C) 2008 David Robillard <http://drobilla.net>
+ * Copyright (C) 2000-2008 Paul Davis
+ *
+ * Evoral is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * Evoral is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef EVORAL_MAPPED_SMF_HPP
+#define EVORAL_MAPPED_SMF_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "evoral/visibility.h"
+#include "evoral/types.hpp"
+
+typedef struct _GMappedFile GMappedFile;
+
+namespace Evoral {
+
+/** Read-only, memory-mapped Standard MIDI File.
+ *
+ * Unlike SMF (which loads the whole file through libsmf, allocating one
+ * object per event), this only maps the file and scans the chunk headers
+ * once on open().  Events are decoded straight from the mapping as they
+ * are read, so opening a large file is cheap and costs no heap memory per
+ * event.  Several independent read positions (Cursor) can be used at once.
+ *
+ * Only tempo-based (PPQN) timing is supported.
+ */
+class LIBEVORAL_API MappedSMF {
+public:
+	/** A read position within one track of the file */
+	class LIBEVORAL_API Cursor {
+	public:
+		Cursor () : track (0), pos (0), end (0), time (0), status (0), mark_pos (0), mark_time (0), mark_status (0) {}
+
+		uint64_t time_ticks () const { return time; }
+
+		/** remember the current position, so that reset() can return to it */
+		void mark () { mark_pos = pos; mark_time = time; mark_status = status; }
+		void reset () { pos = mark_pos; time = mark_time; status = mark_status; }
+
+	private:
+		friend class MappedSMF;
+
+		uint16_t track;   ///< 1-based track number, 0 if not positioned
+		size_t   pos;     ///< offset of the next delta time in the file
+		size_t   end;     ///< offset of the end of the track chunk
+		uint64_t time;    ///< absolute time of the last event read, in ticks
+		uint8_t  status;  ///< running status
+
+		size_t   mark_pos;
+		uint64_t mark_time;
+		uint8_t  mark_status;
+
+		/** holds events that can not be returned as a pointer into the file
+		 *  (running status, sysex, normalized note-offs).
+		 */
+		std::vector<uint8_t> scratch;
+	};
+
+	MappedSMF ();
+	~MappedSMF ();
+
+	static bool test (const std::string& path);
+
+	int  open (const std::string& path);
+	void close ();
+
+	bool is_open () const { return _file != 0; }
+
+	uint16_t num_tracks () const { return _tracks.size(); }
+	uint16_t ppqn ()       const { return _ppqn; }
+
+	uint64_t duration_ticks () const;
+
+	int seek_to_track (Cursor& cursor, int track) const;
+	int seek_to_time (Cursor& cursor, uint64_t ticks) const;
+
+	int read_event (Cursor& cursor, uint32_t* delta_t, uint32_t* size, const uint8_t** buf, event_id_t* note_id) const;
+
+private:
+	/** read state before an event, stored every few events to speed up seeking */
+	struct Checkpoint {
+		Checkpoint (uint64_t t, size_t p, uint8_t s) : time (t), pos (p), status (s) {}
+		uint64_t time;
+		size_t   pos;
+		uint8_t  status;
+	};
+
+	struct Track {
+		Track (size_t b, size_t e) : begin (b), end (e), indexed (false), last_event_time (0) {}
+		size_t                  begin;
+		size_t                  end;
+
+		/* built on demand by build_index(), a cache that does not change the
+		 * contents of the file, so it may be built by const methods.
+		 */
+		mutable bool                    indexed;
+		mutable std::vector<Checkpoint> index;
+		mutable uint64_t                last_event_time; ///< time of the last non-meta event, in ticks
+	};
+
+	void build_index (Track const & track, uint16_t track_number) const;
+
+	GMappedFile*       _file;
+	const uint8_t*     _data;
+	size_t             _size;
+	uint16_t           _ppqn;
+	std::vector<Track> _tracks;
+};
+
+} // namespace Evoral
+
+#endif // EVORAL_MAPPED_SMF_HPP
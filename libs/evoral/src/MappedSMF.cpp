@@ -0,0 +1,470 @@
+/* This file is part of Evoral.
+ * Copyright (C) 2008 David Robillard <http://drobilla.net>
+ * Copyright (C) 2000-2008 Paul Davis
+ *
+ * Evoral is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * Evoral is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include <glib.h>
+
+#include "evoral/MappedSMF.hpp"
+#include "evoral/midi_util.h"
+
+using namespace std;
+
+namespace Evoral {
+
+/** number of events between two entries of a track's seek index */
+static const size_t checkpoint_interval = 128;
+
+static inline uint32_t
+read_be (const uint8_t* p, size_t n)
+{
+	uint32_t v = 0;
+	for (size_t i = 0; i < n; ++i) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+/** Decode a variable length quantity at @a pos, advancing @a pos past it.
+ * \return false if the quantity is malformed or runs past @a end.
+ */
+static inline bool
+read_vlq (const uint8_t* data, size_t& pos, size_t end, uint32_t& value)
+{
+	value = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (pos >= end) {
+			return false;
+		}
+		const uint8_t c = data[pos++];
+		value = (value << 7) | (c & 0x7f);
+		if (!(c & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+MappedSMF::MappedSMF ()
+	: _file (0)
+	, _data (0)
+	, _size (0)
+	, _ppqn (0)
+{
+}
+
+MappedSMF::~MappedSMF ()
+{
+	close ();
+}
+
+/** Attempt to map the SMF file just to see if it is valid.
+ *
+ * \return  true on success
+ *          false on failure
+ */
+bool
+MappedSMF::test (const std::string& path)
+{
+	MappedSMF smf;
+	return smf.open (path) == 0;
+}
+
+/** Map the file at @a path and locate its track chunks.
+ *
+ * \return  0 on success
+ *         -1 if the file can not be mapped or is not a valid SMF
+ */
+int
+MappedSMF::open (const std::string& path)
+{
+	close ();
+
+	GError* err = 0;
+
+	if ((_file = g_mapped_file_new (path.c_str(), false, &err)) == 0) {
+		if (err) {
+			g_error_free (err);
+		}
+		return -1;
+	}
+
+	_data = (const uint8_t*) g_mapped_file_get_contents (_file);
+	_size = g_mapped_file_get_length (_file);
+
+	if (_size < 14 || memcmp (_data, "MThd", 4)) {
+		close ();
+		return -1;
+	}
+
+	const uint32_t header_length = read_be (_data + 4, 4);
+	const uint16_t n_tracks      = read_be (_data + 10, 2);
+	const uint16_t division      = read_be (_data + 12, 2);
+
+	if (header_length < 6 || (division & 0x8000)) {
+		/* SMPTE timing is not supported */
+		close ();
+		return -1;
+	}
+
+	_ppqn = division;
+
+	/* walk the chunk headers, ignoring unknown chunk types */
+
+	size_t pos = 8 + header_length;
+
+	while (pos + 8 <= _size && _tracks.size() < n_tracks) {
+		const uint32_t chunk_length = read_be (_data + pos + 4, 4);
+		const size_t   begin        = pos + 8;
+		const size_t   end          = std::min (_size, begin + chunk_length);
+
+		if (!memcmp (_data + pos, "MTrk", 4)) {
+			_tracks.push_back (Track (begin, end));
+		}
+
+		pos = begin + chunk_length;
+	}
+
+	if (_tracks.empty()) {
+		close ();
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+MappedSMF::close ()
+{
+	if (_file) {
+		g_mapped_file_unref (_file);
+		_file = 0;
+	}
+
+	_data = 0;
+	_size = 0;
+	_ppqn = 0;
+	_tracks.clear ();
+}
+
+/** Position @a cursor at the start of the specified track (1-based indexing)
+ * \return 0 on success
+ */
+int
+MappedSMF::seek_to_track (Cursor& cursor, int track) const
+{
+	if (track < 1 || track > (int) _tracks.size()) {
+		cursor.track = 0;
+		return -1;
+	}
+
+	const Track& t (_tracks[track - 1]);
+
+	cursor.track  = track;
+	cursor.pos    = t.begin;
+	cursor.end    = t.end;
+	cursor.time   = 0;
+	cursor.status = 0;
+
+	return 0;
+}
+
+/** Position @a cursor (which must already be on a track) so that the next
+ * call to read_event() returns the first event at or after @a ticks.
+ *
+ * The first seek on a track scans it once to build a sparse index, later
+ * seeks only decode the events between the nearest index entry and the
+ * target.
+ *
+ * \return 0 on success, -1 if there are no events at or after @a ticks.
+ */
+int
+MappedSMF::seek_to_time (Cursor& cursor, uint64_t ticks) const
+{
+	if (cursor.track == 0) {
+		return -1;
+	}
+
+	Track const & t (_tracks[cursor.track - 1]);
+
+	if (!t.indexed) {
+		build_index (t, cursor.track);
+	}
+
+	/* find the last checkpoint before the target; index[0] is the start of the track */
+
+	std::vector<Checkpoint>::const_iterator i = t.index.begin();
+	for (size_t lo = 0, hi = t.index.size(); lo < hi; ) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (t.index[mid].time < ticks) {
+			i = t.index.begin() + mid;
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	cursor.pos    = i->pos;
+	cursor.time   = i->time;
+	cursor.status = i->status;
+
+	uint32_t       delta_t;
+	uint32_t       size;
+	const uint8_t* buf;
+	event_id_t     note_id;
+
+	while (true) {
+		cursor.mark ();
+
+		if (read_event (cursor, &delta_t, &size, &buf, &note_id) < 0) {
+			return -1;
+		}
+
+		if (cursor.time >= ticks) {
+			cursor.reset ();
+			return 0;
+		}
+	}
+}
+
+void
+MappedSMF::build_index (Track const & t, uint16_t track_number) const
+{
+	Cursor cursor;
+	seek_to_track (cursor, track_number);
+
+	t.index.clear ();
+	t.index.push_back (Checkpoint (0, cursor.pos, 0));
+	t.last_event_time = 0;
+
+	uint32_t       delta_t;
+	uint32_t       size;
+	const uint8_t* buf;
+	event_id_t     note_id;
+
+	for (size_t n = 1; ; ++n) {
+		if (n % checkpoint_interval == 0) {
+			t.index.push_back (Checkpoint (cursor.time, cursor.pos, cursor.status));
+		}
+		const int ret = read_event (cursor, &delta_t, &size, &buf, &note_id);
+		if (ret < 0) {
+			break;
+		} else if (ret > 0) {
+			t.last_event_time = cursor.time;
+		}
+	}
+
+	t.indexed = true;
+}
+
+/** \return the time of the last MIDI (non-meta) event of any track, in ticks.
+ *
+ * This scans every track that has not been indexed yet.
+ */
+uint64_t
+MappedSMF::duration_ticks () const
+{
+	uint64_t duration = 0;
+
+	for (size_t i = 0; i < _tracks.size(); ++i) {
+		if (!_tracks[i].indexed) {
+			build_index (_tracks[i], i + 1);
+		}
+		duration = std::max (duration, _tracks[i].last_event_time);
+	}
+
+	return duration;
+}
+
+/** Read the next event of the track that @a cursor is positioned on.
+ *
+ * Behaves like SMF::read_event(), except that no copy of the event is
+ * made unless required: on return @a buf points either into the mapped
+ * file or into the cursor's scratch space, and stays valid until the next
+ * call with the same cursor.
+ *
+ * \return event length (including status byte) on success, 0 if event was
+ * a meta event (or an unusable event that was skipped), or -1 on end of track.
+ */
+int
+MappedSMF::read_event (Cursor& c, uint32_t* delta_t, uint32_t* size, const uint8_t** buf, event_id_t* note_id) const
+{
+	assert (delta_t);
+	assert (size);
+	assert (buf);
+	assert (note_id);
+
+	*note_id = -1;
+
+	if (c.track == 0 || c.pos >= c.end) {
+		return -1;
+	}
+
+	if (!read_vlq (_data, c.pos, c.end, *delta_t) || c.pos >= c.end) {
+		c.pos = c.end;
+		return -1;
+	}
+
+	c.time += *delta_t;
+
+	const uint8_t first = _data[c.pos];
+	uint32_t      length;
+
+	switch (first) {
+	case 0xff: /* meta-event */
+	{
+		if (c.pos + 2 > c.end) {
+			c.pos = c.end;
+			return -1;
+		}
+
+		const uint8_t type = _data[c.pos + 1];
+		c.pos += 2;
+
+		if (!read_vlq (_data, c.pos, c.end, length) || c.pos + length > c.end) {
+			c.pos = c.end;
+			return -1;
+		}
+
+		if (type == 0x7f && length >= 3 && _data[c.pos] == 0x99 && _data[c.pos + 1] == 0x1) {
+			/* sequencer specific, Evoral Note ID */
+			size_t   idpos = c.pos + 2;
+			uint32_t id;
+			if (read_vlq (_data, idpos, c.pos + length, id)) {
+				*note_id = id;
+			}
+		}
+
+		c.pos += length;
+		c.status = 0;
+
+		if (type == 0x2f) {
+			/* end of track */
+			c.pos = c.end;
+		}
+
+		return 0;
+	}
+
+	case 0xf0: /* sysex */
+	{
+		++c.pos;
+
+		if (!read_vlq (_data, c.pos, c.end, length) || c.pos + length > c.end) {
+			c.pos = c.end;
+			return -1;
+		}
+
+		c.scratch.resize (length + 1);
+		c.scratch[0] = 0xf0;
+		memcpy (&c.scratch[1], _data + c.pos, length);
+
+		c.pos += length;
+		c.status = 0;
+
+		if (!midi_event_is_valid (&c.scratch[0], length + 1)) {
+			cerr << "WARNING: SMF ignoring illegal MIDI event" << endl;
+			return 0;
+		}
+
+		*buf  = &c.scratch[0];
+		*size = length + 1;
+		return *size;
+	}
+
+	case 0xf7: /* escaped event, raw MIDI bytes */
+	{
+		++c.pos;
+
+		if (!read_vlq (_data, c.pos, c.end, length) || c.pos + length > c.end) {
+			c.pos = c.end;
+			return -1;
+		}
+
+		const size_t ev_pos = c.pos;
+		c.pos += length;
+		c.status = 0;
+
+		if (length == 0 || !midi_event_is_valid (_data + ev_pos, length)) {
+			return 0;
+		}
+
+		*buf  = _data + ev_pos;
+		*size = length;
+		return *size;
+	}
+
+	default:
+		break;
+	}
+
+	/* channel message, possibly using running status */
+
+	const bool running = !(first & 0x80);
+
+	if (running) {
+		if (!c.status) {
+			cerr << "WARNING: SMF event without status byte" << endl;
+			c.pos = c.end;
+			return -1;
+		}
+	} else {
+		c.status = first;
+		++c.pos;
+	}
+
+	const int ev_size = midi_event_size (c.status);
+
+	if (ev_size < 1 || c.pos + ev_size - 1 > c.end) {
+		c.pos = c.end;
+		return -1;
+	}
+
+	const uint8_t* ev_data = _data + c.pos;
+	c.pos += ev_size - 1;
+
+	const bool note_on_zero_velocity = ((c.status & 0xf0) == 0x90 && ev_data[1] == 0);
+
+	if (running || note_on_zero_velocity) {
+		c.scratch.resize (ev_size);
+		c.scratch[0] = c.status;
+		memcpy (&c.scratch[1], ev_data, ev_size - 1);
+		if (note_on_zero_velocity) {
+			/* normalize note on with velocity 0 to proper note off */
+			c.scratch[0] = 0x80 | (c.status & 0x0f);  /* note off */
+			c.scratch[2] = 0x40;  /* default velocity */
+		}
+		*buf = &c.scratch[0];
+	} else {
+		*buf = ev_data - 1;
+	}
+
+	*size = ev_size;
+
+	if (!midi_event_is_valid (*buf, *size)) {
+		cerr << "WARNING: SMF ignoring illegal MIDI event" << endl;
+		return 0;
+	}
+
+	return ev_size;
+}
+
+} // namespace Evoral
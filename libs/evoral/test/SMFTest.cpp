@@ -1,5 +1,7 @@
 #include "SMFTest.hpp"
 
+#include <cstring>
+
 #include <glibmm/fileutils.h>
 #include <glibmm/miscutils.h>
 
@@ -68,3 +70,57 @@ SMFTest::takeFiveTest ()
 	                Evoral::Beats::ticks_at_rate(time, smf.ppqn()));
 	CPPUNIT_ASSERT(!seq->empty());
 }
+
+void
+SMFTest::mappedReaderTest ()
+{
+	TestSMF smf;
+	MappedSMF mapped;
+	string testdata_path;
+	CPPUNIT_ASSERT (find_file (test_search_path (), "TakeFive.mid", testdata_path));
+	CPPUNIT_ASSERT (smf.open(testdata_path) == 0);
+	CPPUNIT_ASSERT (mapped.open(testdata_path) == 0);
+
+	CPPUNIT_ASSERT_EQUAL (smf.num_tracks(), mapped.num_tracks());
+	CPPUNIT_ASSERT_EQUAL (smf.ppqn(), mapped.ppqn());
+
+	/* both readers must produce the same events */
+
+	MappedSMF::Cursor cursor;
+	CPPUNIT_ASSERT (mapped.seek_to_track (cursor, 1) == 0);
+	smf.seek_to_start();
+
+	uint32_t       delta_t = 0;
+	uint32_t       size    = 0;
+	uint8_t*       buf     = NULL;
+	uint32_t       m_delta_t = 0;
+	uint32_t       m_size    = 0;
+	const uint8_t* m_buf     = NULL;
+	event_id_t     m_id;
+	uint64_t       time    = 0;
+	int            n_events = 0;
+	int ret;
+
+	while ((ret = smf.read_event(&delta_t, &size, &buf)) >= 0) {
+		const int m_ret = mapped.read_event (cursor, &m_delta_t, &m_size, &m_buf, &m_id);
+		time += delta_t;
+		CPPUNIT_ASSERT_EQUAL (ret, m_ret);
+		CPPUNIT_ASSERT_EQUAL (time, cursor.time_ticks());
+		if (ret > 0) {
+			CPPUNIT_ASSERT_EQUAL (size, m_size);
+			CPPUNIT_ASSERT (memcmp (buf, m_buf, size) == 0);
+			++n_events;
+		}
+	}
+
+	CPPUNIT_ASSERT (n_events > 0);
+	CPPUNIT_ASSERT (mapped.read_event (cursor, &m_delta_t, &m_size, &m_buf, &m_id) < 0);
+
+	/* seeking lands on the first event at or after the target */
+
+	const uint64_t target = time / 2;
+	CPPUNIT_ASSERT (mapped.seek_to_time (cursor, target) == 0);
+	CPPUNIT_ASSERT (mapped.read_event (cursor, &m_delta_t, &m_size, &m_buf, &m_id) >= 0);
+	CPPUNIT_ASSERT (cursor.time_ticks() >= target);
+	CPPUNIT_ASSERT (cursor.time_ticks() - m_delta_t < target);
+}
@@ -23,6 +23,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include "evoral/types.hpp"
 #include "evoral/SMF.hpp"
+#include "evoral/MappedSMF.hpp"
 #include "SequenceTest.hpp"
 
 using namespace Evoral;
@@ -54,6 +55,7 @@ class SMFTest : public CppUnit::TestFixture
 	CPPUNIT_TEST_SUITE(SMFTest);
 	CPPUNIT_TEST(createNewFileTest);
 	CPPUNIT_TEST(takeFiveTest);
+	CPPUNIT_TEST(mappedReaderTest);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -73,6 +75,7 @@ public:
 
 	void createNewFileTest();
 	void takeFiveTest();
+	void mappedReaderTest();
 
 private:
 	DummyTypeMap*     type_map;
@@ -75,8 +75,28 @@ DummyReceiver dummy_receiver;
 
 int main (int argc, char **argv) {
 	char *dllpath = NULL;
-	if (argc == 3 && !strcmp("-f", argv[1])) {
-		dllpath = argv[2];
+	bool force = false;
+	int arg = 1;
+
+	for (; arg < argc - 1; ++arg) {
+		if (!strcmp("-f", argv[arg])) {
+			force = true;
+		} else if (!strcmp("-n", argv[arg])) {
+			/* the caller blacklists plugins that fail */
+			vstfx_blacklist_while_scanning = false;
+		} else {
+			break;
+		}
+	}
+
+	if (arg != argc - 1) {
+		fprintf(stderr, "usage: %s [-f] [-n] <vst>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	dllpath = argv[arg];
+
+	if (force) {
 		const size_t slen = strlen (dllpath);
 		if (
 				(slen > 3 && 0 == g_ascii_strcasecmp (&dllpath[slen-3], ".so"))
@@ -84,15 +104,10 @@ int main (int argc, char **argv) {
 				(slen > 4 && 0 == g_ascii_strcasecmp (&dllpath[slen-4], ".dll"))
 		   ) {
 			vstfx_remove_infofile(dllpath);
-			vstfx_un_blacklist(dllpath);
+			if (vstfx_blacklist_while_scanning) {
+				vstfx_un_blacklist(dllpath);
+			}
 		}
-
-	}
-	else if (argc != 2) {
-		fprintf(stderr, "usage: %s [-f] <vst>\n", argv[0]);
-		return EXIT_FAILURE;
-	} else {
-		dllpath = argv[1];
 	}
 
 	PBD::init();
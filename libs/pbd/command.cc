@@ -26,3 +26,33 @@ XMLNode &Command::get_state()
 	node->add_content("WARNING: Somebody forgot to subclass Command.");
 	return *node;
 }
+
+size_t
+Command::memory_size () const
+{
+	/* most commands hold a few changed properties */
+	return 1024;
+}
+
+/** @return a rough estimate of the memory held by @a node, if any */
+size_t
+Command::memory_size (XMLNode const * node)
+{
+	if (!node) {
+		return 0;
+	}
+
+	size_t size = sizeof (XMLNode) + node->name().size() + node->content().size();
+
+	XMLPropertyList const & props (node->properties());
+	for (XMLPropertyConstIterator p = props.begin(); p != props.end(); ++p) {
+		size += sizeof (XMLProperty) + (*p)->value().size();
+	}
+
+	XMLNodeList const & children (node->children());
+	for (XMLNodeConstIterator c = children.begin(); c != children.end(); ++c) {
+		size += memory_size (*c);
+	}
+
+	return size;
+}
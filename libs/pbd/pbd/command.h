@@ -49,10 +49,15 @@ public:
 		return false;
 	}
 
+	/** @return a rough estimate of the memory that this command holds */
+	virtual size_t memory_size () const;
+
 protected:
 	Command() {}
 	Command(const std::string& name) : _name(name) {}
 
+	static size_t memory_size (XMLNode const *);
+
 	std::string _name;
 };
 
@@ -166,6 +166,10 @@ public:
 		return *node;
 	}
 
+	size_t memory_size () const {
+		return Command::memory_size () + Command::memory_size (before) + Command::memory_size (after);
+	}
+
 protected:
 	MementoCommandBinder<obj_T>* _binder;
 	XMLNode* before;
@@ -22,6 +22,9 @@
 
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <sigc++/sigc++.h>
 
@@ -47,6 +50,14 @@ class LIBPBD_API Transmitter : public std::stringstream
 
 	bool does_not_return ();
 
+	/** @return the stream that the calling thread should write a
+	 *  message for this transmitter to; this is the transmitter itself
+	 *  unless the thread has a Capture.
+	 */
+	std::ostream& stream ();
+
+	class Capture;
+
   protected:
 	virtual void deliver ();
 	friend std::ostream& endmsg (std::ostream &);
@@ -61,6 +72,62 @@ class LIBPBD_API Transmitter : public std::stringstream
 	sigc::signal<void, Channel, const char *> fatal;
 };
 
+/** While an object of this class exists, messages that the thread which
+ *  created it writes to PBD::info, PBD::warning or PBD::error are kept
+ *  instead of being sent. This lets a helper thread hand its messages to
+ *  another thread, which can report them in a sensible order. Fatal
+ *  errors are always sent at once.
+ */
+class LIBPBD_API Transmitter::Capture
+{
+  public:
+	typedef std::vector<std::pair<Channel, std::string> > Messages;
+
+	Capture ();
+	~Capture ();
+
+	Messages const & messages () const { return _messages; }
+
+	/** Send messages kept by a Capture, from the calling thread */
+	static void send (Messages const &);
+
+  private:
+	friend class Transmitter;
+
+	Messages     _messages;
+	Transmitter* _info;
+	Transmitter* _warning;
+	Transmitter* _error;
+	Capture*     _previous;
+
+	Capture (Capture const &);
+	Capture& operator= (Capture const &);
+};
+
+/* messages start with a string (or are just endmsg), so route those
+   through Transmitter::stream() so that a thread with a Capture does not
+   write to a transmitter shared with other threads. These only match
+   exactly so that they do not hide anyone else's operator<<.
+*/
+
+template<typename C, typename T, typename A> inline std::ostream &
+operator<< (Transmitter& t, std::basic_string<C,T,A> const & s)
+{
+	return t.stream () << s;
+}
+
+template<typename C> inline std::ostream &
+operator<< (Transmitter& t, C const * s)
+{
+	return t.stream () << s;
+}
+
+inline std::ostream &
+operator<< (Transmitter& t, std::ostream& (&manipulator)(std::ostream&))
+{
+	return t.stream () << manipulator;
+}
+
 /* for EGCS 2.91.66, if this function is not compiled within the same
    compilation unit as the one where a ThrownError is thrown, then
    nothing will catch the error. This is a pretty small function, so
@@ -25,6 +25,7 @@
 #include <map>
 #include <sigc++/slot.h>
 #include <sigc++/bind.h>
+#include <boost/function.hpp>
 #ifndef  COMPILER_MSVC
 #include <sys/time.h>
 #else
@@ -47,6 +48,7 @@ class LIBPBD_API UndoTransaction : public Command
 	void clear ();
 	bool empty() const;
 	bool clearing () const { return _clearing; }
+	size_t n_commands () const { return actions.size(); }
 
 	void add_command (Command* const);
 	void remove_command (Command* const);
@@ -56,6 +58,7 @@ class LIBPBD_API UndoTransaction : public Command
 	void redo();
 
 	XMLNode &get_state();
+	size_t memory_size () const;
 
 	void set_timestamp (struct timeval &t) {
 		_timestamp = t;
@@ -108,6 +111,30 @@ class LIBPBD_API UndoHistory : public PBD::ScopedConnectionList
 
 	void set_depth (uint32_t);
 
+	/** Called to rebuild a transaction from the state returned by its
+	 *  get_state(); may return 0 if that is no longer possible.
+	 */
+	typedef boost::function<UndoTransaction* (XMLNode const &)> TransactionLoader;
+
+	/** Called the first time a transaction is spilled, to get (and
+	 *  create) the directory to spill to.
+	 */
+	typedef boost::function<std::string ()> SpillDirectory;
+
+	/* Limit the (estimated) memory used by the undo list to @a bytes,
+	   0 meaning no limit.  Once the limit is exceeded the oldest
+	   transactions are written to files in the spill directory and
+	   rebuilt with the loader when they are undone, unless an object
+	   that one of their commands refers to has gone. Without a spill
+	   directory they are discarded instead, as with set_depth().
+	*/
+
+	void set_memory_budget (size_t bytes);
+	void set_spill_directory (SpillDirectory, TransactionLoader);
+
+	size_t memory_used () const { return _memory_used; }
+	unsigned long spilled_depth () const { return _spilled; }
+
 	PBD::Signal0<void> Changed;
 	PBD::Signal0<void> BeginUndoRedo;
 	PBD::Signal0<void> EndUndoRedo;
@@ -118,7 +145,19 @@ class LIBPBD_API UndoHistory : public PBD::ScopedConnectionList
 	std::list<UndoTransaction*> UndoList;
 	std::list<UndoTransaction*> RedoList;
 
+	size_t _memory_budget;
+	size_t _memory_used;
+	std::map<UndoTransaction*, size_t> _sizes;
+	unsigned long _spilled; ///< number of spilled transactions at the front of UndoList
+	uint32_t _spill_counter;
+	std::string _spill_directory;
+	SpillDirectory _get_spill_directory;
+	TransactionLoader _loader;
+
 	void remove (UndoTransaction*);
+	void track (UndoTransaction*, size_t size);
+	void enforce_memory_budget ();
+	UndoTransaction* reload (UndoTransaction*);
 };
 
 
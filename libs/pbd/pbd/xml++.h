@@ -42,6 +42,7 @@
 class XMLTree;
 class XMLNode;
 class XMLProperty;
+class XMLTreeReader;
 
 typedef std::vector<XMLNode *>                   XMLNodeList;
 typedef std::vector<boost::shared_ptr<XMLNode> > XMLSharedNodeList;
@@ -86,10 +87,11 @@ public:
 private:
 	bool read_internal(bool validate);
 
-	std::string _filename;
-	XMLNode*    _root;
-	xmlDocPtr   _doc;
-	int         _compression;
+	std::string       _filename;
+	XMLNode*          _root;
+	/** libxml2 document for find(), only created when first needed */
+	mutable xmlDocPtr _doc;
+	int               _compression;
 };
 
 class LIBPBD_API XMLNode {
@@ -141,12 +143,13 @@ public:
 	void dump (std::ostream &, std::string p = "") const;
 
 private:
+	friend class XMLTreeReader;
+
 	std::string         _name;
 	bool                _is_content;
 	std::string         _content;
 	XMLNodeList         _children;
 	XMLPropertyList     _proplist;
-	XMLPropertyMap      _propmap;
 	mutable XMLNodeList _selected_children;
 
 	void clear_lists ();
@@ -157,13 +160,23 @@ public:
 	XMLProperty(const std::string& n, const std::string& v = std::string());
 	~XMLProperty();
 
-	const std::string& name() const { return _name; }
+	const std::string& name() const { return *_name; }
 	const std::string& value() const { return _value; }
 	const std::string& set_value(const std::string& v) { return _value = v; }
 
+	static const std::string& intern_name (const std::string&);
+
 private:
-	std::string _name;
-	std::string _value;
+	friend class XMLNode;
+	friend class XMLTreeReader;
+
+	XMLProperty(const std::string* interned_name, const std::string& v);
+
+	/** Names are interned (and normalized) once per process, since the
+	 *  same few hundred of them are used by millions of properties.
+	 */
+	const std::string* _name;
+	std::string        _value;
 };
 
 class LIBPBD_API XMLException: public std::exception {
@@ -0,0 +1,178 @@
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+#include "pbd/undo.h"
+#include "pbd/xml++.h"
+#include "pbd/convert.h"
+
+#include "undo_test.h"
+#include "test_common.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (UndoTest);
+
+using namespace std;
+
+static int value = 0;
+
+/** Sets `value', and claims a fixed size */
+class SetValueCommand : public Command
+{
+public:
+	SetValueCommand (int before, int after)
+		: _before (before)
+		, _after (after)
+	{}
+
+	~SetValueCommand () { drop_references (); }
+
+	void operator() () { value = _after; }
+	void undo () { value = _before; }
+
+	XMLNode& get_state () {
+		XMLNode* node = new XMLNode ("SetValueCommand");
+		node->add_property ("before", PBD::to_string (_before, std::dec));
+		node->add_property ("after", PBD::to_string (_after, std::dec));
+		return *node;
+	}
+
+	size_t memory_size () const { return 1000; }
+
+private:
+	int _before;
+	int _after;
+};
+
+static UndoTransaction*
+set_value (int before, int after)
+{
+	UndoTransaction* ut = new UndoTransaction;
+	ut->set_name (PBD::to_string (after, std::dec));
+	ut->add_command (new SetValueCommand (before, after));
+	return ut;
+}
+
+/** the last command of the transaction that sets `value' to this has lost its object */
+static int gone = -1;
+
+static UndoTransaction*
+load_transaction (XMLNode const & node)
+{
+	UndoTransaction* ut = new UndoTransaction;
+	ut->set_name (node.property ("name")->value());
+
+	XMLNodeList const & children (node.children ());
+
+	for (XMLNodeConstIterator c = children.begin(); c != children.end(); ++c) {
+		const int after = PBD::atoi ((*c)->property ("after")->value());
+		if (after == gone && *c == children.back()) {
+			continue;
+		}
+		ut->add_command (new SetValueCommand (PBD::atoi ((*c)->property ("before")->value()), after));
+	}
+
+	return ut;
+}
+
+static string spill_dir;
+
+static string
+spill_directory ()
+{
+	if (spill_dir.empty()) {
+		spill_dir = test_output_directory ("undo_spill");
+	}
+	return spill_dir;
+}
+
+void
+UndoTest::testMemoryBudget ()
+{
+	UndoHistory history;
+
+	history.set_memory_budget (10000);
+
+	for (int i = 1; i <= 100; ++i) {
+		value = i;
+		history.add (set_value (i - 1, i));
+	}
+
+	/* without a spill directory, old transactions are dropped */
+	CPPUNIT_ASSERT (history.memory_used () <= 10000);
+	CPPUNIT_ASSERT (history.undo_depth () < 100);
+	CPPUNIT_ASSERT (history.undo_depth () > 1);
+	CPPUNIT_ASSERT_EQUAL (0UL, history.spilled_depth ());
+
+	history.clear ();
+	CPPUNIT_ASSERT_EQUAL (size_t (0), history.memory_used ());
+}
+
+void
+UndoTest::testSpill ()
+{
+	UndoHistory history;
+
+	spill_dir.clear ();
+	history.set_spill_directory (&spill_directory, &load_transaction);
+	history.set_memory_budget (10000);
+
+	/* the directory is only created when it is needed */
+	CPPUNIT_ASSERT (spill_dir.empty());
+
+	for (int i = 1; i <= 100; ++i) {
+		value = i;
+		history.add (set_value (i - 1, i));
+	}
+
+	CPPUNIT_ASSERT (history.memory_used () <= 10000);
+	CPPUNIT_ASSERT_EQUAL (100UL, history.undo_depth ());
+	CPPUNIT_ASSERT (history.spilled_depth () > 0);
+
+	/* spilled transactions still appear in the saved history */
+	XMLNode& state (history.get_state (-1));
+	CPPUNIT_ASSERT_EQUAL (size_t (100), state.children().size());
+	CPPUNIT_ASSERT_EQUAL (string ("1"), state.children().front()->property ("name")->value());
+	delete &state;
+
+	/* and can be undone all the way back */
+	history.undo (100);
+	CPPUNIT_ASSERT_EQUAL (0, value);
+	CPPUNIT_ASSERT_EQUAL (0UL, history.spilled_depth ());
+	CPPUNIT_ASSERT_EQUAL (100UL, history.redo_depth ());
+
+	history.redo (100);
+	CPPUNIT_ASSERT_EQUAL (100, value);
+
+	history.clear ();
+	Glib::Dir dir (spill_dir);
+	CPPUNIT_ASSERT (dir.begin() == dir.end());
+}
+
+void
+UndoTest::testReloadIsAllOrNothing ()
+{
+	UndoHistory history;
+
+	spill_dir.clear ();
+	history.set_spill_directory (&spill_directory, &load_transaction);
+	history.set_memory_budget (1);
+
+	for (int i = 1; i <= 10; ++i) {
+		value = i;
+		UndoTransaction* ut = set_value (i - 1, i);
+		ut->add_command (new SetValueCommand (i - 1, i));
+		history.add (ut);
+	}
+
+	CPPUNIT_ASSERT_EQUAL (9UL, history.spilled_depth ());
+
+	/* the step to 5 cannot be undone completely, so it is not undone at all */
+	gone = 5;
+	history.undo (6);
+	gone = -1;
+
+	CPPUNIT_ASSERT_EQUAL (5, value);
+	CPPUNIT_ASSERT_EQUAL (5UL, history.redo_depth ());
+	CPPUNIT_ASSERT_EQUAL (4UL, history.undo_depth ());
+
+	history.clear ();
+}
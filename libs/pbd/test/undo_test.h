@@ -0,0 +1,16 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class UndoTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (UndoTest);
+	CPPUNIT_TEST (testMemoryBudget);
+	CPPUNIT_TEST (testSpill);
+	CPPUNIT_TEST (testReloadIsAllOrNothing);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void testMemoryBudget ();
+	void testSpill ();
+	void testReloadIsAllOrNothing ();
+};
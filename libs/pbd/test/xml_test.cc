@@ -17,6 +17,7 @@
 #include <libxml/xpath.h>
 
 #include "pbd/file_utils.h"
+#include "pbd/xml++.h"
 
 #include "test_common.h"
 
@@ -77,3 +78,91 @@ XMLTest::testXMLFilenameEncoding ()
 		CPPUNIT_ASSERT (write_xml (output_path));
 	}
 }
+
+void
+XMLTest::testReadBuffer ()
+{
+	XMLTree tree;
+
+	CPPUNIT_ASSERT (!tree.read_buffer ("<Session><Routes></Session>"));
+	CPPUNIT_ASSERT (tree.root() == 0);
+
+	CPPUNIT_ASSERT (tree.read_buffer (
+		"<?xml version=\"1.0\"?>\n"
+		"<Session version=\"3001\" sample_rate=\"48000\">\n"
+		"  <!-- a comment -->\n"
+		"  <Routes>\n"
+		"    <Route name=\"Audio &amp; &lt;1&gt;\" id=\"12\"/>\n"
+		"    <Route name=\"Audio 2\" id=\"13\"/>\n"
+		"  </Routes>\n"
+		"  <events>0 1\n64 0.5\n</events>\n"
+		"  <Blank> </Blank>\n"
+		"</Session>\n"));
+
+	XMLNode* root = tree.root();
+	CPPUNIT_ASSERT (root);
+	CPPUNIT_ASSERT_EQUAL (string ("Session"), root->name());
+
+	/* property names are normalized, and the same name is shared by all nodes */
+	CPPUNIT_ASSERT (root->property ("sample-rate"));
+	CPPUNIT_ASSERT_EQUAL (string ("48000"), root->property ("sample-rate")->value());
+	CPPUNIT_ASSERT (root->property ("sample_rate") == 0);
+
+	/* blanks between elements are dropped */
+	XMLNodeList const & children (root->children());
+	CPPUNIT_ASSERT_EQUAL (size_t (4), children.size());
+	CPPUNIT_ASSERT_EQUAL (string ("comment"), children[0]->name());
+	CPPUNIT_ASSERT_EQUAL (string (" a comment "), children[0]->content());
+
+	XMLNodeList const & routes (root->child ("Routes")->children());
+	CPPUNIT_ASSERT_EQUAL (size_t (2), routes.size());
+	CPPUNIT_ASSERT_EQUAL (string ("Audio & <1>"), routes[0]->property ("name")->value());
+	CPPUNIT_ASSERT_EQUAL (string ("13"), routes[1]->property ("id")->value());
+	CPPUNIT_ASSERT (&routes[0]->property ("id")->name() == &routes[1]->property ("id")->name());
+
+	XMLNode* events = root->child ("events");
+	CPPUNIT_ASSERT_EQUAL (size_t (1), events->children().size());
+	CPPUNIT_ASSERT (events->children().front()->is_content());
+	CPPUNIT_ASSERT_EQUAL (string ("0 1\n64 0.5\n"), events->children().front()->content());
+
+	/* ... unless they are all there is */
+	XMLNode* blank = root->child ("Blank");
+	CPPUNIT_ASSERT_EQUAL (size_t (1), blank->children().size());
+	CPPUNIT_ASSERT_EQUAL (string (" "), blank->children().front()->content());
+
+	/* XPath queries still work without a libxml2 document from the parser */
+	boost::shared_ptr<XMLSharedNodeList> found = tree.find ("//Route[@id='13']");
+	CPPUNIT_ASSERT_EQUAL (size_t (1), found->size());
+	CPPUNIT_ASSERT_EQUAL (string ("Audio 2"), found->front()->property ("name")->value());
+
+	/* copies share names, and property lookup/removal work on them */
+	XMLNode copy (*routes[0]);
+	CPPUNIT_ASSERT (&copy.property ("name")->name() == &routes[0]->property ("name")->name());
+	copy.add_property ("name", "renamed");
+	CPPUNIT_ASSERT_EQUAL (size_t (2), copy.properties().size());
+	copy.remove_property ("name");
+	CPPUNIT_ASSERT (copy.property ("name") == 0);
+	CPPUNIT_ASSERT_EQUAL (string ("Audio & <1>"), routes[0]->property ("name")->value());
+}
+
+void
+XMLTest::testNoEntityExpansion ()
+{
+	string const secret = Glib::build_filename (Glib::get_tmp_dir (), "pbd_xml_test_secret.txt");
+	Glib::file_set_contents (secret, "SECRET");
+
+	XMLTree tree;
+
+	/* files must not be able to include other files */
+	CPPUNIT_ASSERT (tree.read_buffer (
+		"<?xml version=\"1.0\"?>\n"
+		"<!DOCTYPE Session [ <!ENTITY x SYSTEM \"file://" + secret + "\"> ]>\n"
+		"<Session name=\"a &amp; &#66;&#x43;\"><Route>&x;</Route></Session>\n"));
+
+	XMLNode* root = tree.root();
+	CPPUNIT_ASSERT (root);
+	CPPUNIT_ASSERT_EQUAL (string ("a & BC"), root->property ("name")->value());
+	CPPUNIT_ASSERT (root->child ("Route")->children().empty());
+
+	::g_unlink (secret.c_str());
+}
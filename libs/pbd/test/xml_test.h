@@ -5,8 +5,12 @@ class XMLTest : public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE (XMLTest);
 	CPPUNIT_TEST (testXMLFilenameEncoding);
+	CPPUNIT_TEST (testReadBuffer);
+	CPPUNIT_TEST (testNoEntityExpansion);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
 	void testXMLFilenameEncoding ();
+	void testReadBuffer ();
+	void testNoEntityExpansion ();
 };
@@ -22,12 +22,44 @@
 #include <signal.h>
 #include <string>
 
+#include <glibmm/threads.h>
+
 #include "pbd/transmitter.h"
 #include "pbd/error.h"
 
 using std::string;
 using std::ios;
 
+namespace {
+
+/** A transmitter which adds the messages delivered to it to a Capture */
+class KeepingTransmitter : public Transmitter
+{
+  public:
+	KeepingTransmitter (Channel c, Transmitter::Capture::Messages& m)
+		: Transmitter (c)
+		, _channel (c)
+		, _messages (m)
+	{}
+
+  protected:
+	void deliver () {
+		_messages.push_back (std::make_pair (_channel, str ()));
+		str (string ());
+		clear ();
+	}
+
+  private:
+	Channel _channel;
+	Transmitter::Capture::Messages& _messages;
+};
+
+void do_not_delete_the_capture (void*) { }
+
+Glib::Threads::Private<Transmitter::Capture> thread_capture (do_not_delete_the_capture);
+
+}
+
 Transmitter::Transmitter (Channel c)
 {
 	channel = c;
@@ -101,6 +133,60 @@ Transmitter::deliver ()
 	}
 }
 
+std::ostream&
+Transmitter::stream ()
+{
+	Capture* c = thread_capture.get ();
+
+	if (c) {
+		if (this == &PBD::error) {
+			return *c->_error;
+		} else if (this == &PBD::warning) {
+			return *c->_warning;
+		} else if (this == &PBD::info) {
+			return *c->_info;
+		}
+	}
+
+	return *this;
+}
+
+Transmitter::Capture::Capture ()
+	: _info (new KeepingTransmitter (Info, _messages))
+	, _warning (new KeepingTransmitter (Warning, _messages))
+	, _error (new KeepingTransmitter (Error, _messages))
+	, _previous (thread_capture.get ())
+{
+	thread_capture.set (this);
+}
+
+Transmitter::Capture::~Capture ()
+{
+	thread_capture.set (_previous);
+
+	delete _info;
+	delete _warning;
+	delete _error;
+}
+
+void
+Transmitter::Capture::send (Messages const & messages)
+{
+	for (Messages::const_iterator m = messages.begin(); m != messages.end(); ++m) {
+		switch (m->first) {
+		case Info:
+			PBD::info << m->second << endmsg;
+			break;
+		case Warning:
+			PBD::warning << m->second << endmsg;
+			break;
+		default:
+			PBD::error << m->second << endmsg;
+			break;
+		}
+	}
+}
+
 bool
 Transmitter::does_not_return ()
 
@@ -18,15 +18,23 @@
     $Id$
 */
 
+#include <cstdio>
 #include <string>
 #include <sstream>
 #include <time.h>
 
+#include <glibmm/miscutils.h>
+
+#include "pbd/gstdio_compat.h"
 #include "pbd/undo.h"
 #include "pbd/xml++.h"
+#include "pbd/error.h"
+#include "pbd/compose.h"
 
 #include <sigc++/bind.h>
 
+#include "i18n.h"
+
 using namespace std;
 using namespace sigc;
 
@@ -150,6 +158,50 @@ XMLNode &UndoTransaction::get_state()
     return *node;
 }
 
+size_t
+UndoTransaction::memory_size () const
+{
+	size_t size = Command::memory_size ();
+
+	for (list<Command*>::const_iterator i = actions.begin(); i != actions.end(); ++i) {
+		size += (*i)->memory_size ();
+	}
+
+	return size;
+}
+
+/** Stands in for a transaction whose state UndoHistory has written to a
+ *  file to save memory.  It has no commands of its own.
+ */
+class SpilledUndoTransaction : public UndoTransaction
+{
+  public:
+	SpilledUndoTransaction (UndoTransaction const & ut, std::string const & path)
+		: _path (path)
+	{
+		struct timeval tv = ut.timestamp ();
+		set_name (ut.name ());
+		set_timestamp (tv);
+	}
+
+	~SpilledUndoTransaction () {
+		::g_unlink (_path.c_str());
+	}
+
+	std::string const & path () const { return _path; }
+
+	XMLNode& get_state () {
+		XMLTree tree;
+		if (!tree.read (_path)) {
+			return UndoTransaction::get_state ();
+		}
+		return *(new XMLNode (*tree.root()));
+	}
+
+  private:
+	std::string _path;
+};
+
 class UndoRedoSignaller {
 public:
     UndoRedoSignaller (UndoHistory& uh)
@@ -168,6 +220,136 @@ UndoHistory::UndoHistory ()
 {
 	_clearing = false;
 	_depth = 0;
+	_memory_budget = 0;
+	_memory_used = 0;
+	_spilled = 0;
+	_spill_counter = 0;
+}
+
+void
+UndoHistory::set_memory_budget (size_t bytes)
+{
+	_memory_budget = bytes;
+
+	if (_memory_budget == 0) {
+		return;
+	}
+
+	/* sizes are only tracked while there is a budget */
+
+	for (std::list<UndoTransaction*>::iterator i = UndoList.begin(); i != UndoList.end(); ++i) {
+		if (_sizes.find (*i) == _sizes.end() && !dynamic_cast<SpilledUndoTransaction*> (*i)) {
+			track (*i, (*i)->memory_size ());
+		}
+	}
+
+	for (std::list<UndoTransaction*>::iterator i = RedoList.begin(); i != RedoList.end(); ++i) {
+		if (_sizes.find (*i) == _sizes.end()) {
+			track (*i, (*i)->memory_size ());
+		}
+	}
+
+	enforce_memory_budget ();
+}
+
+void
+UndoHistory::set_spill_directory (SpillDirectory dir, TransactionLoader loader)
+{
+	_spill_directory.clear ();
+	_get_spill_directory = dir;
+	_loader = loader;
+}
+
+void
+UndoHistory::track (UndoTransaction* ut, size_t size)
+{
+	_sizes[ut] = size;
+	_memory_used += size;
+}
+
+void
+UndoHistory::enforce_memory_budget ()
+{
+	if (_memory_budget == 0) {
+		return;
+	}
+
+	/* the most recent transaction always stays in memory */
+
+	std::list<UndoTransaction*>::iterator i = UndoList.begin();
+	std::advance (i, _spilled);
+
+	while (_memory_used > _memory_budget && _spilled + 1 < UndoList.size()) {
+
+		UndoTransaction* ut = *i;
+
+		if (_spill_directory.empty() && _get_spill_directory) {
+			_spill_directory = _get_spill_directory ();
+		}
+
+		if (_spill_directory.empty()) {
+			i = UndoList.erase (i);
+		} else {
+			char name[32];
+			snprintf (name, sizeof (name), "undo-%u.xml", ++_spill_counter);
+			const std::string path = Glib::build_filename (_spill_directory, name);
+
+			XMLTree tree;
+			tree.set_root (&ut->get_state());
+
+			if (!tree.write (path)) {
+				PBD::warning << string_compose (_("Could not write undo history to %1, it will use more memory than configured"), path) << endmsg;
+				return;
+			}
+
+			*i = new SpilledUndoTransaction (*ut, path);
+			++_spilled;
+			++i;
+		}
+
+		_clearing = true;
+		delete ut;
+		_clearing = false;
+	}
+}
+
+/** If @a ut has been spilled, rebuild it from its file.
+ *  @return the transaction to use in place of @a ut, or 0 if it could not be rebuilt.
+ */
+UndoTransaction*
+UndoHistory::reload (UndoTransaction* ut)
+{
+	SpilledUndoTransaction* spilled = dynamic_cast<SpilledUndoTransaction*> (ut);
+
+	if (!spilled) {
+		return ut;
+	}
+
+	UndoTransaction* loaded = 0;
+	XMLTree tree;
+
+	if (_loader && tree.read (spilled->path())) {
+		loaded = _loader (*tree.root());
+	}
+
+	if (loaded && loaded->n_commands() != tree.root()->children().size()) {
+		/* something it referred to has gone; undoing only part of it
+		   would leave things in a state that never existed
+		*/
+		delete loaded;
+		loaded = 0;
+	}
+
+	if (loaded) {
+		loaded->DropReferences.connect_same_thread (*this, boost::bind (&UndoHistory::remove, this, loaded));
+		track (loaded, loaded->memory_size ());
+	} else {
+		PBD::warning << string_compose (_("Could not reload undo history for \"%1\""), spilled->name()) << endmsg;
+	}
+
+	delete spilled;
+
+	return loaded;
 }
 
 void
@@ -190,6 +372,9 @@ UndoHistory::set_depth (uint32_t d)
 		while (cnt--) {
 			ut = UndoList.front();
 			UndoList.pop_front ();
+			if (_spilled) {
+				--_spilled;
+			}
 			delete ut;
 		}
 	}
@@ -215,10 +400,17 @@ UndoHistory::add (UndoTransaction* const ut)
 			UndoTransaction* ut;
 			ut = UndoList.front ();
 			UndoList.pop_front ();
+			if (_spilled) {
+				--_spilled;
+			}
 			delete ut;
 		}
 	}
 
+	if (_memory_budget) {
+		track (ut, ut->memory_size ());
+	}
+
 	UndoList.push_back (ut);
 	/* Adding a transacrion makes the redo list meaningless. */
 	_clearing = true;
@@ -228,6 +420,8 @@ UndoHistory::add (UndoTransaction* const ut)
 	RedoList.clear ();
 	_clearing = false;
 
+	enforce_memory_budget ();
+
 	/* we are now owners of the transaction and must delete it when finished with it */
 
 	Changed (); /* EMIT SIGNAL */
@@ -236,6 +430,13 @@ UndoHistory::add (UndoTransaction* const ut)
 void
 UndoHistory::remove (UndoTransaction* const ut)
 {
+	std::map<UndoTransaction*, size_t>::iterator s = _sizes.find (ut);
+
+	if (s != _sizes.end()) {
+		_memory_used -= s->second;
+		_sizes.erase (s);
+	}
+
 	if (_clearing) {
 		return;
 	}
@@ -265,6 +466,12 @@ UndoHistory::undo (unsigned int n)
 			}
 			UndoTransaction* ut = UndoList.back ();
 			UndoList.pop_back ();
+			if (UndoList.size() < _spilled) {
+				--_spilled;
+				if ((ut = reload (ut)) == 0) {
+					continue;
+				}
+			}
 			ut->undo ();
 			RedoList.push_back (ut);
 		}
@@ -294,6 +501,8 @@ UndoHistory::redo (unsigned int n)
 		}
 	}
 
+	enforce_memory_budget ();
+
 	Changed (); /* EMIT SIGNAL */
 }
 
@@ -319,6 +528,7 @@ UndoHistory::clear_undo ()
                 delete *i;
         }
 	UndoList.clear ();
+	_spilled = 0;
 	_clearing = false;
 
 	Changed (); /* EMIT SIGNAL */
@@ -5,12 +5,21 @@
  * Modified for Ardour and released under the same terms.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <vector>
+
+#include <glib.h>
+
+#include <glibmm/threads.h>
 
 #include "pbd/stacktrace.h"
 #include "pbd/xml++.h"
 
 #include <libxml/debugXML.h>
+#include <libxml/parserInternals.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 
@@ -22,6 +31,48 @@ static XMLNode*           readnode(xmlNodePtr);
 static void               writenode(xmlDocPtr, XMLNode*, xmlNodePtr, int);
 static XMLSharedNodeList* find_impl(xmlXPathContext* ctxt, const string& xpath);
 
+/** Builds the XMLNode tree straight from libxml2's SAX2 callbacks, so that
+ *  reading a file does not first build (and then throw away) a complete
+ *  libxml2 document.
+ */
+class XMLTreeReader {
+public:
+	XMLTreeReader () : _root (0) {}
+
+	XMLNode* read (xmlParserCtxtPtr);
+
+private:
+	XMLNode*                 _root;
+	std::vector<XMLNode*>    _stack;
+	std::string              _text;
+	/* attribute names are kept in libxml2's dictionary for the duration
+	 * of the parse, so they can be mapped to interned names by address.
+	 */
+	std::map<const xmlChar*, const std::string*> _names;
+
+	static XMLTreeReader* reader (void* ctx) {
+		return static_cast<XMLTreeReader*> (static_cast<xmlParserCtxtPtr> (ctx)->_private);
+	}
+
+	void add_child (XMLNode*);
+	void flush_text (bool at_end);
+
+	static void start_element (void*, const xmlChar*, const xmlChar*, const xmlChar*, int, const xmlChar**, int, int, const xmlChar**);
+	static void end_element (void*, const xmlChar*, const xmlChar*, const xmlChar*);
+	static void characters (void*, const xmlChar*, int);
+	static void comment (void*, const xmlChar*);
+	static void processing_instruction (void*, const xmlChar*, const xmlChar*);
+};
+
+/* Interned names are looked up without locking: the table is never changed
+ * once published, adding a name publishes a copy. Replaced tables are kept,
+ * as a reader may still be using them; there are only a few hundred names.
+ */
+typedef std::map<std::string, const std::string*> InternedNames;
+static Glib::Threads::Mutex        interned_names_lock;
+static InternedNames*              interned_names = 0;
+static std::vector<InternedNames*> retired_interned_names;
+
 XMLTree::XMLTree()
 	: _filename()
 	, _root(0)
@@ -85,59 +136,41 @@ XMLTree::read_internal(bool validate)
 		_doc = 0;
 	}
 
-	/* create a parser context */
-	xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
+	xmlParserCtxtPtr ctxt = xmlCreateFileParserCtxt (_filename.c_str());
 	if (ctxt == NULL) {
 		return false;
 	}
 
-	xmlKeepBlanksDefault(0);
-	/* parse the file, activating the DTD validation option */
-	if (validate) {
-		_doc = xmlCtxtReadFile(ctxt, _filename.c_str(), NULL, XML_PARSE_DTDVALID);
-	} else {
-		_doc = xmlCtxtReadFile(ctxt, _filename.c_str(), NULL, XML_PARSE_HUGE);
-	}
+	XMLTreeReader reader;
+	_root = reader.read (ctxt);
+	xmlFreeParserCtxt (ctxt);
 
-	/* check if parsing suceeded */
-	if (_doc == NULL) {
-		xmlFreeParserCtxt(ctxt);
-		return false;
-	} else {
-		/* check if validation suceeded */
-		if (validate && ctxt->valid == 0) {
-			xmlFreeParserCtxt(ctxt);
-			throw XMLException("Failed to validate document " + _filename);
-		}
-	}
-
-	_root = readnode(xmlDocGetRootElement(_doc));
-
-	/* free up the parser context */
-	xmlFreeParserCtxt(ctxt);
-
-	return true;
+	return _root != 0;
 }
 
 bool
 XMLTree::read_buffer(const string& buffer)
 {
-	xmlDocPtr doc;
-
 	_filename = "";
 
 	delete _root;
 	_root = 0;
 
-	doc = xmlParseMemory(const_cast<char*>(buffer.c_str()), buffer.length());
-	if (!doc) {
+	if (_doc) {
+		xmlFreeDoc (_doc);
+		_doc = 0;
+	}
+
+	xmlParserCtxtPtr ctxt = xmlCreateMemoryParserCtxt (buffer.c_str(), buffer.length());
+	if (ctxt == NULL) {
 		return false;
 	}
 
-	_root = readnode(xmlDocGetRootElement(doc));
-	xmlFreeDoc(doc);
+	XMLTreeReader reader;
+	_root = reader.read (ctxt);
+	xmlFreeParserCtxt (ctxt);
 
-	return true;
+	return _root != 0;
 }
 
 
@@ -245,7 +278,6 @@ XMLNode::clear_lists ()
 	XMLPropertyIterator curprop;
 
 	_selected_children.clear ();
-	_propmap.clear ();
 
 	for (curchild = _children.begin(); curchild != _children.end();	++curchild) {
 		delete *curchild;
@@ -277,7 +309,7 @@ XMLNode::operator= (const XMLNode& from)
 
 		props = from.properties();
 		for (curprop = props.begin(); curprop != props.end(); ++curprop) {
-			add_property((*curprop)->name().c_str(), (*curprop)->value());
+			_proplist.push_back (new XMLProperty ((*curprop)->_name, (*curprop)->value()));
 		}
 
 		nodes = from.children();
@@ -376,6 +408,11 @@ XMLTree::find(const string xpath, XMLNode* node) const
 		writenode(doc, node, doc->children, 1);
 		ctxt = xmlXPathNewContext(doc);
 	} else {
+		if (!_doc && _root) {
+			/* read by XMLTreeReader, which does not keep a document */
+			_doc = xmlNewDoc(xml_version);
+			writenode(_doc, _root, _doc->children, 1);
+		}
 		ctxt = xmlXPathNewContext(_doc);
 	}
 
@@ -410,11 +447,10 @@ XMLNode::add_content(const string& c)
 XMLProperty const *
 XMLNode::property(const char* n) const
 {
-	string ns(n);
-	map<string,XMLProperty*>::const_iterator iter;
-
-	if ((iter = _propmap.find(ns)) != _propmap.end()) {
-		return iter->second;
+	for (XMLPropertyConstIterator i = _proplist.begin(); i != _proplist.end(); ++i) {
+		if ((*i)->name() == n) {
+			return *i;
+		}
 	}
 
 	return 0;
@@ -423,10 +459,10 @@ XMLNode::property(const char* n) const
 XMLProperty const *
 XMLNode::property(const string& ns) const
 {
-	map<string,XMLProperty*>::const_iterator iter;
-
-	if ((iter = _propmap.find(ns)) != _propmap.end()) {
-		return iter->second;
+	for (XMLPropertyConstIterator i = _proplist.begin(); i != _proplist.end(); ++i) {
+		if ((*i)->name() == ns) {
+			return *i;
+		}
 	}
 
 	return 0;
@@ -435,57 +471,35 @@ XMLNode::property(const string& ns) const
 XMLProperty *
 XMLNode::property(const char* n)
 {
-	string ns(n);
-	map<string,XMLProperty*>::iterator iter;
-
-	if ((iter = _propmap.find(ns)) != _propmap.end()) {
-		return iter->second;
-	}
-
-	return 0;
+	return const_cast<XMLProperty*> (const_cast<XMLNode const *> (this)->property (n));
 }
 
 XMLProperty *
 XMLNode::property(const string& ns)
 {
-	map<string,XMLProperty*>::iterator iter;
-
-	if ((iter = _propmap.find(ns)) != _propmap.end()) {
-		return iter->second;
-	}
-
-	return 0;
+	return const_cast<XMLProperty*> (const_cast<XMLNode const *> (this)->property (ns));
 }
 
 bool
 XMLNode::has_property_with_value (const string& key, const string& value) const
 {
-	map<string,XMLProperty*>::const_iterator iter = _propmap.find(key);
-	if (iter != _propmap.end()) {
-		const XMLProperty* p = (iter->second);
-		return (p && p->value() == value);
-	}
-	return false;
+	const XMLProperty* p = property (key);
+	return (p && p->value() == value);
 }
 
 XMLProperty*
 XMLNode::add_property(const char* n, const string& v)
 {
-	string ns(n);
-        map<string,XMLProperty*>::iterator iter;
+	const string& name (XMLProperty::intern_name (n));
 
-        if ((iter = _propmap.find(ns)) != _propmap.end()) {
-                iter->second->set_value (v);
-                return iter->second;
-	}
-
-	XMLProperty* tmp = new XMLProperty(ns, v);
-
-	if (!tmp) {
-		return 0;
+	for (XMLPropertyIterator i = _proplist.begin(); i != _proplist.end(); ++i) {
+		if (&(*i)->name() == &name) {
+			(*i)->set_value (v);
+			return *i;
+		}
 	}
 
-	_propmap[tmp->name()] = tmp;
+	XMLProperty* tmp = new XMLProperty(&name, v);
 	_proplist.insert(_proplist.end(), tmp);
 
 	return tmp;
@@ -509,14 +523,12 @@ XMLNode::add_property(const char* name, const long value)
 void
 XMLNode::remove_property(const string& n)
 {
-	if (_propmap.find(n) != _propmap.end()) {
-		XMLProperty* p = _propmap[n];
-		XMLPropertyIterator i = std::find(_proplist.begin(), _proplist.end(), p);
-		if (i != _proplist.end ()) {
+	for (XMLPropertyIterator i = _proplist.begin(); i != _proplist.end(); ++i) {
+		if ((*i)->name() == n) {
+			delete *i;
 			_proplist.erase (i);
+			return;
 		}
-		delete p;
-		_propmap.erase(n);
 	}
 }
 
@@ -576,15 +588,69 @@ XMLNode::remove_nodes_and_delete(const string& propname, const string& val)
 }
 
 XMLProperty::XMLProperty(const string& n, const string& v)
-	: _name(n)
+	: _name(&intern_name (n))
 	, _value(v)
 {
+}
+
+XMLProperty::XMLProperty(const string* interned_name, const string& v)
+	: _name(interned_name)
+	, _value(v)
+{
+}
+
+/** @return the shared copy of the (normalized) property name @a n */
+const string&
+XMLProperty::intern_name (const string& n)
+{
+	InternedNames const * names = (InternedNames*) g_atomic_pointer_get (&interned_names);
+
+	if (names) {
+		InternedNames::const_iterator i = names->find (n);
+		if (i != names->end()) {
+			return *i->second;
+		}
+	}
+
+	string name (n);
+
 	// Normalize property name (replace '_' with '-' as old session are inconsistent)
-	for (size_t i = 0; i < _name.length(); ++i) {
-		if (_name[i] == '_') {
-			_name[i] = '-';
+	for (size_t i = 0; i < name.length(); ++i) {
+		if (name[i] == '_') {
+			name[i] = '-';
 		}
 	}
+
+	Glib::Threads::Mutex::Lock lm (interned_names_lock);
+
+	InternedNames* current = (InternedNames*) g_atomic_pointer_get (&interned_names);
+	InternedNames::const_iterator i;
+
+	if (current && (i = current->find (n)) != current->end()) {
+		/* added by another thread in the meantime */
+		return *i->second;
+	}
+
+	const string* interned = 0;
+
+	if (name != n && current && (i = current->find (name)) != current->end()) {
+		interned = i->second;
+	} else {
+		interned = new string (name);
+	}
+
+	InternedNames* updated = current ? new InternedNames (*current) : new InternedNames;
+	updated->insert (make_pair (name, interned));
+	/* also find the unnormalized spelling without normalizing it again */
+	updated->insert (make_pair (n, interned));
+
+	g_atomic_pointer_set (&interned_names, updated);
+
+	if (current) {
+		retired_interned_names.push_back (current);
+	}
+
+	return *interned;
 }
 
 XMLProperty::~XMLProperty()
@@ -626,6 +692,222 @@ readnode(xmlNodePtr node)
 	return tmp;
 }
 
+/** Replace character references and the predefined entities in @a value.
+ *  Without XML_PARSE_NOENT, libxml2 leaves them in attribute values (as
+ *  character references); other entity references are left as they are.
+ */
+static void
+decode_references (string& value)
+{
+	size_t amp = value.find ('&');
+
+	while (amp != string::npos) {
+		const size_t semi = value.find (';', amp);
+		if (semi == string::npos) {
+			return;
+		}
+
+		const string ref (value, amp + 1, semi - amp - 1);
+		string replacement;
+
+		if (ref.size() > 1 && ref[0] == '#') {
+			char* end;
+			const unsigned long c = (ref[1] == 'x')
+				? strtoul (ref.c_str() + 2, &end, 16)
+				: strtoul (ref.c_str() + 1, &end, 10);
+			if (*end == '\0' && c > 0 && c <= 0x10ffff) {
+				char utf8[8];
+				utf8[g_unichar_to_utf8 (c, utf8)] = '\0';
+				replacement = utf8;
+			}
+		} else if (ref == "amp") {
+			replacement = "&";
+		} else if (ref == "lt") {
+			replacement = "<";
+		} else if (ref == "gt") {
+			replacement = ">";
+		} else if (ref == "quot") {
+			replacement = "\"";
+		} else if (ref == "apos") {
+			replacement = "'";
+		}
+
+		if (replacement.empty()) {
+			amp = value.find ('&', semi);
+		} else {
+			value.replace (amp, semi + 1 - amp, replacement);
+			amp = value.find ('&', amp + replacement.size());
+		}
+	}
+}
+
+XMLNode*
+XMLTreeReader::read (xmlParserCtxtPtr ctxt)
+{
+	xmlSAXHandler handler;
+
+	memset (&handler, 0, sizeof (handler));
+	xmlSAXVersion (&handler, 2);
+
+	handler.startElementNs        = start_element;
+	handler.endElementNs          = end_element;
+	handler.characters            = characters;
+	/* blanks are dropped by flush_text(), the same way as keepBlanks=0 does */
+	handler.ignorableWhitespace   = characters;
+	handler.cdataBlock            = characters;
+	handler.comment               = comment;
+	handler.processingInstruction = processing_instruction;
+	/* entities are not expanded (which would let a file include other
+	 * files), references to anything but the predefined ones are dropped.
+	 */
+	handler.reference             = 0;
+
+	*ctxt->sax = handler;
+	ctxt->_private = this;
+
+	xmlCtxtUseOptions (ctxt, XML_PARSE_HUGE | XML_PARSE_NONET);
+	xmlParseDocument (ctxt);
+
+	/* xmlSAX2StartDocument() still creates an (empty) document */
+	if (ctxt->myDoc) {
+		xmlFreeDoc (ctxt->myDoc);
+		ctxt->myDoc = 0;
+	}
+
+	XMLNode* root = _root;
+	_root = 0;
+
+	if (!ctxt->wellFormed) {
+		delete root;
+		return 0;
+	}
+
+	return root;
+}
+
+void
+XMLTreeReader::add_child (XMLNode* node)
+{
+	if (!_stack.empty()) {
+		_stack.back()->add_child_nocopy (*node);
+	} else if (!_root) {
+		_root = node;
+	} else {
+		delete node;
+	}
+}
+
+/** Add any text seen since the last element boundary as a content node.
+ *  Blank text is ignored unless it is the only content of an element,
+ *  which is what libxml2 does for documents parsed with keepBlanks=0.
+ */
+void
+XMLTreeReader::flush_text (bool at_end)
+{
+	if (_text.empty()) {
+		return;
+	}
+
+	if (!_stack.empty()) {
+		const bool blank = _text.find_first_not_of (" \t\r\n") == string::npos;
+
+		if (!blank || (at_end && _stack.back()->children().empty())) {
+			_stack.back()->add_child_nocopy (*new XMLNode ("text", _text));
+		}
+	}
+
+	_text.clear ();
+}
+
+void
+XMLTreeReader::start_element (void* ctx, const xmlChar* localname, const xmlChar*, const xmlChar*,
+                              int, const xmlChar**, int nb_attributes, int, const xmlChar** attributes)
+{
+	XMLTreeReader* r = reader (ctx);
+
+	r->flush_text (false);
+
+	XMLNode* node = new XMLNode ((const char*) localname);
+
+	/* each attribute is (localname, prefix, URI, value, end) */
+	for (int i = 0; i < nb_attributes; ++i, attributes += 5) {
+
+		std::map<const xmlChar*, const string*>::iterator n = r->_names.find (attributes[0]);
+		const string* name;
+
+		if (n != r->_names.end()) {
+			name = n->second;
+		} else {
+			name = &XMLProperty::intern_name ((const char*) attributes[0]);
+			r->_names.insert (std::make_pair (attributes[0], name));
+		}
+
+		string value ((const char*) attributes[3], attributes[4] - attributes[3]);
+		decode_references (value);
+		XMLPropertyIterator p;
+
+		for (p = node->_proplist.begin(); p != node->_proplist.end(); ++p) {
+			if ((*p)->_name == name) {
+				(*p)->set_value (value);
+				break;
+			}
+		}
+
+		if (p == node->_proplist.end()) {
+			node->_proplist.push_back (new XMLProperty (name, value));
+		}
+	}
+
+	r->add_child (node);
+	r->_stack.push_back (node);
+}
+
+void
+XMLTreeReader::end_element (void* ctx, const xmlChar*, const xmlChar*, const xmlChar*)
+{
+	XMLTreeReader* r = reader (ctx);
+
+	r->flush_text (true);
+
+	if (!r->_stack.empty()) {
+		r->_stack.pop_back ();
+	}
+}
+
+void
+XMLTreeReader::characters (void* ctx, const xmlChar* ch, int len)
+{
+	reader (ctx)->_text.append ((const char*) ch, len);
+}
+
+void
+XMLTreeReader::comment (void* ctx, const xmlChar* value)
+{
+	XMLTreeReader* r = reader (ctx);
+
+	r->flush_text (false);
+
+	if (!r->_stack.empty()) {
+		XMLNode* node = new XMLNode ("comment");
+		node->set_content ((const char*) value);
+		r->add_child (node);
+	}
+}
+
+void
+XMLTreeReader::processing_instruction (void* ctx, const xmlChar* target, const xmlChar* data)
+{
+	XMLTreeReader* r = reader (ctx);
+
+	r->flush_text (false);
+
+	if (!r->_stack.empty()) {
+		XMLNode* node = new XMLNode ((const char*) target);
+		node->set_content (data ? (const char*) data : "");
+		r->add_child (node);
+	}
+}
+
 static void
 writenode(xmlDocPtr doc, XMLNode* n, xmlNodePtr p, int root = 0)
 {
@@ -104,7 +104,7 @@ SessionUtils::init ()
 }
 
 // TODO return NULL, rather than exit() ?!
-static Session * _load_session (string dir, string state)
+static Session * _load_session (string dir, string state, uint32_t block_size)
 {
 	AudioEngine* engine = AudioEngine::create ();
 
@@ -127,6 +127,11 @@ static Session * _load_session (string dir, string state)
 		::exit (EXIT_FAILURE);
 	}
 
+	if (block_size > 0 && engine->set_buffer_size (block_size)) {
+		std::cerr << "Cannot set buffer size.\n";
+		::exit (EXIT_FAILURE);
+	}
+
 	init_post_engine ();
 
 	if (engine->start () != 0) {
@@ -140,11 +145,11 @@ static Session * _load_session (string dir, string state)
 }
 
 Session *
-SessionUtils::load_session (string dir, string state)
+SessionUtils::load_session (string dir, string state, uint32_t block_size)
 {
 	Session* s = 0;
 	try {
-		s = _load_session (dir, state);
+		s = _load_session (dir, state, block_size);
 	} catch (failed_constructor& e) {
 		cerr << "failed_constructor: " << e.what() << "\n";
 		::exit (EXIT_FAILURE);
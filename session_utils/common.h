@@ -25,8 +25,9 @@ namespace SessionUtils {
 
 	/** @param dir Session directory.
 	 *  @param state Session state file, without .ardour suffix.
+	 *  @param block_size engine buffer size in samples, 0 for the default.
 	 */
-	ARDOUR::Session * load_session (std::string dir, std::string state);
+	ARDOUR::Session * load_session (std::string dir, std::string state, uint32_t block_size = 0);
 
 	/** close session and stop engine
 	 * @param s Session to close (may me NULL)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <getopt.h>
@@ -13,6 +14,7 @@
 #include "ardour/export_channel_configuration.h"
 #include "ardour/export_format_specification.h"
 #include "ardour/export_filename.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/route.h"
 #include "ardour/session_metadata.h"
 #include "ardour/broadcast_info.h"
@@ -150,7 +152,9 @@ static void usage (int status) {
 	printf ("export - export an ardour session from the commandline.\n\n");
 	printf ("Usage: export [ OPTIONS ] <session-dir> <session-name>\n\n");
 	printf ("Options:\n\
+  -b, --blocksize <samples>  process in blocks of this size (default: 8192)\n\
   -h, --help                 display this help and exit\n\
+  -j, --threads <num>        number of processing threads (default: all CPUs)\n\
   -n, --normalize            normalize signal level (to 0dBFS)\n\
   -o, --output  <file>       set expected [initial] framerate\n\
   -s, --samplerate <rate>    samplerate to use (default: 48000)\n\
@@ -159,6 +163,9 @@ static void usage (int status) {
 	printf ("\n\
 The session is exported as 16bit wav.\n\
 If the no output file is given, the session's export dir is used.\n\
+\n\
+No audio hardware is used: the session is processed as fast as possible,\n\
+in large blocks, on all CPUs.\n\
 \n");
 
 	printf ("Report bugs to <http://tracker.ardour.org/>\n"
@@ -171,11 +178,15 @@ int main (int argc, char* argv[])
 	std::string rate = "48000";
 	std::string outfile;
 	bool normalize = false;
+	uint32_t block_size = 8192;
+	int32_t n_threads = 0;
 
-	const char *optstring = "hno:r:V";
+	const char *optstring = "b:hj:no:r:V";
 
 	const struct option longopts[] = {
+		{ "blocksize",  1, 0, 'b' },
 		{ "help",       0, 0, 'h' },
+		{ "threads",    1, 0, 'j' },
 		{ "normalize",  0, 0, 'n' },
 		{ "output",     1, 0, 'o' },
 		{ "samplerate", 1, 0, 'r' },
@@ -187,6 +198,21 @@ int main (int argc, char* argv[])
 					optstring, longopts, (int *) 0))) {
 		switch (c) {
 
+			case 'b':
+				{
+					const int bs = atoi (optarg);
+					if (bs >= 64 && bs <= 8192) {
+						block_size = bs;
+					} else {
+						fprintf(stderr, "Invalid Blocksize\n");
+					}
+				}
+				break;
+
+			case 'j':
+				n_threads = std::max (0, atoi (optarg));
+				break;
+
 			case 'n':
 				normalize = true;
 				break;
@@ -231,7 +257,10 @@ int main (int argc, char* argv[])
 	SessionUtils::init();
 	Session* s = 0;
 
-	s = SessionUtils::load_session (argv[optind], argv[optind+1]);
+	/* 0: use all CPUs */
+	Config->set_processor_usage (n_threads);
+
+	s = SessionUtils::load_session (argv[optind], argv[optind+1], block_size);
 
 	export_session (s, outfile, rate, normalize);
 